@@ -0,0 +1,161 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "RenderBatch.hpp"
+#include "BenchMaps.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Throughput of RenderBatch: frames/sec when rendering the built-in level (or the
+// --map) from 1 to 64 cameras at once, each into its own small buffer, on 1 thread
+// up to every core. Each row renders about N frames, from cameras on random open
+// tiles looking in random directions. Prints CSV on stdout.
+//
+// Usage: raycaster_batchbench [--width W] [--height H] [--frames N] [--max-threads N]
+//     [--map file] [--sprites N] [--tracer scalar|sse2|avx2] [--skip auto|on|off]
+//     [--textures on|off] [--floors on|off]
+
+static const int CAMERA_COUNTS[] = { 1, 4, 16, 64 };
+
+// The scene the game's options built, for the batch to render
+static void CopyScene(Scene& scene)
+{
+    scene.CopyMap(map);
+    scene.GetSprites() = sprites;
+    scene.SpritesChanged();
+    scene.GetTextures() = textures;
+    scene.GetSpriteTextures() = spriteTextures;
+    scene.SetTexturedWalls(texturedWalls);
+    scene.SetTexturedFloors(texturedFloors);
+    scene.SetSkipMode(skipMode);
+    scene.Prepare();
+}
+
+// Fails if the map has no open tiles to put them in
+static bool MakeCameras(const Map& source, int count, int width, int height, std::mt19937& rng, std::vector<Camera>& cameras)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    cameras.clear();
+    while ((int)cameras.size() < count)
+    {
+        Camera camera;
+        if (!RandomOpenPoint(source, 0, rng, camera.x, camera.y))
+        {
+            return false;
+        }
+
+        camera.rot = uniform(rng) * TWO_PI;
+        camera.fov = FOV;
+        camera.width = width;
+        camera.height = height;
+        cameras.push_back(camera);
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int width = 160;
+    int height = 120;
+    int frameCount = 2000;
+    int maxThreads = SDL_GetCPUCount();
+
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--width" && hasValue)
+        {
+            width = std::max(atoi(argv[++i]), 2);
+        }
+        else if (arg == "--height" && hasValue)
+        {
+            height = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            frameCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--max-threads" && hasValue)
+        {
+            maxThreads = std::max(atoi(argv[++i]), 1);
+        }
+        else if (!ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--width W] [--height H] [--frames N] [--max-threads N]"
+                " [--map file] [--sprites N] [--tracer scalar|sse2|avx2] [--skip auto|on|off]"
+                " [--textures on|off] [--floors on|off]" << std::endl;
+            return 1;
+        }
+    }
+
+    Scene scene;
+    CopyScene(scene);
+
+    // Doubling up to every core, and every core itself when that isn't a power of two
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    int maxCameras = CAMERA_COUNTS[sizeof(CAMERA_COUNTS) / sizeof(CAMERA_COUNTS[0]) - 1];
+    std::vector<Pixel> buffers((size_t)maxCameras * width * height);
+    std::vector<RenderTarget> targets(maxCameras);
+    for (int i = 0; i < maxCameras; i++)
+    {
+        targets[i].pixels = &buffers[(size_t)i * width * height];
+        targets[i].pitch = width;
+    }
+
+    std::cout << "cameras,threads,width,height,batches_per_sec,frames_per_sec,mpix_s,frames_per_sec_per_thread" << std::endl;
+
+    for (size_t t = 0; t < threadCounts.size(); t++)
+    {
+        ThreadPool pool(threadCounts[t]);
+        RenderBatch batch(&pool);
+
+        for (size_t c = 0; c < sizeof(CAMERA_COUNTS) / sizeof(CAMERA_COUNTS[0]); c++)
+        {
+            int cameraCount = CAMERA_COUNTS[c];
+
+            std::mt19937 rng(1234);
+            std::vector<Camera> cameras;
+            if (!MakeCameras(scene.GetMap(), cameraCount, width, height, rng, cameras))
+            {
+                std::cerr << "No open tiles to put the cameras in" << std::endl;
+                return 1;
+            }
+
+            // One untimed batch first, to size the buffers
+            batch.Render(scene, cameras.data(), targets.data(), cameraCount);
+
+            // About frameCount frames whatever the camera count
+            int batches = std::max(frameCount / cameraCount, 1);
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int b = 0; b < batches; b++)
+            {
+                batch.Render(scene, cameras.data(), targets.data(), cameraCount);
+            }
+            Uint64 end = SDL_GetPerformanceCounter();
+
+            double seconds = (double)(end - start) / SDL_GetPerformanceFrequency();
+            double batchesPerSec = batches / seconds;
+            double framesPerSec = batchesPerSec * cameraCount;
+
+            std::cout << cameraCount << "," << threadCounts[t] << "," << width << "," << height << ","
+                << batchesPerSec << "," << framesPerSec << "," << framesPerSec * width * height / 1e6 << ","
+                << framesPerSec / threadCounts[t] << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "BenchMaps.hpp"
+
+void MakeRandomMap(Map& map, int size, double wallDensity, int tileCount, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    map.Create(size, size, 1, 6);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            bool edge = (x == 0 || y == 0 || x == size - 1 || y == size - 1);
+            if (edge || uniform(rng) < wallDensity)
+            {
+                map.SetTile(x, y, (tileCount > 1) ? 1 + (int)(uniform(rng) * tileCount) : 1);
+            }
+        }
+    }
+}
+
+bool RandomOpenPoint(const Map& map, double margin, std::mt19937& rng, double& x, double& y)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    for (int tries = 0; tries < BENCH_POINT_TRIES; tries++)
+    {
+        x = margin + uniform(rng) * (map.GetWidth() - margin * 2);
+        y = margin + uniform(rng) * (map.GetHeight() - margin * 2);
+        if (map.GetTile((int)x, (int)y) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
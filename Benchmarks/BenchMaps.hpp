@@ -0,0 +1,18 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <random>
+#include "Map.hpp"
+
+// Random maps and points shared by the benchmarks, the same every run for the same seed
+
+// How many random points RandomOpenPoint() tries before deciding the map has no open tiles
+const int BENCH_POINT_TRIES = 100000;
+
+// A walled-in square map with walls scattered at random. Walls are tile 1, or one of
+// 1 to tileCount picked at random.
+void MakeRandomMap(Map& map, int size, double wallDensity, int tileCount, std::mt19937& rng);
+
+// A random point in an open tile, at least margin from the map's edges. Returns false
+// if none turned up in BENCH_POINT_TRIES tries.
+bool RandomOpenPoint(const Map& map, double margin, std::mt19937& rng, double& x, double& y);
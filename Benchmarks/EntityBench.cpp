@@ -0,0 +1,286 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "BenchMaps.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Entity simulation benchmark. Fills a random map with entities, half of them slow
+// NPCs that slide along walls and half fast projectiles that bounce off them, then
+// steps them at the game's simulation rate on 1 thread up to every core and prints
+// entity updates/sec as CSV on stdout. inside_walls counts the entities that ended
+// up overlapping a wall, which should always be 0.
+//
+// After the ticks, the entities are culled with Pvs::CullPoints() from a few random
+// viewpoints, with a PVS baked for the map at the start. culled_rate is the share
+// of entities left out, culls_per_sec how many entities a second go through
+// CullPoints(), and cull_misses the entities in a visible cluster that didn't come
+// out of it, which should always be 0.
+//
+// Usage: raycaster_entitybench [--counts 1000,100000,...] [--ticks N] [--size N]
+//     [--density D] [--max-threads N]
+
+// Overlap allowed before an entity counts as inside a wall
+static const double OVERLAP_TOLERANCE = 1e-4;
+
+// Fewer rays than pvsbake casts, to keep the bake to a few seconds on the whole map
+static const int PVS_ANGLES = 64;
+static const int PVS_SAMPLES = 1;
+
+static const int CULL_VIEWS = 16;
+
+// Each in the middle of a random open tile, so none starts overlapping a wall.
+// Fails if there are no open tiles.
+static bool MakeEntities(const Map& map, int count, std::mt19937& rng, Entities& entities)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    entities.Clear();
+    while (entities.GetCount() < count)
+    {
+        double x;
+        double y;
+        if (!RandomOpenPoint(map, 0, rng, x, y))
+        {
+            return false;
+        }
+
+        int tileX = (int)x;
+        int tileY = (int)y;
+
+        bool projectile = (entities.GetCount() % 2 == 1);
+        double angle = uniform(rng) * TWO_PI;
+        double speed = projectile ? 10 + uniform(rng) * 20 : 1 + uniform(rng) * 3;
+        double radius = projectile ? 0.05 + uniform(rng) * 0.05 : 0.2 + uniform(rng) * 0.2;
+
+        entities.Add(tileX + 0.5, tileY + 0.5, cos(angle) * speed, sin(angle) * speed, radius, projectile ? WALL_BOUNCE : WALL_SLIDE);
+    }
+    return true;
+}
+
+static int CountInsideWalls(const Map& map, const Entities& entities)
+{
+    const double* xs = entities.GetX();
+    const double* ys = entities.GetY();
+    const double* radii = entities.GetRadius();
+
+    int inside = 0;
+    for (int i = 0; i < entities.GetCount(); i++)
+    {
+        double x = xs[i];
+        double y = ys[i];
+        double radius = radii[i] - OVERLAP_TOLERANCE;
+
+        bool overlaps = false;
+        for (int tileY = (int)floor(y - radius); tileY <= (int)floor(y + radius) && !overlaps; tileY++)
+        {
+            for (int tileX = (int)floor(x - radius); tileX <= (int)floor(x + radius) && !overlaps; tileX++)
+            {
+                if (map.IsInside(tileX, tileY) && map.GetTile(tileX, tileY) == 0)
+                {
+                    continue;
+                }
+
+                double offsetX = x - std::min(std::max(x, (double)tileX), (double)tileX + 1);
+                double offsetY = y - std::min(std::max(y, (double)tileY), (double)tileY + 1);
+                overlaps = (offsetX * offsetX + offsetY * offsetY < radius * radius);
+            }
+        }
+
+        if (overlaps)
+        {
+            inside++;
+        }
+    }
+
+    return inside;
+}
+
+struct CullResult
+{
+    double culledRate;
+    double cullsPerSec;
+    int misses;
+};
+
+// Culls the entities from random open tiles, and checks that every entity in a
+// cluster the view's set has comes out. Fails if there are no open tiles.
+static bool CullEntities(const Map& map, const Pvs& pvs, const Entities& entities, std::mt19937& rng, CullResult& result)
+{
+    std::vector<int> indices(entities.GetCount());
+    std::vector<byte> kept(entities.GetCount());
+    Uint64 ticks = 0;
+    Uint64 culled = 0;
+    int misses = 0;
+
+    for (int view = 0; view < CULL_VIEWS; view++)
+    {
+        double x;
+        double y;
+        if (!RandomOpenPoint(map, 0, rng, x, y))
+        {
+            return false;
+        }
+
+        const byte* visible = pvs.GetVisible(x, y);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        int count = pvs.CullPoints(visible, entities.GetX(), entities.GetY(), entities.GetCount(), indices.data());
+        ticks += SDL_GetPerformanceCounter() - start;
+
+        std::fill(kept.begin(), kept.end(), 0);
+        for (int i = 0; i < count; i++)
+        {
+            kept[indices[i]] = 1;
+        }
+
+        for (int i = 0; i < entities.GetCount(); i++)
+        {
+            bool inSet = pvs.IsTileVisible(visible, (int)floor(entities.GetX()[i]), (int)floor(entities.GetY()[i]));
+            if (inSet && !kept[i])
+            {
+                misses++;
+            }
+        }
+
+        culled += entities.GetCount() - count;
+    }
+
+    result.culledRate = (double)culled / ((Uint64)entities.GetCount() * CULL_VIEWS);
+    result.cullsPerSec = (double)entities.GetCount() * CULL_VIEWS / ((double)ticks / SDL_GetPerformanceFrequency());
+    result.misses = misses;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<int> counts;
+    int tickCount = 240;
+    int size = 512;
+    double wallDensity = 0.05;
+    int maxThreads = SDL_GetCPUCount();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--counts" && hasValue)
+        {
+            const char* p = argv[++i];
+            while (*p)
+            {
+                char* end;
+                long count = strtol(p, &end, 10);
+                if (end == p)
+                {
+                    p++;
+                    continue;
+                }
+
+                counts.push_back(std::max((int)count, 1));
+                p = end;
+            }
+        }
+        else if (arg == "--ticks" && hasValue)
+        {
+            tickCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--size" && hasValue)
+        {
+            size = std::max(atoi(argv[++i]), 3);
+        }
+        else if (arg == "--density" && hasValue)
+        {
+            wallDensity = std::min(std::max(atof(argv[++i]), 0.0), 0.9);
+        }
+        else if (arg == "--max-threads" && hasValue)
+        {
+            maxThreads = std::max(atoi(argv[++i]), 1);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--counts 1000,100000,...] [--ticks N] [--size N] [--density D] [--max-threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (counts.empty())
+    {
+        counts.push_back(1000);
+        counts.push_back(10000);
+        counts.push_back(100000);
+        counts.push_back(500000);
+    }
+
+    // Doubling up to every core, and every core itself when that isn't a power of two
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::mt19937 rng(1);
+    Map map;
+    MakeRandomMap(map, size, wallDensity, 1, rng);
+
+    Pvs pvs;
+    {
+        ThreadPool pool(maxThreads);
+        pvs.Bake(map, PVS_DEFAULT_CLUSTER_SHIFT, PVS_ANGLES, PVS_SAMPLES, &pool);
+    }
+
+    std::cout << "entities,threads,ticks,updates_per_sec,ms_per_tick,wall_hits_per_tick,inside_walls,culled_rate,culls_per_sec,cull_misses" << std::endl;
+
+    Entities entities;
+    for (size_t t = 0; t < threadCounts.size(); t++)
+    {
+        ThreadPool pool(threadCounts[t]);
+
+        for (size_t c = 0; c < counts.size(); c++)
+        {
+            std::mt19937 entityRng(1234);
+            if (!MakeEntities(map, counts[c], entityRng, entities))
+            {
+                std::cerr << "No open tiles for the entities on the " << size << " map" << std::endl;
+                return 1;
+            }
+
+            Uint64 wallHits = 0;
+            Uint64 ticks = 0;
+            for (int tick = 0; tick < tickCount; tick++)
+            {
+                Uint64 start = SDL_GetPerformanceCounter();
+                entities.Update(map, SIMULATION_STEP, &pool);
+                ticks += SDL_GetPerformanceCounter() - start;
+
+                const byte* hits = entities.GetWallHits();
+                for (int i = 0; i < entities.GetCount(); i++)
+                {
+                    wallHits += hits[i];
+                }
+            }
+
+            double seconds = (double)ticks / SDL_GetPerformanceFrequency();
+            double updates = (double)entities.GetCount() * tickCount;
+
+            std::mt19937 viewRng(5678);
+            CullResult cull;
+            if (!CullEntities(map, pvs, entities, viewRng, cull))
+            {
+                std::cerr << "No open tiles to cull from on the " << size << " map" << std::endl;
+                return 1;
+            }
+
+            std::cout << entities.GetCount() << "," << threadCounts[t] << "," << tickCount << ","
+                << updates / seconds << "," << seconds * 1000 / tickCount << ","
+                << (double)wallHits / tickCount << "," << CountInsideWalls(map, entities) << ","
+                << cull.culledRate << "," << cull.cullsPerSec << "," << cull.misses << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include <algorithm>
+#include <string>
+
+// Fill rate of the span fills against setting one bounds checked pixel at a time.
+// Fills rows, columns and rectangles of a few sizes into the framebuffer both ways
+// and prints Mpixels/s for each as CSV on stdout.
+//
+// Usage: raycaster_fillbench [--pixels N]
+
+enum FillShape
+{
+    FILL_ROW,
+    FILL_COLUMN,
+    FILL_RECT
+};
+
+struct FillCase
+{
+    const char* name;
+    FillShape shape;
+    int width;
+    int height;
+};
+
+static const FillCase CASES[] =
+{
+    { "row", FILL_ROW, 4, 1 },
+    { "row", FILL_ROW, 16, 1 },
+    { "row", FILL_ROW, 64, 1 },
+    { "row", FILL_ROW, RENDER_WIDTH, 1 },
+    { "column", FILL_COLUMN, 1, 16 },
+    { "column", FILL_COLUMN, 1, 120 },
+    { "column", FILL_COLUMN, 1, RENDER_HEIGHT },
+    { "rect", FILL_RECT, 8, 8 },
+    { "rect", FILL_RECT, 64, 64 },
+    { "rect", FILL_RECT, RENDER_WIDTH, RENDER_HEIGHT }
+};
+
+static void FillPerPixel(const FillCase& fill, int x, int y, Pixel color)
+{
+    for (int row = 0; row < fill.height; row++)
+    {
+        for (int column = 0; column < fill.width; column++)
+        {
+            SetPixel(x + column, y + row, color);
+        }
+    }
+}
+
+static void FillSpans(const FillCase& fill, int x, int y, Pixel color)
+{
+    Pixel* topLeft = framebuffer + (size_t)y * framebufferPitch + x;
+
+    switch (fill.shape)
+    {
+    case FILL_ROW:
+        FillSpan(topLeft, fill.width, color);
+        break;
+    case FILL_COLUMN:
+        FillVerticalSpan(topLeft, framebufferPitch, fill.height, color);
+        break;
+    case FILL_RECT:
+        FillRect(topLeft, framebufferPitch, fill.width, fill.height, color);
+        break;
+    }
+}
+
+// Mpixels/s over about pixelCount pixels, the shape moving about the screen so
+// the spans start at every alignment
+static double MeasureFill(const FillCase& fill, Uint64 pixelCount, bool spans)
+{
+    Uint64 shapePixels = (Uint64)fill.width * fill.height;
+    Uint64 repeats = std::max(pixelCount / shapePixels, (Uint64)1);
+    int rangeX = RENDER_WIDTH - fill.width + 1;
+    int rangeY = RENDER_HEIGHT - fill.height + 1;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (Uint64 i = 0; i < repeats; i++)
+    {
+        int x = (int)((i * 7) % rangeX);
+        int y = (int)((i * 13) % rangeY);
+        Pixel color = MakePixel((Uint32)i & 0xFF, 128, 64);
+
+        if (spans)
+        {
+            FillSpans(fill, x, y, color);
+        }
+        else
+        {
+            FillPerPixel(fill, x, y, color);
+        }
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double seconds = (double)(end - start) / SDL_GetPerformanceFrequency();
+    return repeats * shapePixels / seconds / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    Uint64 pixelCount = 100000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--pixels" && hasValue)
+        {
+            pixelCount = std::max(atoll(argv[++i]), 1LL);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--pixels N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "shape,width,height,per_pixel_mpix_s,span_mpix_s,span_over_per_pixel" << std::endl;
+
+    for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++)
+    {
+        const FillCase& fill = CASES[c];
+
+        // One untimed pass first, so the framebuffer is in cache for both
+        MeasureFill(fill, pixelCount / 10, true);
+
+        double perPixel = MeasureFill(fill, pixelCount, false);
+        double spans = MeasureFill(fill, pixelCount, true);
+
+        std::cout << fill.name << "," << fill.width << "," << fill.height << ","
+            << perPixel << "," << spans << "," << spans / perPixel << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "ResolutionController.hpp"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Headless frame benchmark. Flies the camera along a scripted path and runs the
+// full Update() column loop and the Draw() rasterizer into the software framebuffer,
+// without creating an SDL window, then prints the frame timings as JSON or CSV on stdout.
+// cast_ms and raster_ms split the average frame into its two stages, and
+// bytes_per_frame is the framebuffer memory written per frame. wall_ms and floor_ms
+// are the time the rasterizer threads spent on walls and on the ceiling and floor,
+// summed over the threads. sprite_ms and sprites_visible are the average time spent
+// on sprites and the average number in view. columns_cast is the average number of
+// columns Update() cast; it reuses the last frame's where the camera didn't move.
+// With a PVS (<map>.pvs next to the --map, --pvs file or --pvs bake), sprites_culled
+// is the average number of sprites it ruled out and clusters_visible the average
+// share of the map's clusters in the player's set; both are 0 without one. The
+// default map can be seen from anywhere, so nothing is culled on it.
+//
+// --capture file records the timed frames (not the warmup) at 60 fps, with handing
+// each frame to the writer counted in its time. The frames written and dropped are
+// reported on stderr.
+//
+// --frame-budget ms runs the dynamic resolution controller against the Update() and
+// Draw() time, as the game does; width and height are then the average resolution.
+//
+// Usage: raycaster_headless [--frames N] [--warmup N] [--path file] [--format json|csv] [--frame-budget ms] [--render WxH] [--threads N] [--tracer scalar|sse2|avx2] [--caster dda|angle] [--map file] [--pvs file|bake|off] [--skip auto|on|off] [--textures on|off] [--floors on|off] [--atlas file.bmp] [--sprites N] [--sprite-atlas file.bmp] [--minimap-rays lines|cone|off] [--profile-csv file] [--profile-trace file] [--capture file.y4m|file.rgba] [--capture-buffers N]
+//
+// A path file has one keyframe per line: "<seconds> <x> <y> <rotation in degrees>".
+// Lines starting with # are ignored.
+
+struct CameraKeyframe
+{
+    double time;
+    double x;
+    double y;
+    double rot;
+};
+
+// Default path: a lap around the room in the middle of the map
+static const CameraKeyframe DEFAULT_PATH[] =
+{
+    {  0.0, 14.5, 22.0, 270 },
+    {  2.0,  5.0, 18.0, 300 },
+    {  4.0,  6.0,  5.0, 360 },
+    {  6.0, 24.0,  5.0, 450 },
+    {  8.0, 24.0, 22.0, 560 },
+    { 10.0, 14.5, 22.0, 630 }
+};
+
+static const double FRAME_TIME = 1.0 / 60;
+
+static bool LoadPath(const std::string& fileName, std::vector<CameraKeyframe>& path)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        CameraKeyframe key;
+        if (sscanf(line.c_str(), "%lf %lf %lf %lf", &key.time, &key.x, &key.y, &key.rot) == 4)
+        {
+            path.push_back(key);
+        }
+    }
+
+    return path.size() >= 2;
+}
+
+static CameraKeyframe SamplePath(const std::vector<CameraKeyframe>& path, double time)
+{
+    double duration = path.back().time - path.front().time;
+    if (duration > 0)
+    {
+        time = path.front().time + fmod(time, duration);
+    }
+
+    size_t next = 1;
+    while (next < path.size() - 1 && path[next].time < time)
+    {
+        next++;
+    }
+
+    const CameraKeyframe& a = path[next - 1];
+    const CameraKeyframe& b = path[next];
+    double span = b.time - a.time;
+    double t = (span > 0) ? (time - a.time) / span : 0;
+    t = std::min(std::max(t, 0.0), 1.0);
+
+    CameraKeyframe key;
+    key.time = time;
+    key.x = a.x + (b.x - a.x) * t;
+    key.y = a.y + (b.y - a.y) * t;
+    key.rot = a.rot + (b.rot - a.rot) * t;
+
+    return key;
+}
+
+// FNV-1a over the frame, so a run can be compared against a known-good image
+static Uint64 HashFrame(Uint64 hash, int width, int height)
+{
+    const byte* bytes = (const byte*)pixels;
+    size_t size = (size_t)width * height * sizeof(Pixel);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+int main(int argc, char** argv)
+{
+    int frameCount = 600;
+    int warmupCount = 30;
+    std::string pathFile;
+    std::string format = "json";
+    double frameBudgetMs = 0;
+
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--frames" && hasValue)
+        {
+            frameCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--warmup" && hasValue)
+        {
+            warmupCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--path" && hasValue)
+        {
+            pathFile = argv[++i];
+        }
+        else if (arg == "--format" && hasValue && (strcmp(argv[i + 1], "json") == 0 || strcmp(argv[i + 1], "csv") == 0))
+        {
+            format = argv[++i];
+        }
+        else if (arg == "--frame-budget" && hasValue)
+        {
+            frameBudgetMs = atof(argv[++i]);
+        }
+        else if (!ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--warmup N] [--path file] [--format json|csv] [--frame-budget ms] [--render WxH] [--threads N] [--tracer scalar|sse2|avx2] [--caster dda|angle] [--map file] [--pvs file|bake|off] [--skip auto|on|off] [--textures on|off] [--floors on|off] [--atlas file.bmp] [--sprites N] [--sprite-atlas file.bmp] [--minimap-rays lines|cone|off] [--profile-csv file] [--profile-trace file] [--capture file.y4m|file.rgba] [--capture-buffers N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<CameraKeyframe> path;
+    if (pathFile.empty())
+    {
+        path.assign(DEFAULT_PATH, DEFAULT_PATH + sizeof(DEFAULT_PATH) / sizeof(DEFAULT_PATH[0]));
+    }
+    else if (!LoadPath(pathFile, path))
+    {
+        std::cerr << "Could not load camera path " << pathFile << std::endl;
+        return 1;
+    }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(frameCount);
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 checksum = 14695981039346656037ull;
+    double totalTime = 0;
+    double castTime = 0;
+    double rasterTime = 0;
+    double wallTime = 0;
+    double floorTime = 0;
+    double spriteTime = 0;
+    Uint64 spritesVisible = 0;
+    Uint64 spritesCulled = 0;
+    double clustersVisible = 0;
+    Uint64 columnsCast = 0;
+    Uint64 bytesMoved = 0;
+    Uint64 widthSum = 0;
+    Uint64 heightSum = 0;
+
+    ResolutionController resolution(RENDER_WIDTH, RENDER_HEIGHT, frameBudgetMs);
+
+    for (int frame = -warmupCount; frame < frameCount; frame++)
+    {
+        CameraKeyframe key = SamplePath(path, std::max(frame, 0) * FRAME_TIME);
+        playerX = key.x;
+        playerY = key.y;
+        playerRot = fmod(Rad(key.rot), TWO_PI);
+        if (playerRot < 0)
+        {
+            playerRot += TWO_PI;
+        }
+
+        if (frame == 0 && !StartCapture((int)round(1 / FRAME_TIME)))
+        {
+            return 1;
+        }
+
+        // The warmup ends on the first timed pose, which would otherwise be reused
+        // rather than cast and timed as a full frame
+        if (frame == 0)
+        {
+            InvalidateFrame();
+        }
+
+        // The frame is kept in one piece, renderWidth pixels a row, for hashing
+        SetFramebuffer(pixels, renderWidth);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        Update();
+        Uint64 cast = SDL_GetPerformanceCounter();
+        Draw();
+        Uint64 end = SDL_GetPerformanceCounter();
+        PROFILE_FRAME_END();
+
+        double ms = (double)(end - start) * 1000 / frequency;
+        int frameWidth = renderWidth;
+        int frameHeight = renderHeight;
+        if (frameBudgetMs > 0 && resolution.Update(ms))
+        {
+            SetRenderSize(resolution.GetWidth(), resolution.GetHeight());
+        }
+
+        if (frame < 0)
+        {
+            continue;
+        }
+
+        frameTimes.push_back(ms);
+        totalTime += ms;
+        castTime += (double)(cast - start) * 1000 / frequency;
+        rasterTime += (double)(end - cast) * 1000 / frequency;
+        wallTime += frameStats.wallMs;
+        floorTime += frameStats.floorMs;
+        spriteTime += frameStats.spriteMs;
+        spritesVisible += frameStats.spritesVisible;
+        spritesCulled += frameStats.spritesCulled;
+        clustersVisible += visibleClusters ? (double)frameStats.clustersVisible / frameStats.clusterCount : 0;
+        columnsCast += frameStats.columnsCast;
+        bytesMoved += frameStats.bytesDrawn + frameStats.bytesCopied;
+        widthSum += frameWidth;
+        heightSum += frameHeight;
+        checksum = HashFrame(checksum, frameWidth, frameHeight);
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    double msPerFrame = totalTime / frameCount;
+    double columnsPerSec = (double)widthSum / (totalTime / 1000);
+    int width = (int)(widthSum / frameCount);
+    int height = (int)(heightSum / frameCount);
+
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)checksum);
+
+    if (format == "csv")
+    {
+        std::cout << "frames,width,height,threads,caster,tracer,textures,floors,ms_per_frame,cast_ms,raster_ms,wall_ms,floor_ms,sprite_ms,sprites_visible,columns_per_sec,bytes_per_frame,p50_ms,p99_ms,min_ms,max_ms,columns_cast,sprites_culled,clusters_visible,checksum" << std::endl;
+        std::cout << frameCount << "," << width << "," << height << "," << GetRenderThreads() << "," << (caster == CASTER_DDA ? "dda" : "angle") << "," << GetRayTracerName(GetRayTracer()) << "," << (texturedWalls ? "on" : "off") << "," << (texturedFloors ? "on" : "off") << ","
+            << msPerFrame << "," << castTime / frameCount << "," << rasterTime / frameCount << "," << wallTime / frameCount << "," << floorTime / frameCount << "," << spriteTime / frameCount << "," << spritesVisible / frameCount << "," << columnsPerSec << "," << bytesMoved / frameCount << ","
+            << Percentile(sorted, 0.50) << "," << Percentile(sorted, 0.99) << ","
+            << sorted.front() << "," << sorted.back() << "," << columnsCast / frameCount << "," << spritesCulled / frameCount << "," << clustersVisible / frameCount << "," << hash << std::endl;
+    }
+    else
+    {
+        std::cout << "{" << std::endl;
+        std::cout << "  \"frames\": " << frameCount << "," << std::endl;
+        std::cout << "  \"width\": " << width << "," << std::endl;
+        std::cout << "  \"height\": " << height << "," << std::endl;
+        std::cout << "  \"threads\": " << GetRenderThreads() << "," << std::endl;
+        std::cout << "  \"caster\": \"" << (caster == CASTER_DDA ? "dda" : "angle") << "\"," << std::endl;
+        std::cout << "  \"tracer\": \"" << GetRayTracerName(GetRayTracer()) << "\"," << std::endl;
+        std::cout << "  \"textures\": \"" << (texturedWalls ? "on" : "off") << "\"," << std::endl;
+        std::cout << "  \"floors\": \"" << (texturedFloors ? "on" : "off") << "\"," << std::endl;
+        std::cout << "  \"ms_per_frame\": " << msPerFrame << "," << std::endl;
+        std::cout << "  \"cast_ms\": " << castTime / frameCount << "," << std::endl;
+        std::cout << "  \"raster_ms\": " << rasterTime / frameCount << "," << std::endl;
+        std::cout << "  \"wall_ms\": " << wallTime / frameCount << "," << std::endl;
+        std::cout << "  \"floor_ms\": " << floorTime / frameCount << "," << std::endl;
+        std::cout << "  \"sprite_ms\": " << spriteTime / frameCount << "," << std::endl;
+        std::cout << "  \"sprites_visible\": " << spritesVisible / frameCount << "," << std::endl;
+        std::cout << "  \"columns_per_sec\": " << columnsPerSec << "," << std::endl;
+        std::cout << "  \"bytes_per_frame\": " << bytesMoved / frameCount << "," << std::endl;
+        std::cout << "  \"p50_ms\": " << Percentile(sorted, 0.50) << "," << std::endl;
+        std::cout << "  \"p99_ms\": " << Percentile(sorted, 0.99) << "," << std::endl;
+        std::cout << "  \"min_ms\": " << sorted.front() << "," << std::endl;
+        std::cout << "  \"max_ms\": " << sorted.back() << "," << std::endl;
+        std::cout << "  \"columns_cast\": " << columnsCast / frameCount << "," << std::endl;
+        std::cout << "  \"sprites_culled\": " << spritesCulled / frameCount << "," << std::endl;
+        std::cout << "  \"clusters_visible\": " << clustersVisible / frameCount << "," << std::endl;
+        std::cout << "  \"checksum\": \"" << hash << "\"" << std::endl;
+        std::cout << "}" << std::endl;
+    }
+
+    SaveProfile();
+    StopCapture();
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    return 0;
+}
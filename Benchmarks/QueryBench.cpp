@@ -0,0 +1,299 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "BenchMaps.hpp"
+#include "RayQueries.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Line of sight and wall distance query benchmark. Builds random maps of several
+// sizes and wall densities, then runs the same batch of queries on 1 thread up to
+// every core, walking every cell and skipping open space with a distance field,
+// and prints queries/sec as CSV on stdout. Sight queries go from random open cells
+// to targets up to --range tiles away, wall queries look up to --range tiles in
+// random directions. Every run is checked to give the same answers as the first.
+// Before any of that, sight queries to targets exactly on a wall's edges are checked
+// to come back blocked, and ones just short of it open, and the benchmark fails if not.
+//
+// Usage: raycaster_querybench [--queries N] [--sizes 1024,4096,...] [--range tiles] [--max-threads N]
+
+static const double WALL_DENSITIES[] = { 0.001, 0.01, 0.1 };
+
+// Walls are given tiles 1 to this at random, so the tiles wall queries return differ
+static const int WALL_TILES = 4;
+
+struct QueryBatch
+{
+    std::vector<double> originX;
+    std::vector<double> originY;
+    std::vector<double> targetX; // Sight queries
+    std::vector<double> targetY;
+    std::vector<double> dirX; // Wall queries
+    std::vector<double> dirY;
+};
+
+struct QueryResults
+{
+    std::vector<byte> blocked;
+    std::vector<byte> hit;
+    std::vector<double> dist;
+    std::vector<int> tile;
+};
+
+// Fails if there are no open cells to start from
+static bool MakeQueries(const Map& map, int count, double range, std::mt19937& rng, QueryBatch& batch)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    batch = QueryBatch();
+    while ((int)batch.originX.size() < count)
+    {
+        double x;
+        double y;
+        if (!RandomOpenPoint(map, 0, rng, x, y))
+        {
+            return false;
+        }
+
+        double angle = uniform(rng) * TWO_PI;
+        double dist = uniform(rng) * range;
+        batch.originX.push_back(x);
+        batch.originY.push_back(y);
+        batch.targetX.push_back(std::min(std::max(x + cos(angle) * dist, 0.0), map.GetWidth() - 0.001));
+        batch.targetY.push_back(std::min(std::max(y + sin(angle) * dist, 0.0), map.GetHeight() - 0.001));
+
+        angle = uniform(rng) * TWO_PI;
+        batch.dirX.push_back(cos(angle));
+        batch.dirY.push_back(sin(angle));
+    }
+
+    return true;
+}
+
+// A lone wall tile in an open map, seen from random points on each side, with each
+// target either on the side of the wall facing the origin or EDGE_GAP short of it.
+// Returns how many came back wrong, with and without a distance field.
+static const int EDGE_CHECKS = 1000;
+static const double EDGE_GAP = 1e-3;
+
+static int CheckEdgeTargets(std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    const int size = 64;
+    const int wall = size / 2;
+    Map map;
+    map.Create(size, size, 1, 6);
+    map.SetTile(wall, wall, 1);
+
+    DistanceField field;
+    field.Build(map);
+
+    QueryBatch batch;
+    std::vector<byte> expected;
+    for (int i = 0; i < EDGE_CHECKS; i++)
+    {
+        // Which side, how far along it, and how far away the origin is
+        int side = i % 4;
+        bool onEdge = (i / 4) % 2 == 0;
+        double along = wall + uniform(rng);
+        double away = 1 + uniform(rng) * (wall - 2);
+        double across = along + (uniform(rng) - 0.5) * 2 * away;
+        double edge = (side == 0 || side == 2) ? wall : wall + 1;
+        double sign = (side == 0 || side == 2) ? -1 : 1;
+        double target = edge + (onEdge ? 0 : sign * EDGE_GAP);
+
+        bool vertical = (side < 2);
+        batch.originX.push_back(vertical ? edge + sign * away : across);
+        batch.originY.push_back(vertical ? across : edge + sign * away);
+        batch.targetX.push_back(vertical ? target : along);
+        batch.targetY.push_back(vertical ? along : target);
+        expected.push_back(onEdge ? 1 : 0);
+    }
+
+    RayQueries queries(nullptr);
+    std::vector<byte> blocked(EDGE_CHECKS);
+    int wrong = 0;
+    for (int skip = 0; skip < 2; skip++)
+    {
+        GridView grid = map.GetGridView(0, 0);
+        grid.space = skip ? field.GetCells() : nullptr;
+        queries.TestSight(grid, batch.originX.data(), batch.originY.data(), batch.targetX.data(), batch.targetY.data(), EDGE_CHECKS, blocked.data());
+
+        for (int i = 0; i < EDGE_CHECKS; i++)
+        {
+            if (blocked[i] != expected[i])
+            {
+                wrong++;
+            }
+        }
+    }
+
+    return wrong;
+}
+
+static double TimeSight(const RayQueries& queries, const GridView& grid, const QueryBatch& batch, QueryResults& results)
+{
+    int count = (int)batch.originX.size();
+    results.blocked.resize(count);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    queries.TestSight(grid, batch.originX.data(), batch.originY.data(), batch.targetX.data(), batch.targetY.data(), count, results.blocked.data());
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    return (double)(end - start) / SDL_GetPerformanceFrequency();
+}
+
+static double TimeWalls(const RayQueries& queries, const GridView& grid, const QueryBatch& batch, double range, QueryResults& results)
+{
+    int count = (int)batch.originX.size();
+    results.hit.resize(count);
+    results.dist.resize(count);
+    results.tile.resize(count);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    queries.FindWalls(grid, batch.originX.data(), batch.originY.data(), batch.dirX.data(), batch.dirY.data(), range, count,
+        results.hit.data(), results.dist.data(), results.tile.data());
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    return (double)(end - start) / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char** argv)
+{
+    int queryCount = 1000000;
+    std::vector<int> sizes;
+    double range = 32;
+    int maxThreads = SDL_GetCPUCount();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--queries" && hasValue)
+        {
+            queryCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--sizes" && hasValue)
+        {
+            const char* p = argv[++i];
+            while (*p)
+            {
+                char* end;
+                long size = strtol(p, &end, 10);
+                if (end == p)
+                {
+                    p++;
+                    continue;
+                }
+
+                sizes.push_back(std::max((int)size, 3));
+                p = end;
+            }
+        }
+        else if (arg == "--range" && hasValue)
+        {
+            range = std::max(atof(argv[++i]), 1.0);
+        }
+        else if (arg == "--max-threads" && hasValue)
+        {
+            maxThreads = std::max(atoi(argv[++i]), 1);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--queries N] [--sizes 1024,4096,...] [--range tiles] [--max-threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (sizes.empty())
+    {
+        sizes.push_back(1024);
+        sizes.push_back(4096);
+    }
+
+    // Doubling up to every core, and every core itself when that isn't a power of two
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::mt19937 rng(1);
+
+    int edgeErrors = CheckEdgeTargets(rng);
+    if (edgeErrors > 0)
+    {
+        std::cerr << edgeErrors << " sight queries to targets on or just short of a wall's edge came back wrong" << std::endl;
+        return 1;
+    }
+
+    std::cout << "size,wall_density,threads,skip,sight_per_sec,blocked_rate,walls_per_sec,hit_rate,mismatches" << std::endl;
+
+    Map map;
+    DistanceField field;
+    QueryBatch batch;
+    QueryResults expected;
+    QueryResults results;
+
+    for (size_t s = 0; s < sizes.size(); s++)
+    {
+        for (size_t d = 0; d < sizeof(WALL_DENSITIES) / sizeof(WALL_DENSITIES[0]); d++)
+        {
+            MakeRandomMap(map, sizes[s], WALL_DENSITIES[d], WALL_TILES, rng);
+            if (!MakeQueries(map, queryCount, range, rng, batch))
+            {
+                std::cerr << "No open tiles to query from on the " << sizes[s] << " map" << std::endl;
+                return 1;
+            }
+            field.Build(map);
+
+            GridView grid = map.GetGridView(0, 0);
+            bool first = true;
+
+            for (size_t t = 0; t < threadCounts.size(); t++)
+            {
+                ThreadPool pool(threadCounts[t]);
+                RayQueries queries(&pool);
+
+                for (int skip = 0; skip < 2; skip++)
+                {
+                    grid.space = skip ? field.GetCells() : nullptr;
+
+                    double sightTime = TimeSight(queries, grid, batch, results);
+                    double wallTime = TimeWalls(queries, grid, batch, range, results);
+
+                    if (first)
+                    {
+                        expected = results;
+                        first = false;
+                    }
+
+                    int mismatches = 0;
+                    int blocked = 0;
+                    int hits = 0;
+                    for (int i = 0; i < queryCount; i++)
+                    {
+                        if (results.blocked[i] != expected.blocked[i] || results.hit[i] != expected.hit[i]
+                            || results.dist[i] != expected.dist[i] || results.tile[i] != expected.tile[i])
+                        {
+                            mismatches++;
+                        }
+
+                        blocked += results.blocked[i];
+                        hits += results.hit[i];
+                    }
+
+                    std::cout << sizes[s] << "," << WALL_DENSITIES[d] << "," << threadCounts[t] << "," << (skip ? "on" : "off") << ","
+                        << queryCount / sightTime << "," << (double)blocked / queryCount << ","
+                        << queryCount / wallTime << "," << (double)hits / queryCount << "," << mismatches << std::endl;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "BenchMaps.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// The float and fixed point DDA casters against double. Traces full screens of
+// columns from random spots on the built-in map and on random maps of a few sizes,
+// with each number type, and prints CSV on stdout: rays/sec, how many rays found a
+// different wall than the double caster, how far off the distances to the same
+// walls are, and how many wall strips came out a different height on screen.
+//
+// Usage: raycaster_scalarbench [--rays N]
+
+struct BenchMap
+{
+    const char* name;
+    int size; // 0 for the built-in map
+    double wallDensity;
+};
+
+static const BenchMap MAPS[] =
+{
+    { "default", 0, 0 },
+    { "random", 64, 0.05 },
+    { "random", 1024, 0.01 },
+    { "random", 4096, 0.001 }
+};
+
+struct BenchView
+{
+    double x;
+    double y;
+    double angle;
+};
+
+// Random open cells, looking in random directions. Fails if there are no open cells.
+static bool MakeViews(const Map& source, int count, std::mt19937& rng, std::vector<BenchView>& views)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    views.clear();
+    while ((int)views.size() < count)
+    {
+        BenchView view;
+        if (!RandomOpenPoint(source, 1, rng, view.x, view.y))
+        {
+            return false;
+        }
+
+        view.angle = uniform(rng) * TWO_PI;
+        views.push_back(view);
+    }
+
+    return true;
+}
+
+// Every column of every view, with the ray directions worked out in Scalar the way
+// the caster does. Returns the time taken in seconds.
+template <typename Scalar>
+static double TraceViews(const Map& source, const std::vector<BenchView>& views, std::vector<GridHit>& hits)
+{
+    typedef ScalarTraits<Scalar> Traits;
+
+    std::vector<GridHitT<Scalar> > typedHits(views.size() * renderWidth);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t v = 0; v < views.size(); v++)
+    {
+        GridView grid = source.GetGridView(views[v].x, views[v].y);
+        Scalar dirX = Traits::FromDouble(cos(views[v].angle));
+        Scalar dirY = Traits::FromDouble(sin(views[v].angle));
+        Scalar planeX = Traits::FromDouble(-sin(views[v].angle) * planeLength);
+        Scalar planeY = Traits::FromDouble(cos(views[v].angle) * planeLength);
+
+        for (int x = 0; x < renderWidth; x++)
+        {
+            Scalar cameraX = Traits::FromDouble(columnCameraX[x]);
+            TraceRayTyped(grid, dirX + planeX * cameraX, dirY + planeY * cameraX, typedHits[v * renderWidth + x]);
+        }
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    hits.resize(typedHits.size());
+    for (size_t i = 0; i < typedHits.size(); i++)
+    {
+        hits[i] = ToGridHit(typedHits[i]);
+    }
+
+    return (double)(end - start) / SDL_GetPerformanceFrequency();
+}
+
+static void Report(const BenchMap& benchMap, int size, const char* type, double seconds, const std::vector<GridHit>& reference, const std::vector<GridHit>& hits)
+{
+    Uint64 tileMismatches = 0;
+    Uint64 stripMismatches = 0;
+    Uint64 compared = 0;
+    double maxError = 0;
+    double totalRelError = 0;
+
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        const GridHit& a = reference[i];
+        const GridHit& b = hits[i];
+        if (a.hit != b.hit || a.tileX != b.tileX || a.tileY != b.tileY || a.side != b.side)
+        {
+            tileMismatches++;
+            continue;
+        }
+
+        if (!a.hit)
+        {
+            continue;
+        }
+
+        double error = fabs(b.perpDist - a.perpDist);
+        maxError = std::max(maxError, error);
+        totalRelError += error / a.perpDist;
+        compared++;
+
+        if (round(viewDist / a.perpDist) != round(viewDist / b.perpDist))
+        {
+            stripMismatches++;
+        }
+    }
+
+    double rays = (double)hits.size();
+    std::cout << benchMap.name << "," << size << "," << type << "," << hits.size() << "," << rays / seconds << ","
+        << 100.0 * tileMismatches / rays << "," << maxError << "," << (compared ? totalRelError / compared : 0) << ","
+        << 100.0 * stripMismatches / rays << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int rayCount = 300000;
+
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--rays" && hasValue)
+        {
+            rayCount = std::max(atoi(argv[++i]), renderWidth);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--rays N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "map,size,scalar,rays,rays_per_sec,tile_mismatch_pct,max_dist_error,mean_rel_dist_error,strip_mismatch_pct" << std::endl;
+
+    std::mt19937 rng(1);
+    Map randomMap;
+    std::vector<BenchView> views;
+    std::vector<GridHit> reference;
+    std::vector<GridHit> hits;
+
+    for (size_t m = 0; m < sizeof(MAPS) / sizeof(MAPS[0]); m++)
+    {
+        const Map* source = &map;
+        if (MAPS[m].size > 0)
+        {
+            MakeRandomMap(randomMap, MAPS[m].size, MAPS[m].wallDensity, 1, rng);
+            source = &randomMap;
+        }
+
+        if (!MakeViews(*source, rayCount / renderWidth, rng, views))
+        {
+            std::cerr << "No open tiles to look from on the " << MAPS[m].name << " map" << std::endl;
+            return 1;
+        }
+
+        // The plain DDA walk, for the hits the typed ones are checked against
+        reference.resize(views.size() * renderWidth);
+        for (size_t v = 0; v < views.size(); v++)
+        {
+            GridView grid = source->GetGridView(views[v].x, views[v].y);
+            double dirX = cos(views[v].angle);
+            double dirY = sin(views[v].angle);
+            double planeX = -sin(views[v].angle) * planeLength;
+            double planeY = cos(views[v].angle) * planeLength;
+
+            for (int x = 0; x < renderWidth; x++)
+            {
+                TraceRayDDA(grid, dirX + planeX * columnCameraX[x], dirY + planeY * columnCameraX[x], reference[v * renderWidth + x]);
+            }
+        }
+
+        int size = source->GetWidth();
+
+        double seconds = TraceViews<double>(*source, views, hits);
+        Report(MAPS[m], size, "double", seconds, reference, hits);
+
+        seconds = TraceViews<float>(*source, views, hits);
+        Report(MAPS[m], size, "float", seconds, reference, hits);
+
+        seconds = TraceViews<Fixed>(*source, views, hits);
+        Report(MAPS[m], size, "fixed", seconds, reference, hits);
+    }
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include "BenchMaps.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Empty space skipping benchmark. Builds random maps of several sizes and wall
+// densities, then traces the same rays with the plain DDA walk and with distance
+// field skipping, and prints rays/sec for both as CSV on stdout. Every ray is
+// checked to hit the same wall both ways.
+//
+// Usage: raycaster_skipbench [--rays N] [--sizes 256,1024,...] [--tracer scalar|sse2|avx2]
+
+static const double WALL_DENSITIES[] = { 0.001, 0.01, 0.05, 0.2 };
+
+struct BenchRay
+{
+    double originX;
+    double originY;
+    double dirX[RAY_PACKET_SIZE];
+    double dirY[RAY_PACKET_SIZE];
+};
+
+// Packets of neighbouring screen columns, from random open cells in random
+// directions. Fails if there are no open cells.
+static bool MakeRays(const Map& map, int count, std::mt19937& rng, std::vector<BenchRay>& rays)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    rays.clear();
+    while ((int)rays.size() * RAY_PACKET_SIZE < count)
+    {
+        BenchRay ray;
+        if (!RandomOpenPoint(map, 1, rng, ray.originX, ray.originY))
+        {
+            return false;
+        }
+
+        double angle = uniform(rng) * TWO_PI;
+        double dirX = cos(angle);
+        double dirY = sin(angle);
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            double cameraX = (lane - RAY_PACKET_SIZE / 2) / 320.0;
+            ray.dirX[lane] = dirX - dirY * cameraX;
+            ray.dirY[lane] = dirY + dirX * cameraX;
+        }
+
+        rays.push_back(ray);
+    }
+
+    return true;
+}
+
+static double TraceAll(const Map& map, const unsigned char* space, const std::vector<BenchRay>& rays, std::vector<GridHit>& hits)
+{
+    hits.resize(rays.size() * RAY_PACKET_SIZE);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        GridView grid = map.GetGridView(rays[i].originX, rays[i].originY);
+        grid.space = space;
+        TraceRayPacketDDA(grid, rays[i].dirX, rays[i].dirY, &hits[i * RAY_PACKET_SIZE]);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    return (double)(end - start) / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char** argv)
+{
+    int rayCount = 200000;
+    std::vector<int> sizes;
+
+    SelectRayTracer(RAY_TRACER_AVX2);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--rays" && hasValue)
+        {
+            rayCount = std::max(atoi(argv[++i]), RAY_PACKET_SIZE);
+        }
+        else if (arg == "--sizes" && hasValue)
+        {
+            const char* p = argv[++i];
+            while (*p)
+            {
+                char* end;
+                long size = strtol(p, &end, 10);
+                if (end == p)
+                {
+                    p++;
+                    continue;
+                }
+
+                sizes.push_back(std::max((int)size, 3));
+                p = end;
+            }
+        }
+        else if (!ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--rays N] [--sizes 256,1024,...] [--tracer scalar|sse2|avx2]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (sizes.empty())
+    {
+        sizes.push_back(64);
+        sizes.push_back(256);
+        sizes.push_back(1024);
+        sizes.push_back(4096);
+    }
+
+    std::cout << "size,wall_density,tracer,build_ms,walk_rays_per_sec,skip_rays_per_sec,speedup,mismatches" << std::endl;
+
+    std::mt19937 rng(1);
+    Map map;
+    DistanceField field;
+    std::vector<BenchRay> rays;
+    std::vector<GridHit> walkHits;
+    std::vector<GridHit> skipHits;
+
+    for (size_t s = 0; s < sizes.size(); s++)
+    {
+        for (size_t d = 0; d < sizeof(WALL_DENSITIES) / sizeof(WALL_DENSITIES[0]); d++)
+        {
+            MakeRandomMap(map, sizes[s], WALL_DENSITIES[d], 1, rng);
+            if (!MakeRays(map, rayCount, rng, rays))
+            {
+                std::cerr << "No open tiles to cast from on the " << sizes[s] << " map" << std::endl;
+                return 1;
+            }
+
+            Uint64 buildStart = SDL_GetPerformanceCounter();
+            field.Build(map);
+            double buildTime = (double)(SDL_GetPerformanceCounter() - buildStart) / SDL_GetPerformanceFrequency();
+
+            double walkTime = TraceAll(map, nullptr, rays, walkHits);
+            double skipTime = TraceAll(map, field.GetCells(), rays, skipHits);
+
+            int mismatches = 0;
+            for (size_t i = 0; i < walkHits.size(); i++)
+            {
+                const GridHit& a = walkHits[i];
+                const GridHit& b = skipHits[i];
+                if (a.hit != b.hit || a.perpDist != b.perpDist || a.side != b.side || a.tileX != b.tileX || a.tileY != b.tileY)
+                {
+                    mismatches++;
+                }
+            }
+
+            double traced = (double)rays.size() * RAY_PACKET_SIZE;
+            std::cout << sizes[s] << "," << WALL_DENSITIES[d] << "," << GetRayTracerName(GetRayTracer()) << ","
+                << buildTime * 1000 << "," << traced / walkTime << "," << traced / skipTime << ","
+                << walkTime / skipTime << "," << mismatches << std::endl;
+        }
+    }
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    return 0;
+}
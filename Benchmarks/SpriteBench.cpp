@@ -0,0 +1,153 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+
+// Sprite cost against the number of sprites in the level. The camera turns on the
+// spot inside a closed room holding a fixed number of sprites, while more and more
+// are scattered over the rest of a big map. Only the sprites in the room can be
+// seen, so the time per frame should stay about the same however many there are
+// outside. Prints CSV on stdout. sprites_after_cull counts the ones that made it
+// past the grid and view culling, some of which are then hidden behind the room's walls.
+//
+// Usage: raycaster_spritebench [--frames N] [--room-sprites N] [--threads N] [--tracer scalar|sse2|avx2]
+
+static const int MAP_SIZE = 1024;
+static const int ROOM_MIN = 500;
+static const int ROOM_MAX = 524;
+
+static const int TOTALS[] = { 0, 1000, 10000, 100000, 1000000 };
+
+static bool InRoom(int x, int y)
+{
+    return x >= ROOM_MIN && x <= ROOM_MAX && y >= ROOM_MIN && y <= ROOM_MAX;
+}
+
+// An open map with a closed room in the middle
+static void MakeMap()
+{
+    map.Create(MAP_SIZE, MAP_SIZE, 1, 6);
+    for (int y = 0; y < MAP_SIZE; y++)
+    {
+        for (int x = 0; x < MAP_SIZE; x++)
+        {
+            bool edge = (x == 0 || y == 0 || x == MAP_SIZE - 1 || y == MAP_SIZE - 1);
+            bool roomWall = InRoom(x, y) && (x == ROOM_MIN || y == ROOM_MIN || x == ROOM_MAX || y == ROOM_MAX);
+            if (edge || roomWall)
+            {
+                map.SetTile(x, y, 1 + (x + y) % 4);
+            }
+        }
+    }
+}
+
+static void AddSprites(int count, bool inside, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    while (count > 0)
+    {
+        double x = 1 + uniform(rng) * (MAP_SIZE - 2);
+        double y = 1 + uniform(rng) * (MAP_SIZE - 2);
+        if (inside)
+        {
+            x = ROOM_MIN + 1 + uniform(rng) * (ROOM_MAX - ROOM_MIN - 1);
+            y = ROOM_MIN + 1 + uniform(rng) * (ROOM_MAX - ROOM_MIN - 1);
+        }
+
+        if (map.GetTile((int)x, (int)y) != 0 || InRoom((int)x, (int)y) != inside)
+        {
+            continue;
+        }
+
+        Sprite sprite = { x, y, (int)(uniform(rng) * spriteTextures.GetTextureCount()) };
+        sprites.push_back(sprite);
+        count--;
+    }
+
+    SpritesChanged();
+}
+
+int main(int argc, char** argv)
+{
+    int frameCount = 360;
+    int roomSprites = 200;
+
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--frames" && hasValue)
+        {
+            frameCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--room-sprites" && hasValue)
+        {
+            roomSprites = std::max(atoi(argv[++i]), 0);
+        }
+        else if (!ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--room-sprites N] [--threads N] [--tracer scalar|sse2|avx2]" << std::endl;
+            return 1;
+        }
+    }
+
+    MakeMap();
+    sprites.clear();
+
+    std::mt19937 rng(1);
+    AddSprites(roomSprites, true, rng);
+
+    playerX = (ROOM_MIN + ROOM_MAX) / 2.0;
+    playerY = (ROOM_MIN + ROOM_MAX) / 2.0;
+
+    // Gets the distance field for the new map built before anything is timed
+    Update();
+
+    std::cout << "total_sprites,sprites_after_cull,threads,grid_build_ms,sprite_ms,ms_per_frame" << std::endl;
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    int outside = 0;
+
+    for (size_t t = 0; t < sizeof(TOTALS) / sizeof(TOTALS[0]); t++)
+    {
+        AddSprites(TOTALS[t] - outside, false, rng);
+        outside = TOTALS[t];
+
+        // The first frame rebuilds the grid
+        Uint64 buildStart = SDL_GetPerformanceCounter();
+        Update();
+        double buildMs = (double)(SDL_GetPerformanceCounter() - buildStart) * 1000 / frequency;
+        Draw();
+
+        double totalTime = 0;
+        double spriteTime = 0;
+        Uint64 visible = 0;
+
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            playerRot = TWO_PI * frame / frameCount;
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            Update();
+            Draw();
+            Uint64 end = SDL_GetPerformanceCounter();
+
+            totalTime += (double)(end - start) * 1000 / frequency;
+            spriteTime += frameStats.spriteMs;
+            visible += frameStats.spritesVisible;
+        }
+
+        std::cout << roomSprites + outside << "," << visible / frameCount << "," << GetRenderThreads() << ","
+            << buildMs << "," << spriteTime / frameCount << "," << totalTime / frameCount << std::endl;
+    }
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    return 0;
+}
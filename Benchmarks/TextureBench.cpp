@@ -0,0 +1,109 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include <algorithm>
+#include <string>
+
+// Textured against flat shaded walls. Renders the same frames from a few spots on
+// the built-in map, once with flat colored walls and a black ceiling and floor and
+// once with everything textured, and prints the cost per frame of both as CSV on stdout. The spots go from walls
+// filling the screen to walls far across the room, so the strips use every mip level.
+//
+// Usage: raycaster_texbench [--frames N] [--threads N] [--tracer scalar|sse2|avx2] [--caster dda|angle] [--atlas file.bmp]
+
+struct BenchView
+{
+    const char* name;
+    double x;
+    double y;
+    double rot; // Degrees, the camera sweeps 20 degrees either side of it
+};
+
+static const BenchView VIEWS[] =
+{
+    { "close", 12.5, 12.3, 270 },
+    { "near", 14.5, 14.0, 270 },
+    { "far", 14.5, 27.5, 270 },
+    { "corner", 27.5, 27.5, 225 }
+};
+
+struct BenchResult
+{
+    double frameMs;
+    double rasterMs;
+};
+
+static BenchResult RenderView(const BenchView& view, int frameCount, bool textured)
+{
+    texturedWalls = textured;
+    texturedFloors = textured;
+    playerX = view.x;
+    playerY = view.y;
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    double totalTime = 0;
+    double rasterTime = 0;
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        double sweep = 20 * sin(frame * TWO_PI / frameCount);
+        playerRot = fmod(Rad(view.rot + sweep) + TWO_PI, TWO_PI);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        Update();
+        Uint64 cast = SDL_GetPerformanceCounter();
+        Draw();
+        Uint64 end = SDL_GetPerformanceCounter();
+
+        totalTime += (double)(end - start) * 1000 / frequency;
+        rasterTime += (double)(end - cast) * 1000 / frequency;
+    }
+
+    BenchResult result;
+    result.frameMs = totalTime / frameCount;
+    result.rasterMs = rasterTime / frameCount;
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int frameCount = 300;
+
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--frames" && hasValue)
+        {
+            frameCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (!ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--threads N] [--tracer scalar|sse2|avx2] [--caster dda|angle] [--atlas file.bmp]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "view,threads,tracer,flat_ms,textured_ms,flat_raster_ms,textured_raster_ms,textured_over_flat" << std::endl;
+
+    for (size_t v = 0; v < sizeof(VIEWS) / sizeof(VIEWS[0]); v++)
+    {
+        // One untimed pass first, so both modes start with warm caches
+        RenderView(VIEWS[v], std::min(frameCount, 30), true);
+
+        BenchResult flat = RenderView(VIEWS[v], frameCount, false);
+        BenchResult textured = RenderView(VIEWS[v], frameCount, true);
+
+        std::cout << VIEWS[v].name << "," << GetRenderThreads() << "," << GetRayTracerName(GetRayTracer()) << ","
+            << flat.frameMs << "," << textured.frameMs << "," << flat.rasterMs << "," << textured.rasterMs << ","
+            << textured.frameMs / flat.frameMs << std::endl;
+    }
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    return 0;
+}
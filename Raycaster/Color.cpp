@@ -1,18 +1,5 @@
 #include "Color.hpp"
 
-Color::Color()
-{
-    Color(0, 0, 0, 255);
-}
-
-Color::Color(const byte& red, const byte& green, const byte& blue) :
-    m_red(red),
-    m_green(green),
-    m_blue(blue)
-{
-    Color(red, green, blue, 255);
-}
-
 Color::Color(const byte& red, const byte& green, const byte& blue, const byte& alpha) :
     m_red(red),
     m_green(green),
@@ -59,4 +46,9 @@ void Color::SetA(const byte& val)
 byte Color::GetA() const
 {
     return m_alpha;
+}
+
+Pixel Color::GetPacked() const
+{
+    return MakePixel(m_red, m_green, m_blue, m_alpha);
 }
\ No newline at end of file
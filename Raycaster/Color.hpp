@@ -1,13 +1,13 @@
 #pragma once
 
 #include "PCH.hpp"
+#include "Pixel.hpp"
 
 class Color
 {
     public:
-        Color();
-        Color(const byte& red, const byte& green, const byte& blue);
-        Color(const byte& red, const byte& green, const byte& blue, const byte& alpha);
+        // Opaque black unless told otherwise
+        Color(const byte& red = 0, const byte& green = 0, const byte& blue = 0, const byte& alpha = 255);
 
         void SetR(const byte& val);
         byte GetR() const;
@@ -18,6 +18,9 @@ class Color
         void SetA(const byte& val);
         byte GetA() const;
 
+        // The color as one SDL_PIXELFORMAT_RGBA8888 pixel
+        Pixel GetPacked() const;
+
     private:
         byte m_red;
         byte m_green;
@@ -0,0 +1,277 @@
+#include "DisplayList.hpp"
+#include "Pixel.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+
+#ifdef RAYCASTER_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+void ResizeDisplayList(DisplayList& list, int width, int height)
+{
+    list.width = width;
+    list.height = height;
+    list.wallStart.resize(width);
+    list.wallEnd.resize(width);
+    list.wallColor.resize(width);
+    list.wallTexels.resize(width);
+    list.wallTexV.resize(width);
+    list.wallTexStep.resize(width);
+    list.wallTexMask.resize(width);
+    list.surfaceRows.resize(height);
+
+    for (int x = 0; x < width; x++)
+    {
+        SetEmptyColumn(list, x);
+    }
+
+    SetFlatSurfaces(list);
+}
+
+void SetColumnSpan(DisplayList& list, int x, int wallStart, int wallEnd, Uint32 wallColor)
+{
+    list.wallStart[x] = wallStart;
+    list.wallEnd[x] = wallEnd;
+    list.wallColor[x] = wallColor;
+    list.wallTexels[x] = nullptr;
+}
+
+void SetTexturedSpan(DisplayList& list, int x, int wallStart, int wallEnd, const Uint32* texels, Uint32 texV, Uint32 texStep, Uint32 texMask)
+{
+    list.wallStart[x] = wallStart;
+    list.wallEnd[x] = wallEnd;
+    list.wallColor[x] = 0;
+    list.wallTexels[x] = texels;
+    list.wallTexV[x] = texV;
+    list.wallTexStep[x] = texStep;
+    list.wallTexMask[x] = texMask;
+}
+
+void SetEmptyColumn(DisplayList& list, int x)
+{
+    // Ceiling down to the horizon, floor from there on
+    list.wallStart[x] = list.height / 2;
+    list.wallEnd[x] = list.height / 2 - 1;
+    list.wallColor[x] = 0;
+    list.wallTexels[x] = nullptr;
+}
+
+void SetSurfaceRow(DisplayList& list, int y, const SurfaceRow& row)
+{
+    list.surfaceRows[y] = row;
+}
+
+void SetFlatSurfaces(DisplayList& list)
+{
+    SurfaceRow flat = {};
+    for (int y = 0; y < list.height; y++)
+    {
+        list.surfaceRows[y] = flat;
+    }
+}
+
+// Per-thread totals, padded so threads don't share a cache line
+struct ThreadRasterStats
+{
+    RasterStats stats;
+    Uint64 padding[6];
+};
+
+RasterStats RasterizeDisplayList(const DisplayList& list, Uint32* target, int pitch, ThreadPool* pool)
+{
+    int tilesX = (list.width + SCREEN_TILE_WIDTH - 1) / SCREEN_TILE_WIDTH;
+    int tilesY = (list.height + SCREEN_TILE_HEIGHT - 1) / SCREEN_TILE_HEIGHT;
+
+    std::vector<ThreadRasterStats> threadStats(pool ? pool->GetThreadCount() : 1);
+
+    auto rasterizeTiles = [&](int begin, int end, int thread)
+    {
+        for (int tile = begin; tile < end; tile++)
+        {
+            int x0 = (tile % tilesX) * SCREEN_TILE_WIDTH;
+            int y0 = (tile / tilesX) * SCREEN_TILE_HEIGHT;
+            int x1 = std::min(x0 + SCREEN_TILE_WIDTH, list.width);
+            int y1 = std::min(y0 + SCREEN_TILE_HEIGHT, list.height);
+
+            RasterizeTile(list, target, pitch, x0, y0, x1, y1, threadStats[thread].stats);
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(tilesX * tilesY, 1, rasterizeTiles);
+    }
+    else
+    {
+        rasterizeTiles(0, tilesX * tilesY, 0);
+    }
+
+    RasterStats stats = {};
+    for (size_t i = 0; i < threadStats.size(); i++)
+    {
+        stats.wallTicks += threadStats[i].stats.wallTicks;
+        stats.surfaceTicks += threadStats[i].stats.surfaceTicks;
+    }
+
+    return stats;
+}
+
+// Column by column, so a textured wall reads its texels in order, one after the other
+static void RasterizeWalls(const DisplayList& list, Uint32* target, int pitch, int x0, int y0, int x1, int y1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        int start = std::max(list.wallStart[x], y0);
+        int end = std::min(list.wallEnd[x], y1 - 1);
+        Uint32* pixel = target + (size_t)start * pitch + x;
+
+        const Uint32* texels = list.wallTexels[x];
+        if (texels)
+        {
+            Uint32 step = list.wallTexStep[x];
+            Uint32 mask = list.wallTexMask[x];
+            Uint32 v = list.wallTexV[x] + (Uint32)start * step;
+
+            for (int y = start; y <= end; y++, pixel += pitch)
+            {
+                *pixel = texels[(v >> 16) & mask];
+                v += step;
+            }
+        }
+        else
+        {
+            FillVerticalSpan(pixel, pitch, end - start + 1, list.wallColor[x]);
+        }
+    }
+}
+
+// Row by row, everything the walls left uncovered
+static void RasterizeSurfaces(const DisplayList& list, Uint32* target, int pitch, int x0, int y0, int x1, int y1)
+{
+    const int* wallStart = list.wallStart.data();
+    const int* wallEnd = list.wallEnd.data();
+
+    // Rows between maxStart and minEnd are wall in every column of the tile, and
+    // rows outside minStart to maxEnd don't have any wall in them
+    int minStart = wallStart[x0];
+    int maxStart = wallStart[x0];
+    int minEnd = wallEnd[x0];
+    int maxEnd = wallEnd[x0];
+    for (int x = x0 + 1; x < x1; x++)
+    {
+        minStart = std::min(minStart, wallStart[x]);
+        maxStart = std::max(maxStart, wallStart[x]);
+        minEnd = std::min(minEnd, wallEnd[x]);
+        maxEnd = std::max(maxEnd, wallEnd[x]);
+    }
+
+    for (int y = y0; y < y1; y++)
+    {
+        if (y >= maxStart && y <= minEnd)
+        {
+            continue;
+        }
+
+        // Only pixels outside the wall spans get written
+        bool masked = (y >= minStart && y <= maxEnd);
+
+        Uint32* row = target + (size_t)y * pitch;
+        const SurfaceRow& surface = list.surfaceRows[y];
+        const Uint32* texels = surface.texels;
+        Uint32 color = (y < list.height / 2) ? list.ceilingColor : list.floorColor;
+        Uint32 texMask = (1u << surface.levelShift) - 1;
+        int x = x0;
+
+        // A flat row with no wall in it is one span
+        if (!texels && !masked)
+        {
+            FillSpan(row + x0, x1 - x0, color);
+            continue;
+        }
+
+#ifdef RAYCASTER_HAVE_SSE2
+        // Four pixels per store. The texel coordinates and addresses are worked out
+        // four at a time, then the texels are fetched one by one.
+        const __m128i rowY = _mm_set1_epi32(y);
+        const __m128i mask = _mm_set1_epi32((int)texMask);
+        const __m128i shift = _mm_cvtsi32_si128(surface.levelShift);
+        const __m128i du = _mm_set1_epi32((int)(surface.du * 4));
+        const __m128i dv = _mm_set1_epi32((int)(surface.dv * 4));
+        const __m128i flatColor = _mm_set1_epi32((int)color);
+
+        Uint32 u0 = surface.u + (Uint32)x0 * surface.du;
+        Uint32 v0 = surface.v + (Uint32)x0 * surface.dv;
+        __m128i texU = _mm_setr_epi32((int)u0, (int)(u0 + surface.du), (int)(u0 + surface.du * 2), (int)(u0 + surface.du * 3));
+        __m128i texV = _mm_setr_epi32((int)v0, (int)(v0 + surface.dv), (int)(v0 + surface.dv * 2), (int)(v0 + surface.dv * 3));
+
+        for (; x + 4 <= x1; x += 4)
+        {
+            __m128i pixels = flatColor;
+            if (texels)
+            {
+                __m128i column = _mm_and_si128(_mm_srli_epi32(texU, 16), mask);
+                __m128i texelRow = _mm_and_si128(_mm_srli_epi32(texV, 16), mask);
+                __m128i index = _mm_or_si128(_mm_sll_epi32(column, shift), texelRow);
+
+                alignas(16) Uint32 indices[4];
+                _mm_store_si128((__m128i*)indices, index);
+                pixels = _mm_setr_epi32((int)texels[indices[0]], (int)texels[indices[1]], (int)texels[indices[2]], (int)texels[indices[3]]);
+
+                texU = _mm_add_epi32(texU, du);
+                texV = _mm_add_epi32(texV, dv);
+            }
+
+            // The target is never read back, it may be a locked texture that is slow
+            // to read. Where the wall covers some of the four pixels, only the others
+            // are written, one at a time.
+            if (masked)
+            {
+                __m128i start = _mm_loadu_si128((const __m128i*)(wallStart + x));
+                __m128i end = _mm_loadu_si128((const __m128i*)(wallEnd + x));
+                __m128i open = _mm_or_si128(_mm_cmpgt_epi32(start, rowY), _mm_cmpgt_epi32(rowY, end));
+                int openMask = _mm_movemask_ps(_mm_castsi128_ps(open));
+                if (openMask != 0xF)
+                {
+                    alignas(16) Uint32 lanes[4];
+                    _mm_store_si128((__m128i*)lanes, pixels);
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        if ((openMask >> lane) & 1)
+                        {
+                            row[x + lane] = lanes[lane];
+                        }
+                    }
+
+                    continue;
+                }
+            }
+
+            _mm_storeu_si128((__m128i*)(row + x), pixels);
+        }
+#endif
+
+        Uint32 u = surface.u + (Uint32)x * surface.du;
+        Uint32 v = surface.v + (Uint32)x * surface.dv;
+        for (; x < x1; x++, u += surface.du, v += surface.dv)
+        {
+            if (masked && y >= wallStart[x] && y <= wallEnd[x])
+            {
+                continue;
+            }
+
+            row[x] = texels ? texels[(((u >> 16) & texMask) << surface.levelShift) | ((v >> 16) & texMask)] : color;
+        }
+    }
+}
+
+void RasterizeTile(const DisplayList& list, Uint32* target, int pitch, int x0, int y0, int x1, int y1, RasterStats& stats)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+    RasterizeWalls(list, target, pitch, x0, y0, x1, y1);
+    Uint64 walls = SDL_GetPerformanceCounter();
+    RasterizeSurfaces(list, target, pitch, x0, y0, x1, y1);
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    stats.wallTicks += walls - start;
+    stats.surfaceTicks += end - walls;
+}
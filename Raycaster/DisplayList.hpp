@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "ThreadPool.hpp"
+
+// The ceiling or floor across one screen row. Rows above the middle of the screen
+// are ceiling and the rest are floor, and every point on a row is the same distance
+// away, so texel coordinates change by the same amount from one column to the next.
+// They're 16.16 fixed point, in texels of the row's mip level: (u, v) at column 0
+// and (du, dv) more per column.
+struct SurfaceRow
+{
+    const Uint32* texels; // A whole mip level, column by column. Null for a flat color.
+    int levelShift; // log2 of the level's width and height
+    Uint32 u;
+    Uint32 v;
+    Uint32 du;
+    Uint32 dv;
+};
+
+// What the casting pass leaves for the rasterizer: one span record per screen
+// column. Rows [0, wallStart) are ceiling, [wallStart, wallEnd] are wall and
+// (wallEnd, height) are floor. A column with no wall has wallEnd < wallStart.
+//
+// A textured wall reads its pixels from a column of texels instead of wallColor.
+// Its texel row is a 16.16 fixed point number, wallTexV at screen row 0 and
+// wallTexStep more on every row down, wrapped by wallTexMask.
+//
+// The records are kept as one array per field, so the rasterizer can load
+// several neighbouring columns at once. Ceiling and floor are one record per
+// row, in ceilingColor and floorColor unless the row is textured.
+struct DisplayList
+{
+    int width;
+    int height;
+    Uint32 ceilingColor;
+    Uint32 floorColor;
+
+    std::vector<int> wallStart;
+    std::vector<int> wallEnd;
+    std::vector<Uint32> wallColor;
+    std::vector<const Uint32*> wallTexels; // Null for a flat colored wall
+    std::vector<Uint32> wallTexV;
+    std::vector<Uint32> wallTexStep;
+    std::vector<Uint32> wallTexMask;
+
+    std::vector<SurfaceRow> surfaceRows;
+};
+
+// Screen tiles the rasterizer fills one at a time: the wall spans column by
+// column, then the ceiling and floor row by row
+const int SCREEN_TILE_WIDTH = 64;
+const int SCREEN_TILE_HEIGHT = 32;
+
+// Performance counter ticks the rasterizer spent on each pass, summed over its threads
+struct RasterStats
+{
+    Uint64 wallTicks;
+    Uint64 surfaceTicks;
+};
+
+void ResizeDisplayList(DisplayList& list, int width, int height);
+void SetColumnSpan(DisplayList& list, int x, int wallStart, int wallEnd, Uint32 wallColor);
+void SetTexturedSpan(DisplayList& list, int x, int wallStart, int wallEnd, const Uint32* texels, Uint32 texV, Uint32 texStep, Uint32 texMask);
+void SetEmptyColumn(DisplayList& list, int x);
+void SetSurfaceRow(DisplayList& list, int y, const SurfaceRow& row);
+void SetFlatSurfaces(DisplayList& list);
+
+// Fills a width x height framebuffer of packed RGBA8888 pixels, pitch pixels
+// apart from one row to the next. Tiles are spread over the pool's threads
+// when there is one.
+RasterStats RasterizeDisplayList(const DisplayList& list, Uint32* target, int pitch, ThreadPool* pool);
+void RasterizeTile(const DisplayList& list, Uint32* target, int pitch, int x0, int y0, int x1, int y1, RasterStats& stats);
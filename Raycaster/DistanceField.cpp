@@ -0,0 +1,199 @@
+#include "DistanceField.hpp"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+DistanceField::DistanceField() :
+    m_width(0),
+    m_height(0),
+    m_chunkShift(0),
+    m_chunksX(0)
+{
+}
+
+// Two passes with all 8 neighbours one step away give the exact chessboard distance,
+// from the walls and from whatever each cell starts out at
+static void ChessboardPasses(unsigned char* rows, int width, int height)
+{
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char* row = rows + (size_t)y * width;
+        const unsigned char* above = (y > 0) ? row - width : nullptr;
+
+        for (int x = 0; x < width; x++)
+        {
+            int d = row[x];
+            if (x > 0)
+            {
+                d = std::min(d, row[x - 1] + 1);
+            }
+            if (above)
+            {
+                d = std::min(d, above[x] + 1);
+                if (x > 0)
+                {
+                    d = std::min(d, above[x - 1] + 1);
+                }
+                if (x + 1 < width)
+                {
+                    d = std::min(d, above[x + 1] + 1);
+                }
+            }
+            row[x] = (unsigned char)d;
+        }
+    }
+
+    for (int y = height - 1; y >= 0; y--)
+    {
+        unsigned char* row = rows + (size_t)y * width;
+        const unsigned char* below = (y + 1 < height) ? row + width : nullptr;
+
+        for (int x = width - 1; x >= 0; x--)
+        {
+            int d = row[x];
+            if (x + 1 < width)
+            {
+                d = std::min(d, row[x + 1] + 1);
+            }
+            if (below)
+            {
+                d = std::min(d, below[x] + 1);
+                if (x > 0)
+                {
+                    d = std::min(d, below[x - 1] + 1);
+                }
+                if (x + 1 < width)
+                {
+                    d = std::min(d, below[x + 1] + 1);
+                }
+            }
+            row[x] = (unsigned char)d;
+        }
+    }
+}
+
+void DistanceField::Build(const Map& map)
+{
+    m_width = map.GetWidth();
+    m_height = map.GetHeight();
+    m_chunkShift = map.GetChunkShift();
+
+    // Worked out in plain rows, then copied into chunks
+    std::vector<unsigned char> rows((size_t)m_width * m_height);
+
+    // Walls are 0, open cells start at their distance to the edge of the map
+    for (int y = 0; y < m_height; y++)
+    {
+        unsigned char* row = &rows[(size_t)y * m_width];
+        int edgeY = std::min(y + 1, m_height - y);
+
+        for (int x = 0; x < m_width; x++)
+        {
+            int edge = std::min(std::min(x + 1, m_width - x), edgeY);
+            row[x] = (map.GetTile(x, y) > 0) ? 0 : (unsigned char)std::min(edge, 255);
+        }
+    }
+
+    ChessboardPasses(rows.data(), m_width, m_height);
+
+    int chunkSize = 1 << m_chunkShift;
+    m_chunksX = (m_width + chunkSize - 1) >> m_chunkShift;
+    int chunksY = (m_height + chunkSize - 1) >> m_chunkShift;
+    m_cells.assign(((size_t)m_chunksX * chunksY << (2 * m_chunkShift)) + MAP_PADDING, 0);
+
+    for (int y = 0; y < m_height; y++)
+    {
+        const unsigned char* row = &rows[(size_t)y * m_width];
+        for (int x = 0; x < m_width; x += chunkSize)
+        {
+            // One run per chunk the row passes through
+            memcpy(&m_cells[GetIndex(x, y)], row + x, std::min(chunkSize, m_width - x));
+        }
+    }
+}
+
+void DistanceField::UpdateTile(const Map& map, int x, int y)
+{
+    // A cell's distance only depends on the walls up to 255 cells away, so only the
+    // cells nearer than that to the tile can change. The ring of cells 255 away is
+    // kept as it is, and carries the distances to the walls further out.
+    const int reach = 255;
+    int x0 = std::max(x - reach, 0);
+    int y0 = std::max(y - reach, 0);
+    int x1 = std::min(x + reach, m_width - 1);
+    int y1 = std::min(y + reach, m_height - 1);
+    int width = x1 - x0 + 1;
+    int height = y1 - y0 + 1;
+
+    std::vector<unsigned char> rows((size_t)width * height);
+    for (int cellY = y0; cellY <= y1; cellY++)
+    {
+        unsigned char* row = &rows[(size_t)(cellY - y0) * width];
+        int edgeY = std::min(cellY + 1, m_height - cellY);
+
+        for (int cellX = x0; cellX <= x1; cellX++)
+        {
+            int edge = std::min(std::min(cellX + 1, m_width - cellX), edgeY);
+            if (std::max(abs(cellX - x), abs(cellY - y)) == reach)
+            {
+                row[cellX - x0] = (unsigned char)Get(cellX, cellY);
+            }
+            else
+            {
+                row[cellX - x0] = (map.GetTile(cellX, cellY) > 0) ? 0 : (unsigned char)std::min(edge, 255);
+            }
+        }
+    }
+
+    ChessboardPasses(rows.data(), width, height);
+
+    for (int cellY = y0; cellY <= y1; cellY++)
+    {
+        const unsigned char* row = &rows[(size_t)(cellY - y0) * width];
+        for (int cellX = x0; cellX <= x1; cellX++)
+        {
+            m_cells[GetIndex(cellX, cellY)] = row[cellX - x0];
+        }
+    }
+}
+
+size_t DistanceField::GetIndex(int x, int y) const
+{
+    int mask = (1 << m_chunkShift) - 1;
+    size_t chunk = (size_t)(y >> m_chunkShift) * m_chunksX + (x >> m_chunkShift);
+
+    return (chunk << (2 * m_chunkShift)) + ((size_t)(y & mask) << m_chunkShift) + (x & mask);
+}
+
+void DistanceField::Clear()
+{
+    m_width = 0;
+    m_height = 0;
+    m_chunksX = 0;
+    std::vector<unsigned char>().swap(m_cells);
+}
+
+bool DistanceField::IsBuilt() const
+{
+    return !m_cells.empty();
+}
+
+int DistanceField::GetWidth() const
+{
+    return m_width;
+}
+
+int DistanceField::GetHeight() const
+{
+    return m_height;
+}
+
+int DistanceField::Get(int x, int y) const
+{
+    return m_cells[GetIndex(x, y)];
+}
+
+const unsigned char* DistanceField::GetCells() const
+{
+    return m_cells.empty() ? nullptr : m_cells.data();
+}
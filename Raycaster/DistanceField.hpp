@@ -0,0 +1,53 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "Map.hpp"
+
+// Whether the DDA caster jumps across open space with a distance field built from
+// the map. Auto only does it on maps big enough for it to pay off.
+enum SkipMode
+{
+    SKIP_AUTO,
+    SKIP_ON,
+    SKIP_OFF
+};
+
+const int SKIP_AUTO_MIN_TILES = 128 * 128;
+
+// The Chebyshev distance from every cell of a map to the nearest wall, counting
+// everything outside the map as wall, clamped to 255. A cell at distance d only
+// has open cells within d - 1 of it on either axis, so a ray can cross all of
+// them in one jump.
+//
+// Stored one byte per cell in the same chunks as the map's tiles, so looking it
+// up touches the same pages the walk would, with MAP_PADDING bytes after the last
+// chunk so the packet tracers can read it 4 bytes at a time.
+class DistanceField
+{
+public:
+    DistanceField();
+
+    void Build(const Map& map);
+
+    // Brings the field up to date after one tile of the map changed, without
+    // going over the whole map again
+    void UpdateTile(const Map& map, int x, int y);
+
+    void Clear();
+
+    bool IsBuilt() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int Get(int x, int y) const;
+    const unsigned char* GetCells() const;
+
+private:
+    size_t GetIndex(int x, int y) const;
+
+    int m_width;
+    int m_height;
+    int m_chunkShift;
+    int m_chunksX;
+    std::vector<unsigned char> m_cells;
+};
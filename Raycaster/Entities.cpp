@@ -0,0 +1,260 @@
+#include "Entities.hpp"
+#include <algorithm>
+
+// Contacts handled in one move before the rest of it is given up
+static const int MAX_CONTACTS = 4;
+
+// How far a circle is kept off a wall it touched, so the next sweep doesn't start in it
+static const double CONTACT_GAP = 1e-6;
+
+static bool IsSolid(const Map& map, int x, int y)
+{
+    return !map.IsInside(x, y) || map.GetTile(x, y) != 0;
+}
+
+// Whether the circle touches the tile before time, the fraction of the move found
+// so far. If so, time becomes when, and the normal points out of the tile there.
+static bool SweepTile(double x, double y, double radius, double moveX, double moveY, int tileX, int tileY, double& time, double& normalX, double& normalY)
+{
+    double nearX = std::min(std::max(x, (double)tileX), (double)tileX + 1);
+    double nearY = std::min(std::max(y, (double)tileY), (double)tileY + 1);
+    double offsetX = x - nearX;
+    double offsetY = y - nearY;
+    double distanceSquared = offsetX * offsetX + offsetY * offsetY;
+
+    if (distanceSquared < radius * radius)
+    {
+        // Already overlapping, so only moving further in is stopped, at once.
+        // A center inside the tile is let out whichever way it goes.
+        double distance = sqrt(distanceSquared);
+        if (distance == 0 || offsetX * moveX + offsetY * moveY >= 0)
+        {
+            return false;
+        }
+
+        time = 0;
+        normalX = offsetX / distance;
+        normalY = offsetY / distance;
+        return true;
+    }
+
+    // The center hits the tile grown by the radius, with rounded corners: a face
+    // pushed out by the radius, or a circle around a corner
+    bool hit = false;
+
+    if (moveX != 0)
+    {
+        double faceX = (moveX > 0) ? tileX - radius : tileX + 1 + radius;
+        double t = (faceX - x) / moveX;
+        double hitY = y + moveY * t;
+        if (t >= 0 && t < time && hitY >= tileY && hitY <= tileY + 1)
+        {
+            time = t;
+            normalX = (moveX > 0) ? -1 : 1;
+            normalY = 0;
+            hit = true;
+        }
+    }
+
+    if (moveY != 0)
+    {
+        double faceY = (moveY > 0) ? tileY - radius : tileY + 1 + radius;
+        double t = (faceY - y) / moveY;
+        double hitX = x + moveX * t;
+        if (t >= 0 && t < time && hitX >= tileX && hitX <= tileX + 1)
+        {
+            time = t;
+            normalX = 0;
+            normalY = (moveY > 0) ? -1 : 1;
+            hit = true;
+        }
+    }
+
+    double a = moveX * moveX + moveY * moveY;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        double cornerX = tileX + (corner & 1);
+        double cornerY = tileY + (corner >> 1);
+        double toX = x - cornerX;
+        double toY = y - cornerY;
+
+        // |to + move * t| = radius, entered only while moving towards the corner
+        double b = toX * moveX + toY * moveY;
+        if (b >= 0)
+        {
+            continue;
+        }
+
+        double discriminant = b * b - a * (toX * toX + toY * toY - radius * radius);
+        if (discriminant < 0)
+        {
+            continue;
+        }
+
+        double t = (-b - sqrt(discriminant)) / a;
+        if (t >= 0 && t < time)
+        {
+            time = t;
+            normalX = (toX + moveX * t) / radius;
+            normalY = (toY + moveY * t) / radius;
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+// The first solid tile the circle touches on the move, if any, as a fraction of it
+static bool SweepCircle(const Map& map, double x, double y, double radius, double moveX, double moveY, double& time, double& normalX, double& normalY)
+{
+    int left = (int)floor(std::min(x, x + moveX) - radius);
+    int right = (int)floor(std::max(x, x + moveX) + radius);
+    int top = (int)floor(std::min(y, y + moveY) - radius);
+    int bottom = (int)floor(std::max(y, y + moveY) + radius);
+
+    time = 1;
+    bool hit = false;
+    for (int tileY = top; tileY <= bottom; tileY++)
+    {
+        for (int tileX = left; tileX <= right; tileX++)
+        {
+            if (IsSolid(map, tileX, tileY) && SweepTile(x, y, radius, moveX, moveY, tileX, tileY, time, normalX, normalY))
+            {
+                hit = true;
+            }
+        }
+    }
+
+    return hit;
+}
+
+bool MoveCircle(const Map& map, double radius, WallResponse response, double& x, double& y, double& velX, double& velY, double time)
+{
+    bool touched = false;
+    for (int contact = 0; contact < MAX_CONTACTS && time > 0; contact++)
+    {
+        double moveX = velX * time;
+        double moveY = velY * time;
+
+        double hitTime;
+        double normalX;
+        double normalY;
+        if (!SweepCircle(map, x, y, radius, moveX, moveY, hitTime, normalX, normalY))
+        {
+            x += moveX;
+            y += moveY;
+            return touched;
+        }
+
+        touched = true;
+        x += moveX * hitTime + normalX * CONTACT_GAP;
+        y += moveY * hitTime + normalY * CONTACT_GAP;
+        time *= 1 - hitTime;
+
+        if (response == WALL_STOP)
+        {
+            velX = 0;
+            velY = 0;
+            return true;
+        }
+
+        // Sliding takes away the velocity into the wall, bouncing turns it round
+        double into = velX * normalX + velY * normalY;
+        double scale = (response == WALL_BOUNCE) ? 2 : 1;
+        velX -= normalX * into * scale;
+        velY -= normalY * into * scale;
+    }
+
+    return touched;
+}
+
+Entities::Entities()
+{
+}
+
+int Entities::Add(double x, double y, double velX, double velY, double radius, WallResponse response)
+{
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_velX.push_back(velX);
+    m_velY.push_back(velY);
+    m_radius.push_back(radius);
+    m_response.push_back((byte)response);
+    m_wallHit.push_back(0);
+    return (int)m_x.size() - 1;
+}
+
+void Entities::Clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_velX.clear();
+    m_velY.clear();
+    m_radius.clear();
+    m_response.clear();
+    m_wallHit.clear();
+}
+
+int Entities::GetCount() const
+{
+    return (int)m_x.size();
+}
+
+void Entities::Update(const Map& map, double time, ThreadPool* pool)
+{
+    if (pool)
+    {
+        pool->ParallelFor(GetCount(), ENTITY_CHUNK_SIZE, [&](int begin, int end, int)
+        {
+            UpdateRange(map, time, begin, end);
+        });
+    }
+    else
+    {
+        UpdateRange(map, time, 0, GetCount());
+    }
+}
+
+void Entities::UpdateRange(const Map& map, double time, int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+    {
+        m_wallHit[i] = MoveCircle(map, m_radius[i], (WallResponse)m_response[i], m_x[i], m_y[i], m_velX[i], m_velY[i], time);
+    }
+}
+
+void Entities::SetVelocity(int index, double velX, double velY)
+{
+    m_velX[index] = velX;
+    m_velY[index] = velY;
+}
+
+const double* Entities::GetX() const
+{
+    return m_x.data();
+}
+
+const double* Entities::GetY() const
+{
+    return m_y.data();
+}
+
+const double* Entities::GetVelX() const
+{
+    return m_velX.data();
+}
+
+const double* Entities::GetVelY() const
+{
+    return m_velY.data();
+}
+
+const double* Entities::GetRadius() const
+{
+    return m_radius.data();
+}
+
+const byte* Entities::GetWallHits() const
+{
+    return m_wallHit.data();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "Map.hpp"
+#include "ThreadPool.hpp"
+
+// What a circle does when it runs into a wall
+enum WallResponse
+{
+    WALL_SLIDE, // Keeps the part of its motion along the wall
+    WALL_BOUNCE, // Reflects its velocity off the wall
+    WALL_STOP // Stops where it touched
+};
+
+// Moves a circle time seconds along its velocity, sweeping it against the map so
+// it stops at the first solid tile it would overlap, however far it goes in one
+// step. Tiles outside the map count as solid. After a contact the velocity changes
+// as the response says and what's left of the move carries on, up to a few
+// contacts. A circle already overlapping a wall can only move out of it.
+// Returns whether it touched a wall.
+bool MoveCircle(const Map& map, double radius, WallResponse response, double& x, double& y, double& velX, double& velY, double time);
+
+// Entities per ParallelFor() chunk
+const int ENTITY_CHUNK_SIZE = 2048;
+
+// Moving circles, NPCs and projectiles, kept as one array per field so an update
+// streams through just what it reads. They collide with the map, not with each other,
+// so any range of them can be updated on its own.
+class Entities
+{
+public:
+    Entities();
+
+    // Returns the new entity's index
+    int Add(double x, double y, double velX, double velY, double radius, WallResponse response);
+    void Clear();
+
+    int GetCount() const;
+
+    // Moves every entity time seconds. With a pool the entities are updated in
+    // chunks across its threads.
+    void Update(const Map& map, double time, ThreadPool* pool);
+
+    void SetVelocity(int index, double velX, double velY);
+
+    const double* GetX() const;
+    const double* GetY() const;
+    const double* GetVelX() const;
+    const double* GetVelY() const;
+    const double* GetRadius() const;
+
+    // Non-zero for the entities that touched a wall in the last Update()
+    const byte* GetWallHits() const;
+
+private:
+    void UpdateRange(const Map& map, double time, int begin, int end);
+
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_velX;
+    std::vector<double> m_velY;
+    std::vector<double> m_radius;
+    std::vector<byte> m_response; // WallResponse
+    std::vector<byte> m_wallHit;
+};
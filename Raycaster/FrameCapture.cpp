@@ -0,0 +1,315 @@
+#include "FrameCapture.hpp"
+#include <algorithm>
+#include <string.h>
+
+FrameCapture::FrameCapture() :
+    m_file(nullptr),
+    m_format(CAPTURE_Y4M),
+    m_width(0),
+    m_height(0),
+    m_active(false),
+    m_queueStart(0),
+    m_queueCount(0),
+    m_stopping(false),
+    m_failed(false),
+    m_written(0),
+    m_dropped(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+}
+
+bool FrameCapture::Start(const std::string& fileName, CaptureFormat format, int width, int height, int fps, int bufferCount)
+{
+    Stop();
+
+    if (width <= 0 || height <= 0 || fps <= 0 || bufferCount <= 0)
+    {
+        return false;
+    }
+
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        return false;
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+
+    if (format == CAPTURE_Y4M)
+    {
+        fprintf(m_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, fps);
+        m_output.resize((size_t)width * height + (size_t)2 * ((width + 1) / 2) * ((height + 1) / 2));
+    }
+    else
+    {
+        m_output.resize((size_t)width * height * 4);
+    }
+
+    m_sourceX.resize(width);
+
+    m_buffers.resize(bufferCount);
+    m_free.clear();
+    for (int i = 0; i < bufferCount; i++)
+    {
+        m_buffers[i].pixels.resize((size_t)width * height);
+        m_free.push_back(i);
+    }
+
+    m_queued.assign(bufferCount, 0);
+    m_queueStart = 0;
+    m_queueCount = 0;
+    m_stopping = false;
+    m_failed = false;
+    m_written = 0;
+    m_dropped = 0;
+
+    m_writer = std::thread(&FrameCapture::WriterLoop, this);
+    m_active = true;
+    return true;
+}
+
+void FrameCapture::Stop()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_wake.notify_one();
+    m_writer.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+    m_active = false;
+}
+
+bool FrameCapture::IsActive() const
+{
+    return m_active;
+}
+
+bool FrameCapture::Submit(const Pixel* frame, int pitch, int width, int height)
+{
+    if (!m_active)
+    {
+        return false;
+    }
+
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty() || m_failed || width > m_width || height > m_height)
+        {
+            m_dropped++;
+            return false;
+        }
+
+        index = m_free.back();
+        m_free.pop_back();
+    }
+
+    // Copied outside the lock, the writer never touches a buffer that isn't queued
+    Buffer& buffer = m_buffers[index];
+    buffer.width = width;
+    buffer.height = height;
+    for (int y = 0; y < height; y++)
+    {
+        memcpy(&buffer.pixels[(size_t)y * width], frame + (size_t)y * pitch, width * sizeof(Pixel));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued[(m_queueStart + m_queueCount) % m_queued.size()] = index;
+        m_queueCount++;
+    }
+
+    m_wake.notify_one();
+    return true;
+}
+
+int FrameCapture::GetWidth() const
+{
+    return m_width;
+}
+
+int FrameCapture::GetHeight() const
+{
+    return m_height;
+}
+
+Uint64 FrameCapture::GetFramesWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+Uint64 FrameCapture::GetFramesDropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+bool FrameCapture::HasFailed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void FrameCapture::WriterLoop()
+{
+    // The game's threads come first. The writer only needs to keep up on average,
+    // which the buffers give it time to.
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    for (;;)
+    {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_queueCount > 0 || m_stopping; });
+
+            // Stopping still writes out everything queued before it
+            if (m_queueCount == 0)
+            {
+                return;
+            }
+
+            index = m_queued[m_queueStart];
+            m_queueStart = (m_queueStart + 1) % m_queued.size();
+            m_queueCount--;
+        }
+
+        const Buffer& buffer = m_buffers[index];
+        if (m_format == CAPTURE_Y4M)
+        {
+            ConvertY4M(buffer);
+        }
+        else
+        {
+            ConvertRaw(buffer);
+        }
+
+        // The conversion is done, so the buffer can take the next frame while this one is written
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(index);
+        }
+
+        bool ok = true;
+        if (m_format == CAPTURE_Y4M)
+        {
+            ok = fputs("FRAME\n", m_file) >= 0;
+        }
+
+        ok = ok && fwrite(m_output.data(), 1, m_output.size(), m_file) == m_output.size();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok)
+        {
+            m_written++;
+        }
+        else
+        {
+            m_failed = true;
+            m_dropped++;
+        }
+    }
+}
+
+// Where row or column i of the video comes from in a frame size pixels across
+static int ScaleCoordinate(int i, int size, int videoSize)
+{
+    return (int)((Uint64)i * size / videoSize);
+}
+
+void FrameCapture::ConvertY4M(const Buffer& buffer)
+{
+    byte* lumaPlane = m_output.data();
+    int chromaWidth = (m_width + 1) / 2;
+    int chromaHeight = (m_height + 1) / 2;
+    byte* uPlane = lumaPlane + (size_t)m_width * m_height;
+    byte* vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+
+    int* sourceX = m_sourceX.data();
+    for (int x = 0; x < m_width; x++)
+    {
+        sourceX[x] = ScaleCoordinate(x, buffer.width, m_width);
+    }
+
+    // Two rows of the video at a time, so each chroma sample averages the 2x2 pixels it covers.
+    // BT.601 full range, in 8.8 fixed point.
+    for (int y = 0; y < m_height; y += 2)
+    {
+        int rowCount = std::min(2, m_height - y);
+        const Pixel* rows[2];
+        for (int r = 0; r < 2; r++)
+        {
+            int sourceY = ScaleCoordinate(std::min(y + r, m_height - 1), buffer.height, m_height);
+            rows[r] = &buffer.pixels[(size_t)sourceY * buffer.width];
+        }
+
+        byte* u = uPlane + (size_t)(y / 2) * chromaWidth;
+        byte* v = vPlane + (size_t)(y / 2) * chromaWidth;
+
+        for (int x = 0; x < m_width; x += 2)
+        {
+            int columnCount = std::min(2, m_width - x);
+            int redSum = 0;
+            int greenSum = 0;
+            int blueSum = 0;
+
+            for (int r = 0; r < 2; r++)
+            {
+                for (int c = 0; c < 2; c++)
+                {
+                    Pixel pixel = rows[std::min(r, rowCount - 1)][sourceX[x + std::min(c, columnCount - 1)]];
+                    int red = pixel >> 24;
+                    int green = (pixel >> 16) & 0xFF;
+                    int blue = (pixel >> 8) & 0xFF;
+
+                    if (r < rowCount && c < columnCount)
+                    {
+                        lumaPlane[(size_t)(y + r) * m_width + x + c] = (byte)((77 * red + 150 * green + 29 * blue + 128) >> 8);
+                    }
+
+                    redSum += red;
+                    greenSum += green;
+                    blueSum += blue;
+                }
+            }
+
+            // The sums are 4 pixels' worth, so shift out 2 more bits
+            u[x / 2] = (byte)(((-43 * redSum - 85 * greenSum + 128 * blueSum + 512) >> 10) + 128);
+            v[x / 2] = (byte)(((128 * redSum - 107 * greenSum - 21 * blueSum + 512) >> 10) + 128);
+        }
+    }
+}
+
+void FrameCapture::ConvertRaw(const Buffer& buffer)
+{
+    byte* out = m_output.data();
+    for (int y = 0; y < m_height; y++)
+    {
+        const Pixel* row = &buffer.pixels[(size_t)ScaleCoordinate(y, buffer.height, m_height) * buffer.width];
+        for (int x = 0; x < m_width; x++)
+        {
+            Pixel pixel = row[ScaleCoordinate(x, buffer.width, m_width)];
+            out[0] = (byte)(pixel >> 24);
+            out[1] = (byte)(pixel >> 16);
+            out[2] = (byte)(pixel >> 8);
+            out[3] = (byte)pixel;
+            out += 4;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Pixel.hpp"
+
+// What a capture file holds
+enum CaptureFormat
+{
+    CAPTURE_Y4M, // YUV4MPEG2, 4:2:0 full range, which ffmpeg and most players read as is
+    CAPTURE_RAW // Bare frames of R, G, B, A bytes, with nothing to say how big they are
+};
+
+// Records frames to a video file on a writer thread of its own. Submit() copies a
+// frame into one of a fixed set of buffers and returns; the writer converts it and
+// writes it out, then hands the buffer back. When the disk falls behind and every
+// buffer is still waiting to be written, frames are dropped rather than waited for.
+//
+// Frames can be any size up to the video's, and smaller ones are scaled up to it,
+// so the render resolution can change during a capture.
+class FrameCapture
+{
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Opens the file and starts the writer. The buffers are allocated here, and
+    // none after.
+    bool Start(const std::string& fileName, CaptureFormat format, int width, int height, int fps, int bufferCount);
+
+    // Writes out the frames still queued and closes the file
+    void Stop();
+
+    bool IsActive() const;
+
+    // Queues a width x height frame, pitch pixels apart from one row to the next.
+    // Returns false if it was dropped.
+    bool Submit(const Pixel* frame, int pitch, int width, int height);
+
+    int GetWidth() const;
+    int GetHeight() const;
+    Uint64 GetFramesWritten() const;
+    Uint64 GetFramesDropped() const;
+
+    // Whether a write has failed since Start(). Frames after it are dropped.
+    bool HasFailed() const;
+
+private:
+    struct Buffer
+    {
+        std::vector<Pixel> pixels;
+        int width;
+        int height;
+    };
+
+    void WriterLoop();
+
+    // Fills m_output with the buffer's frame in the file's format
+    void ConvertY4M(const Buffer& buffer);
+    void ConvertRaw(const Buffer& buffer);
+
+    FILE* m_file;
+    CaptureFormat m_format;
+    int m_width;
+    int m_height;
+    bool m_active;
+
+    std::vector<Buffer> m_buffers;
+    std::vector<byte> m_output; // The writer's converted frame
+    std::vector<int> m_sourceX; // The frame column each video column comes from
+
+    // Both guarded by m_mutex. m_queued is a ring of buffer indices in submission order.
+    std::vector<int> m_free;
+    std::vector<int> m_queued;
+    int m_queueStart;
+    int m_queueCount;
+
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping;
+    bool m_failed;
+    Uint64 m_written;
+    Uint64 m_dropped;
+};
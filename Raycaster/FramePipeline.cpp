@@ -0,0 +1,112 @@
+#include "FramePipeline.hpp"
+#include <chrono>
+
+// Polls before the waiting thread goes to sleep, enough to cover a frame that's
+// nearly done without burning a core on one that isn't
+static const int WAIT_SPINS = 200;
+static const int WAIT_SLEEP_US = 100;
+
+FramePipeline::FramePipeline(int slotCount, int maxWidth, int maxHeight, const RenderFunction& render) :
+    m_slots(slotCount),
+    m_render(render),
+    m_toRender(slotCount),
+    m_rendered(slotCount),
+    m_stopping(false)
+{
+    for (size_t i = 0; i < m_slots.size(); i++)
+    {
+        m_slots[i].pixels.resize((size_t)maxWidth * maxHeight);
+        m_slots[i].width = 0;
+        m_slots[i].height = 0;
+        m_slots[i].workTicks = 0;
+        m_slots[i].bytesMoved = 0;
+    }
+
+    m_thread = std::thread(&FramePipeline::RenderLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    m_stopping.store(true);
+    m_thread.join();
+}
+
+void FramePipeline::Start(const FrameInput& input)
+{
+    m_free.clear();
+    for (size_t i = 0; i < m_slots.size(); i++)
+    {
+        m_free.push_back(&m_slots[i]);
+    }
+
+    // The last one is left for the frame after the first is presented
+    for (size_t i = 1; i < m_slots.size(); i++)
+    {
+        Submit(input);
+    }
+}
+
+FrameSlot* FramePipeline::WaitForFrame()
+{
+    FrameSlot* slot = nullptr;
+    WaitPop(m_rendered, slot, m_stopping);
+    return slot;
+}
+
+bool FramePipeline::Submit(const FrameInput& input)
+{
+    if (m_free.empty())
+    {
+        return false;
+    }
+
+    FrameSlot* slot = m_free.back();
+    m_free.pop_back();
+    slot->input = input;
+
+    // There are only as many slots as the queue holds, so there's always room
+    m_toRender.Push(slot);
+    return true;
+}
+
+void FramePipeline::Release(FrameSlot* slot)
+{
+    m_free.push_back(slot);
+}
+
+int FramePipeline::GetSlotCount() const
+{
+    return (int)m_slots.size();
+}
+
+void FramePipeline::RenderLoop()
+{
+    FrameSlot* slot;
+    while (!m_stopping.load() && WaitPop(m_toRender, slot, m_stopping))
+    {
+        m_render(*slot);
+        m_rendered.Push(slot);
+    }
+}
+
+bool FramePipeline::WaitPop(SpscQueue<FrameSlot*>& queue, FrameSlot*& slot, const std::atomic<bool>& stopping)
+{
+    for (int spin = 0; !queue.Pop(slot); spin++)
+    {
+        if (stopping.load())
+        {
+            return false;
+        }
+
+        if (spin < WAIT_SPINS)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(WAIT_SLEEP_US));
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "Pixel.hpp"
+#include "SpscQueue.hpp"
+
+// The input a frame is drawn with, sampled on the main thread
+struct FrameInput
+{
+    double speed; // playerSpeed and playerDir
+    double dir;
+    bool toggleWall; // E was pressed
+    bool invalidate; // The window's contents were lost
+    double frameTime; // Seconds of simulation to run first
+    Uint64 sampledAt; // Performance counter ticks
+};
+
+// A frame buffer with the input it was drawn from and what drawing it took
+struct FrameSlot
+{
+    std::vector<Pixel> pixels; // width pixels a row
+    int width;
+    int height;
+    FrameInput input;
+    bool changed; // False when it would have been the same as the last frame, and wasn't drawn
+    Uint64 workTicks; // Simulating, updating and drawing
+    Uint64 bytesMoved;
+};
+
+// Draws frames on a render thread of its own while the main thread presents the
+// ones before them. A fixed set of slots goes round between the two through a pair
+// of lock-free queues: the main thread submits input with a free slot, the render
+// thread draws into it and hands it back, and the main thread frees it again once
+// the frame is presented. With N slots the render thread can be up to N - 1 frames
+// ahead, which raises throughput and adds as many frames of latency.
+class FramePipeline
+{
+public:
+    typedef std::function<void(FrameSlot& slot)> RenderFunction;
+
+    // Each slot holds a maxWidth x maxHeight frame. render is called on the render
+    // thread, with a slot to fill in.
+    FramePipeline(int slotCount, int maxWidth, int maxHeight, const RenderFunction& render);
+
+    // Waits for the frame being drawn, then stops the render thread
+    ~FramePipeline();
+
+    // Submits all but one slot with the same input, to get the render thread started
+    void Start(const FrameInput& input);
+
+    // Waits for the next finished frame. The slot is the main thread's until it's
+    // released.
+    FrameSlot* WaitForFrame();
+
+    // Has the next frame drawn with this input, into a free slot. There is one
+    // whenever as many frames have been released as waited for.
+    bool Submit(const FrameInput& input);
+    void Release(FrameSlot* slot);
+
+    int GetSlotCount() const;
+
+private:
+    void RenderLoop();
+
+    // Spins briefly, then sleeps, until the queue has something or the pipeline stops
+    static bool WaitPop(SpscQueue<FrameSlot*>& queue, FrameSlot*& slot, const std::atomic<bool>& stopping);
+
+    std::vector<FrameSlot> m_slots;
+    std::vector<FrameSlot*> m_free; // Only touched by the main thread
+    RenderFunction m_render;
+    SpscQueue<FrameSlot*> m_toRender; // Main thread to render thread
+    SpscQueue<FrameSlot*> m_rendered; // Render thread to main thread
+    std::atomic<bool> m_stopping;
+    std::thread m_thread;
+};
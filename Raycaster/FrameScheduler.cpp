@@ -0,0 +1,68 @@
+#include "FrameScheduler.hpp"
+
+// SDL_Delay can oversleep by a millisecond or two, so stop sleeping this long
+// before the deadline and spin the rest of the way
+static const double SPIN_SECONDS = 0.002;
+
+FrameScheduler::FrameScheduler(FramePacing pacing, int targetFps) :
+    m_pacing(pacing),
+    m_targetFps(targetFps),
+    m_frequency(SDL_GetPerformanceFrequency()),
+    m_frameTime(0)
+{
+    m_frameTicks = (targetFps > 0) ? m_frequency / targetFps : 0;
+    m_spinTicks = (Uint64)(SPIN_SECONDS * m_frequency);
+    m_frameStart = SDL_GetPerformanceCounter();
+    m_nextFrame = m_frameStart + m_frameTicks;
+}
+
+void FrameScheduler::WaitForNextFrame()
+{
+    if (m_pacing == PACING_SLEEP_SPIN && m_frameTicks > 0)
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now < m_nextFrame && m_nextFrame - now > m_spinTicks)
+        {
+            Uint64 sleepTicks = m_nextFrame - now - m_spinTicks;
+            SDL_Delay((Uint32)(sleepTicks * 1000 / m_frequency));
+        }
+
+        while (SDL_GetPerformanceCounter() < m_nextFrame)
+        {
+        }
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    m_frameTime = (double)(now - m_frameStart) / m_frequency;
+    m_frameStart = now;
+
+    // Keep to a steady grid of deadlines, unless we've fallen a whole frame
+    // behind. Then start over from now instead of rushing to catch up.
+    m_nextFrame += m_frameTicks;
+    if (m_nextFrame + m_frameTicks < now)
+    {
+        m_nextFrame = now + m_frameTicks;
+    }
+}
+
+void FrameScheduler::Restart()
+{
+    m_frameStart = SDL_GetPerformanceCounter();
+    m_nextFrame = m_frameStart + m_frameTicks;
+    m_frameTime = 0;
+}
+
+double FrameScheduler::GetFrameTime() const
+{
+    return m_frameTime;
+}
+
+FramePacing FrameScheduler::GetPacing() const
+{
+    return m_pacing;
+}
+
+int FrameScheduler::GetTargetFps() const
+{
+    return m_targetFps;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "PCH.hpp"
+
+enum FramePacing
+{
+    PACING_SLEEP_SPIN, // Sleep through most of the frame, then spin for the last bit
+    PACING_UNCAPPED, // Run as fast as possible
+    PACING_VSYNC // Leave the waiting to SDL_RenderPresent
+};
+
+// Paces the main loop off the performance counter, and measures how long
+// each frame really took.
+class FrameScheduler
+{
+public:
+    FrameScheduler(FramePacing pacing, int targetFps);
+
+    // Waits until the next frame is due. Call once per frame, after presenting.
+    void WaitForNextFrame();
+
+    // Starts timing over from now, after the loop has been idle
+    void Restart();
+
+    // Seconds from the start of the previous frame to the start of this one
+    double GetFrameTime() const;
+
+    FramePacing GetPacing() const;
+    int GetTargetFps() const;
+
+private:
+    FramePacing m_pacing;
+    int m_targetFps;
+    Uint64 m_frequency;
+    Uint64 m_frameTicks;
+    Uint64 m_spinTicks;
+    Uint64 m_nextFrame;
+    Uint64 m_frameStart;
+    double m_frameTime;
+};
@@ -0,0 +1,185 @@
+#include "LineBatch.hpp"
+#include <algorithm>
+#include <stdlib.h>
+
+// Liang-Barsky: cuts the line down to the part inside [minX, maxX] x [minY, maxY].
+// Returns false if none of it is.
+static bool ClipLine(double& x0, double& y0, double& x1, double& y1, double minX, double minY, double maxX, double maxY)
+{
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { x0 - minX, maxX - x0, y0 - minY, maxY - y0 };
+    double t0 = 0;
+    double t1 = 1;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0)
+        {
+            // Parallel to this edge, and either all outside it or all inside
+            if (q[i] < 0)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        double t = q[i] / p[i];
+        if (p[i] < 0)
+        {
+            t0 = std::max(t0, t);
+        }
+        else
+        {
+            t1 = std::min(t1, t);
+        }
+
+        if (t0 > t1)
+        {
+            return false;
+        }
+    }
+
+    double startX = x0;
+    double startY = y0;
+    x0 = startX + t0 * dx;
+    y0 = startY + t0 * dy;
+    x1 = startX + t1 * dx;
+    y1 = startY + t1 * dy;
+
+    return true;
+}
+
+void DrawClippedLine(Pixel* target, int pitch, const ClipRect& clip, double x0, double y0, double x1, double y1, Pixel color)
+{
+    if (clip.left >= clip.right || clip.top >= clip.bottom)
+    {
+        return;
+    }
+
+    // Clipped to the last pixel's left and top edges, so both ends round down inside
+    if (!ClipLine(x0, y0, x1, y1, clip.left, clip.top, clip.right - 1, clip.bottom - 1))
+    {
+        return;
+    }
+
+    int startX = (int)floor(x0);
+    int startY = (int)floor(y0);
+    int endX = (int)floor(x1);
+    int endY = (int)floor(y1);
+
+    int dx = abs(endX - startX);
+    int dy = -abs(endY - startY);
+    int stepX = (startX < endX) ? 1 : -1;
+    int stepY = (startY < endY) ? pitch : -pitch;
+    int error = dx + dy;
+    int steps = std::max(dx, -dy);
+
+    // Every pixel between the ends is inside the box around them, which is inside the clip
+    Pixel* pixel = target + (size_t)startY * pitch + startX;
+    for (int i = 0; i <= steps; i++)
+    {
+        *pixel = color;
+
+        int twice = 2 * error;
+        if (twice >= dy)
+        {
+            error += dy;
+            pixel += stepX;
+        }
+        if (twice <= dx)
+        {
+            error += dx;
+            pixel += stepY;
+        }
+    }
+}
+
+void LineBatch::Clear()
+{
+    m_lines.clear();
+}
+
+void LineBatch::Add(double x0, double y0, double x1, double y1)
+{
+    LineSegment line = { x0, y0, x1, y1 };
+    m_lines.push_back(line);
+}
+
+int LineBatch::GetCount() const
+{
+    return (int)m_lines.size();
+}
+
+void LineBatch::Draw(Pixel* target, int pitch, const ClipRect& clip, Pixel color) const
+{
+    for (size_t i = 0; i < m_lines.size(); i++)
+    {
+        const LineSegment& line = m_lines[i];
+        DrawClippedLine(target, pitch, clip, line.x0, line.y0, line.x1, line.y1, color);
+    }
+}
+
+void LineBatch::FillFan(Pixel* target, int pitch, const ClipRect& clip, Pixel color)
+{
+    int rows = clip.bottom - clip.top;
+    if (m_lines.empty() || rows <= 0 || clip.left >= clip.right)
+    {
+        return;
+    }
+
+    m_crossings.resize(rows);
+    for (int row = 0; row < rows; row++)
+    {
+        m_crossings[row].clear();
+    }
+
+    // Where each edge crosses the middle of each row it spans
+    size_t count = m_lines.size() + 1;
+    for (size_t i = 0; i < count; i++)
+    {
+        double ax = (i == 0) ? m_lines[0].x0 : m_lines[i - 1].x1;
+        double ay = (i == 0) ? m_lines[0].y0 : m_lines[i - 1].y1;
+        double bx = (i + 1 == count) ? m_lines[0].x0 : m_lines[i].x1;
+        double by = (i + 1 == count) ? m_lines[0].y0 : m_lines[i].y1;
+        if (ay == by)
+        {
+            continue;
+        }
+
+        if (ay > by)
+        {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+
+        // Rows whose middle is in [ay, by)
+        int first = std::max((int)ceil(ay - 0.5), clip.top);
+        int last = std::min((int)ceil(by - 0.5), clip.bottom);
+        double slope = (bx - ax) / (by - ay);
+        for (int y = first; y < last; y++)
+        {
+            m_crossings[y - clip.top].push_back((float)(ax + (y + 0.5 - ay) * slope));
+        }
+    }
+
+    // Inside between every other crossing
+    Pixel half = (color >> 1) & 0x7F7F7F7F;
+    for (int row = 0; row < rows; row++)
+    {
+        std::vector<float>& crossings = m_crossings[row];
+        std::sort(crossings.begin(), crossings.end());
+
+        Pixel* line = target + (size_t)(clip.top + row) * pitch;
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2)
+        {
+            int x0 = std::max((int)ceil(crossings[i] - 0.5f), clip.left);
+            int x1 = std::min((int)ceil(crossings[i + 1] - 0.5f), clip.right);
+            for (int x = x0; x < x1; x++)
+            {
+                line[x] = ((line[x] >> 1) & 0x7F7F7F7F) + half;
+            }
+        }
+    }
+}
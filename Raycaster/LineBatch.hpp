@@ -0,0 +1,47 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "Pixel.hpp"
+
+// Lines drawn a frame's worth at a time: each one is clipped to the viewport once,
+// then stepped along with integer Bresenham, so no pixel needs a bounds check.
+// Coordinates are in pixels, with pixel (x, y) covering [x, x + 1) x [y, y + 1).
+
+struct ClipRect
+{
+    int left;
+    int top;
+    int right; // One past the last column
+    int bottom; // One past the last row
+};
+
+struct LineSegment
+{
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+};
+
+// Draws one line, clipped to the rectangle
+void DrawClippedLine(Pixel* target, int pitch, const ClipRect& clip, double x0, double y0, double x1, double y1, Pixel color);
+
+class LineBatch
+{
+public:
+    void Clear();
+    void Add(double x0, double y0, double x1, double y1);
+    int GetCount() const;
+
+    void Draw(Pixel* target, int pitch, const ClipRect& clip, Pixel color) const;
+
+    // Fills the polygon from the first line's start through every line's end in
+    // turn, half and half with what's already there. For lines fanning out from
+    // one point, like the rays, that's the area they sweep.
+    void FillFan(Pixel* target, int pitch, const ClipRect& clip, Pixel color);
+
+private:
+    std::vector<LineSegment> m_lines;
+    std::vector<std::vector<float> > m_crossings; // Per row, where the fan's edges cross it
+};
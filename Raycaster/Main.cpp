@@ -1,19 +1,29 @@
 #include "PCH.hpp"
 #include "Main.hpp"
 
-static const Color BLACK(0, 0, 0);
-static const Color WHITE(255, 255, 255);
-static const Color GRAY(128, 128, 128);
-static const Color RED(194, 59, 34);
-static const Color GREEN(119, 190, 119);
-static const Color BLUE(119, 158, 203);
-static const Color CYAN(0, 255, 255);
-static const Color MAGENTA(255, 0, 255);
-
 int main(int argc, char** argv)
 {
     isRunning = true;
 
+    InitRaycaster();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!ParseGameOption(argc, argv, i) && !ParseRenderOption(argc, argv, i))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--tracer scalar|sse2|avx2] [--caster dda|angle] [--map file] [--pvs file|bake|off] [--skip auto|on|off] [--textures on|off] [--floors on|off] [--atlas file.bmp] [--sprites N] [--sprite-atlas file.bmp] [--minimap-rays lines|cone|off] [--render WxH] [--window WxH] [--dynamic-res on|off] [--frame-budget ms] [--present lock|copy] [--pacing sleep|uncapped|vsync] [--pipeline off|double|triple] [--fps N] [--profile-csv file] [--profile-trace file] [--capture file.y4m|file.rgba] [--capture-buffers N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // The video is played back at the target frame rate, which only the sleep
+    // pacing keeps to
+    if (IsCaptureRequested() && pacing != PACING_SLEEP_SPIN)
+    {
+        std::cerr << "--capture needs --pacing sleep" << std::endl;
+        return 1;
+    }
+
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
@@ -22,7 +32,7 @@ int main(int argc, char** argv)
     }
 
     // Create window
-    window = SDL_CreateWindow("Raycaster", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow("Raycaster", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
     if (window == nullptr)
     {
         std::cerr << "Window could not be created! SDL error: " << SDL_GetError() << std::endl;
@@ -30,421 +40,571 @@ int main(int argc, char** argv)
     }
 
     // Create renderer
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (pacing == PACING_VSYNC)
+    {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
     if (renderer == nullptr)
     {
         std::cerr << "Renderer could not be created! SDL error: " << SDL_GetError() << std::endl;
         return false;
     }
 
-    // Create the screen texture
+    // Create the screen texture, big enough for the largest render resolution.
+    // Smaller frames use its top left corner, filtered as they're scaled up.
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
     screenTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, RENDER_WIDTH, RENDER_HEIGHT);
 
-    double previousTime;
-    double currentTime = SDL_GetTicks();
-
-    SDL_Event event;
-    while (isRunning)
+    if (!StartCapture(targetFps))
     {
-        double frameStartTime = SDL_GetTicks();
-
-        // Poll for window input
-        while (SDL_PollEvent(&event) != 0)
-        {
-            if (event.type == SDL_QUIT)
-            {
-                isRunning = false;
-            }
-        }
-
-        ProcessInput();
-        Update();
-        Render();
-
-        double frameEndTime = SDL_GetTicks();
-        while (true)
-        {
-            frameEndTime = SDL_GetTicks();
-            double frameTime = (double)(frameEndTime - frameStartTime) / 1000;
-
-            // Break out once we use up our time per frame
-            if (frameTime >= (1 / FRAMERATE))
-            {
-                deltaTime = frameTime;
-                break;
-            }
-        }
+        return 1;
     }
 
-    Quit();
-    
-    return 0;
-}
-
-void ProcessInput()
-{
-    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
-
-    if (currentKeyStates[SDL_SCANCODE_W])
+    // Reading a frame back out of a locked texture can be uncached and slow, so
+    // captured frames are drawn into system memory
+    if (frameCapture.IsActive())
     {
-        playerSpeed = 1;
+        presentMode = PRESENT_COPY;
     }
 
-    if (currentKeyStates[SDL_SCANCODE_A])
-    {
-        playerDir = -1;
-    }
+    FrameScheduler scheduler(pacing, targetFps);
 
-    if (currentKeyStates[SDL_SCANCODE_S])
+    if (frameBudgetMs <= 0)
     {
-        playerSpeed = -1;
+        frameBudgetMs = 1000.0 / targetFps * FRAME_BUDGET_SHARE;
     }
 
-    if (currentKeyStates[SDL_SCANCODE_D])
-    {
-        playerDir = 1;
-    }
+    ResolutionController resolution(RENDER_WIDTH, RENDER_HEIGHT, frameBudgetMs);
 
-    if (currentKeyStates[SDL_SCANCODE_Q])
-    {
+    runStart = SDL_GetPerformanceCounter();
+    ResetTitleStats();
 
+    if (pipelineSlots > 1)
+    {
+        RunPipelined(scheduler, resolution);
     }
-
-    if (currentKeyStates[SDL_SCANCODE_E])
+    else
     {
-
+        RunSerial(scheduler, resolution);
     }
-}
 
-double Rad(double deg)
-{
-    return deg * (M_PI / 180);
+    PrintLatency();
+    SaveProfile();
+    StopCapture();
+    Quit();
+    
+    return 0;
 }
 
-void Update()
+// How far to run the simulation before drawing a frame: as many fixed steps as fit
+// in the time the last frame took. A capture gets exactly one frame's worth, so each
+// frame in the video is 1 / targetFps of game time however long it took to draw.
+double GetSimulationTime(double frameTime)
 {
-    double moveStep = playerSpeed * (playerMoveSpeed * deltaTime);
-    double newX = playerX + cos(playerRot) * moveStep;
-    double newY = playerY + sin(playerRot) * moveStep;
-
-    playerX = newX;
-    playerY = newY;
-    playerRot += playerDir * (playerRotSpeed * deltaTime);
-    playerSpeed = 0;
-    playerDir = 0;
-
-    viewDist = (RENDER_WIDTH / 2) / tan(FOV / 2);
-
-    if (playerRot < 0)
+    if (frameCapture.IsActive())
     {
-        playerRot += TWO_PI;
-    }
-    else if (playerRot >= TWO_PI)
-    {
-        playerRot -= TWO_PI;
-    }
-
-    for (int x = 0; x < RENDER_WIDTH; x++)
-    {
-        // Where on the screen the ray goes through
-        double rayScreenPos = (-RENDER_WIDTH / 2 + x);
-
-        // The distance from the viewer to the point on the screen
-        double rayViewDist = sqrt((rayScreenPos * rayScreenPos) + (viewDist * viewDist));
-
-        // The angle of the ray, relative to the viewing direction.
-        double rayAngle = asin(rayScreenPos / rayViewDist);
-
-        CastRay(playerRot + rayAngle, x);
+        return 1.0 / targetFps;
     }
 
-    Minimap();
+    return std::min(frameTime, MAX_FRAME_TIME);
 }
 
-void CastRay(double rayAngle, int col)
+// Update, draw and present one after the other on this thread
+void RunSerial(FrameScheduler& scheduler, ResolutionController& resolution)
 {
-    //std::cout << "Reay at " << rayAngle * (180 / M_PI) << " degrees." << std::endl;
-    if (rayAngle < 0)
-    {
-        rayAngle += TWO_PI;
-    }
-    else if (rayAngle >= TWO_PI)
-    {
-        rayAngle -= TWO_PI;
-    }
-
-    // Check the quadrant of the ray
-    bool right = (rayAngle > TWO_PI * 0.75 || rayAngle < TWO_PI * 0.25);
-    bool up = (rayAngle < 0 || rayAngle > M_PI);
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    double simulationTime = 0;
 
-    double dist = 0.0; // Distance to tile we hit
-
-    double xHit = 0.0;
-    double yHit = 0.0;
+    while (isRunning)
+    {
+        FrameInput input = {};
+        {
+            PROFILE_SCOPE(PROFILE_INPUT);
+            PollInput(input);
+            ApplyInput(input);
+        }
 
-    int tileX;
-    int tileY;
+        {
+            PROFILE_SCOPE(PROFILE_SIMULATE);
 
-    int hitTileX;
-    int hitTileY;
+            simulationTime += GetSimulationTime(scheduler.GetFrameTime());
+            while (simulationTime >= SIMULATION_STEP)
+            {
+                Simulate();
+                simulationTime -= SIMULATION_STEP;
+            }
+        }
 
-    int side = 0;
+        // The same frame again would be wasted work. Nothing moves without input,
+        // so sleep until some comes in, and start the frame timing over after.
+        // A capture keeps drawing, so the video keeps time with the game.
+        if (isRunning && !FrameChanged() && playerSpeed == 0 && playerDir == 0 && !frameCapture.IsActive())
+        {
+            {
+                PROFILE_SCOPE(PROFILE_WAIT);
+                SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+            }
 
-    // First check against the vertical tile lines
-    // We do this by moving to thr right or left edge of the block we're standing in,
-    // and then moving in 1 map unit steps horizontally. The amount we have to move vertically
-    // is determined by the slope of the way.
+            scheduler.Restart();
+            simulationTime = 0;
+            ResetTitleStats();
 
-    double slope = sin(rayAngle) / cos(rayAngle);
-    double dx = right ? 1 : -1; // We move either 1 map unit to the left or right
-    double dy = dx * slope; // How much to move up or done
+            PROFILE_FRAME_END();
+            continue;
+        }
 
-    double x = right ? ceil(playerX) : floor(playerX); // Starting horizontal position, at one of the edges of the current map tile
-    double y = playerY + (x - playerX) * slope; // starting vertical position. We add the small horizontal step we just made, multiplied by the slope.
+        Uint64 workStart = SDL_GetPerformanceCounter();
+        Update();
+        Render();
+        Uint64 work = SDL_GetPerformanceCounter() - workStart;
 
-    while (x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT)
-    {
-        int tileMapX = floor(x + (right ? 0 : -1));
-        int tileMapY = floor(y);
+        Present(renderWidth, renderHeight);
+        AddFrameStats(work, frameStats.bytesDrawn + frameStats.bytesCopied, SDL_GetPerformanceCounter() - input.sampledAt, renderWidth, renderHeight);
 
-        // Is this point inside a wall block?
-        if (GetTile(Vector2D(tileMapX, tileMapY)) > 0)
+        // Presenting is left out, since with vsync it waits for the display
+        if (dynamicResolution && resolution.Update((double)work * 1000 / frequency))
         {
-            double distX = x - playerX;
-            double distY = y - playerY;
-            dist = (distX * distX) + (distY * distY); // the distance from the player to this point, squared.
-
-            side = 0;
-
-            hitTileX = tileMapX;
-            hitTileY = tileMapY;
-
-            xHit = x;
-            yHit = y;
+            SetRenderSize(resolution.GetWidth(), resolution.GetHeight());
+        }
 
-            break;
+        {
+            PROFILE_SCOPE(PROFILE_WAIT);
+            scheduler.WaitForNextFrame();
         }
 
-        x += dx;
-        y += dy;
+        PROFILE_FRAME_END();
     }
+}
 
-    // Now check against horizontal lines. it's basically the same thing, but turned around.
-    // The only difference here is that once we hit a map block, we check if there was also one
-    // found there in the vertical run. If so, we only register this hit if this distance is smaller.
-
-    slope = cos(rayAngle) / sin(rayAngle);
-    dy = up ? -1 : 1;
-    dx = dy * slope;
-    y = up ? floor(playerY) : ceil(playerY);
-    x = playerX + (y - playerY) * slope;
+// Presents each frame while the render thread draws the next ones. Everything the
+// frames are drawn from, the player, the map and the resolution, belongs to the
+// render thread, and this thread only passes it input.
+void RunPipelined(FrameScheduler& scheduler, ResolutionController& resolution)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    double simulationTime = 0;
 
-    while (x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT)
+    FramePipeline pipeline(pipelineSlots, RENDER_WIDTH, RENDER_HEIGHT, [&](FrameSlot& slot)
     {
-        int tileMapX = floor(x);
-        int tileMapY = floor(y + (up ? -1 : 0));
+        PROFILE_THREAD(PROFILE_TRACK_RENDER);
 
-        // Is this point inside a wall block?
-        if (GetTile(Vector2D(tileMapX, tileMapY)) > 0)
         {
-            double distX = x - playerX;
-            double distY = y - playerY;
-            double tileDist = (distX * distX) + (distY * distY);
-            if (!dist || tileDist < dist)
+            PROFILE_SCOPE(PROFILE_SIMULATE);
+            ApplyInput(slot.input);
+
+            simulationTime += GetSimulationTime(slot.input.frameTime);
+            while (simulationTime >= SIMULATION_STEP)
             {
-                dist = tileDist;
+                Simulate();
+                simulationTime -= SIMULATION_STEP;
+            }
+        }
 
-                side = 1;
+        // As in RunSerial(), the main thread does the sleeping
+        slot.changed = FrameChanged() || playerSpeed != 0 || playerDir != 0 || frameCapture.IsActive();
+        if (!slot.changed)
+        {
+            simulationTime = 0;
+            PROFILE_FRAME_END();
+            return;
+        }
 
-                hitTileX = tileMapX;
-                hitTileY = tileMapY;
+        Uint64 workStart = SDL_GetPerformanceCounter();
+        SetFramebuffer(slot.pixels.data(), renderWidth);
+        Update();
+        Draw();
 
-                xHit = x;
-                yHit = y;
-            }
+        slot.width = renderWidth;
+        slot.height = renderHeight;
+        slot.workTicks = SDL_GetPerformanceCounter() - workStart;
+        slot.bytesMoved = frameStats.bytesDrawn + (Uint64)renderWidth * renderHeight * sizeof(Pixel);
 
-            break;
+        if (dynamicResolution && resolution.Update((double)slot.workTicks * 1000 / frequency))
+        {
+            SetRenderSize(resolution.GetWidth(), resolution.GetHeight());
         }
 
-        x += dx;
-        y += dy;
-    }
+        PROFILE_FRAME_END();
+    });
+
+    FrameInput input = {};
+    input.sampledAt = SDL_GetPerformanceCounter();
+    pipeline.Start(input);
 
-    if (dist)
+    while (isRunning)
     {
-        dist = sqrt(dist);
+        FrameSlot* slot;
+        {
+            PROFILE_SCOPE(PROFILE_WAIT);
+            slot = pipeline.WaitForFrame();
+        }
 
-        // Adjust for fish eye
-        dist *= cos(playerRot - rayAngle);
+        // A frame that wasn't drawn isn't presented. If the input sent since wouldn't
+        // change anything either, the frames still on the render thread won't, so
+        // sleep until some comes in, and start the frame timing over after.
+        bool changed = slot->changed;
+        if (!changed)
+        {
+            pipeline.Release(slot);
 
-        // Calculate the position and height of the wall strip.
-        // The wall height is 1 unit, the distance from the player to the screen is viewDist,
-        // thus the height on the screen is equal to
-        // wallHeight * viewDist / dist
-        double height = round(viewDist / dist);
+            if (input.speed == 0 && input.dir == 0 && !input.toggleWall && !input.invalidate)
+            {
+                {
+                    PROFILE_SCOPE(PROFILE_WAIT);
+                    SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+                }
 
-        double drawStart = round((RENDER_HEIGHT / 2) - (height / 2));
-        double drawEnd = drawStart + height;
+                scheduler.Restart();
+                ResetTitleStats();
+            }
+        }
 
-        int tile = GetTile(Vector2D(hitTileX, hitTileY));
-        Color color;
-        switch (tile)
+        // The next frame is drawn from the freshest input while this one is presented
+        FrameInput next = {};
         {
-        case 1:
-            color = RED;
-            break;
-        case 2:
-            color = GREEN;
-            break;
-        case 3:
-            color = BLUE;
-            break;
-        case 4:
-            color = WHITE;
-            break;
-        default:
-            color = MAGENTA;
-            break;
+            PROFILE_SCOPE(PROFILE_INPUT);
+            PollInput(next);
         }
 
-        if (side == 1)
+        next.frameTime = scheduler.GetFrameTime();
+        pipeline.Submit(next);
+        input = next;
+
+        if (!changed)
         {
-            color = Color(color.GetR() / 2, color.GetG() / 2, color.GetB() / 2);
+            PROFILE_FRAME_END();
+            continue;
         }
 
-        // Wall
-        DrawVerticalLine(col, drawStart, drawEnd, color);
+        {
+            PROFILE_SCOPE(PROFILE_UPLOAD);
+            SDL_Rect frameRect = { 0, 0, slot->width, slot->height };
+            SDL_UpdateTexture(screenTexture, &frameRect, slot->pixels.data(), slot->width * sizeof(Pixel));
+        }
 
-        DrawRay(xHit, yHit);
+        Present(slot->width, slot->height);
+        AddFrameStats(slot->workTicks, slot->bytesMoved, SDL_GetPerformanceCounter() - slot->input.sampledAt, slot->width, slot->height);
+        pipeline.Release(slot);
+
+        {
+            PROFILE_SCOPE(PROFILE_WAIT);
+            scheduler.WaitForNextFrame();
+        }
+
+        PROFILE_FRAME_END();
     }
 }
 
-void DrawRay(int x, int y)
+void ResetTitleStats()
 {
-    Vector2D start(playerX * 8, playerY * 8);
-    Vector2D end(x * 8, y * 8);
-    DrawLine(start, end, RED);
+    statsWork = 0;
+    statsBytes = 0;
+    statsLatency = 0;
+    statsFrames = 0;
+    statsStart = SDL_GetTicks();
 }
 
-void Render()
+void AddFrameStats(Uint64 work, Uint64 bytes, Uint64 latency, int width, int height)
 {
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_RenderClear(renderer);
+    statsWork += work;
+    statsBytes += bytes;
+    statsLatency += latency;
+    statsFrames++;
 
-    byte* pPixels;
-    int pitch = 0;
-    SDL_LockTexture(screenTexture, nullptr, (void**)&pPixels, &pitch);
+    latencyTotal += latency;
+    latencyMax = std::max(latencyMax, latency);
+    latencyFrames++;
 
-    memcpy(pPixels, pixels, (RENDER_WIDTH * RENDER_HEIGHT) * 4);
+    if (SDL_GetTicks() - statsStart < 1000)
+    {
+        return;
+    }
 
-    SDL_UnlockTexture(screenTexture);
+    double tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+    char title[192];
+    int length = snprintf(title, sizeof(title), "Raycaster - %d fps, %.2f ms/frame, %.1f ms latency, %dx%d, %llu KB moved/frame",
+        statsFrames, statsWork * tickMs / statsFrames, statsLatency * tickMs / statsFrames, width, height, (unsigned long long)(statsBytes / statsFrames / 1024));
+    if (frameCapture.IsActive())
+    {
+        snprintf(title + length, sizeof(title) - length, ", capturing (%llu dropped)", (unsigned long long)frameCapture.GetFramesDropped());
+    }
 
-    SDL_Rect renderRect = { 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT };
-    SDL_RenderCopyEx(renderer, screenTexture, nullptr, &renderRect, 0, NULL, SDL_FLIP_NONE);
+    SDL_SetWindowTitle(window, title);
+    ResetTitleStats();
+}
 
-    SDL_RenderPresent(renderer);
-    memset(pixels, 0x00, RENDER_WIDTH * RENDER_HEIGHT * 4);
+void PrintLatency()
+{
+    if (latencyFrames == 0)
+    {
+        return;
+    }
+
+    double tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+    double seconds = (SDL_GetPerformanceCounter() - runStart) * tickMs / 1000;
+    std::cout << "Presented " << latencyFrames << " frames at " << latencyFrames / seconds << " fps, "
+        << (pipelineSlots > 1 ? "pipelined" : "serial") << " with " << pipelineSlots << " buffer(s). Input latency "
+        << latencyTotal * tickMs / latencyFrames << " ms average, " << latencyMax * tickMs << " ms max" << std::endl;
 }
 
-void Minimap()
+bool ParseGameOption(int argc, char** argv, int& i)
 {
-    for (int x = 0; x < MAP_WIDTH; x++)
+    if (i + 1 >= argc)
     {
-        for (int y = 0; y < MAP_HEIGHT; y++)
-        {
-            //DrawLine(Vector2D(0, y) * 8, Vector2D(MAP_WIDTH, y) * 8, WHITE);
-            //DrawLine(Vector2D(x, 0) * 8, Vector2D(x, MAP_HEIGHT) * 8, WHITE);
+        return false;
+    }
 
-            int tile = GetTile(Vector2D(x, y));
-            if (tile != 0)
-            {
-                Color color;
-                switch (tile)
-                {
-                case 1:
-                    color = RED;
-                    break;
-                case 2:
-                    color = GREEN;
-                    break;
-                case 3:
-                    color = BLUE;
-                    break;
-                case 4:
-                    color = WHITE;
-                    break;
-                default:
-                    color = MAGENTA;
-                    break;
-                }
+    const char* name = argv[i];
+    const char* value = argv[i + 1];
 
-                DrawRect((x)* 8, (y)* 8, 8, 8, color);
-            }
+    if (strcmp(name, "--present") == 0)
+    {
+        if (strcmp(value, "lock") == 0)
+        {
+            presentMode = PRESENT_LOCK;
+        }
+        else if (strcmp(value, "copy") == 0)
+        {
+            presentMode = PRESENT_COPY;
+        }
+        else
+        {
+            return false;
         }
     }
+    else if (strcmp(name, "--pacing") == 0)
+    {
+        if (strcmp(value, "sleep") == 0)
+        {
+            pacing = PACING_SLEEP_SPIN;
+        }
+        else if (strcmp(value, "uncapped") == 0)
+        {
+            pacing = PACING_UNCAPPED;
+        }
+        else if (strcmp(value, "vsync") == 0)
+        {
+            pacing = PACING_VSYNC;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (strcmp(name, "--pipeline") == 0)
+    {
+        if (strcmp(value, "off") == 0)
+        {
+            pipelineSlots = 1;
+        }
+        else if (strcmp(value, "double") == 0)
+        {
+            pipelineSlots = 2;
+        }
+        else if (strcmp(value, "triple") == 0)
+        {
+            pipelineSlots = 3;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (strcmp(name, "--window") == 0)
+    {
+        if (sscanf(value, "%dx%d", &windowWidth, &windowHeight) != 2 || windowWidth <= 0 || windowHeight <= 0)
+        {
+            return false;
+        }
+    }
+    else if (strcmp(name, "--dynamic-res") == 0)
+    {
+        if (strcmp(value, "on") == 0)
+        {
+            dynamicResolution = true;
+        }
+        else if (strcmp(value, "off") == 0)
+        {
+            dynamicResolution = false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (strcmp(name, "--frame-budget") == 0)
+    {
+        frameBudgetMs = atof(value);
+        if (frameBudgetMs <= 0)
+        {
+            return false;
+        }
+    }
+    else if (strcmp(name, "--fps") == 0)
+    {
+        targetFps = atoi(value);
+        if (targetFps <= 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    i++;
+    return true;
 }
 
-void Quit()
+void PollInput(FrameInput& input)
 {
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_DestroyTexture(screenTexture);
+    SDL_Event event;
+    while (SDL_PollEvent(&event) != 0)
+    {
+        if (event.type == SDL_QUIT)
+        {
+            isRunning = false;
+        }
+        else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED)
+        {
+            // The window's contents were lost, so the last frame has to be presented again
+            input.invalidate = true;
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_e && !event.key.repeat)
+        {
+            input.toggleWall = true;
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F9 && !event.key.repeat)
+        {
+            // Snapshot of the last frames, on demand
+            profiler.WriteCsv(PROFILE_CSV_FILE);
+            profiler.WriteChromeTrace(PROFILE_TRACE_FILE);
+            std::cout << "Wrote " << PROFILE_CSV_FILE << " and " << PROFILE_TRACE_FILE << std::endl;
+        }
+    }
 
-    SDL_Quit();
+    ProcessInput(input);
+    input.sampledAt = SDL_GetPerformanceCounter();
 }
 
-int GetTile(Vector2D position)
+void ApplyInput(const FrameInput& input)
 {
-    return map[((int)position.GetY() * MAP_WIDTH) + (int)position.GetX()];
-}
+    playerSpeed = input.speed;
+    playerDir = input.dir;
 
-void SetPixel(int x, int y, Color color)
-{
-    if (x < 0 || y < 0 || x >= RENDER_WIDTH || y >= RENDER_HEIGHT)
+    if (input.toggleWall)
     {
-        return;
+        ToggleWallInFront();
     }
 
-    pixels[((y * RENDER_WIDTH) + x) * 4 + 3] = color.GetR();
-    pixels[((y * RENDER_WIDTH) + x) * 4 + 2] = color.GetG();
-    pixels[((y * RENDER_WIDTH) + x) * 4 + 1] = color.GetB();
-    pixels[((y * RENDER_WIDTH) + x) * 4 + 0] = color.GetA();
+    if (input.invalidate)
+    {
+        InvalidateFrame();
+    }
 }
 
-void DrawVerticalLine(int x, int y1, int y2, Color color)
+void ProcessInput(FrameInput& input)
 {
-    for (int y = y1; y <= y2; y++)
+    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+
+    // Held keys set these again every frame
+    input.speed = 0;
+    input.dir = 0;
+
+    if (currentKeyStates[SDL_SCANCODE_W])
     {
-        SetPixel(x, y, color);
+        input.speed = 1;
     }
-}
 
-void DrawLine(Vector2D start, Vector2D end, Color color)
-{
-    double x = end.GetX() - start.GetX();
-    double y = end.GetY() - start.GetY();
-    double length = sqrt(x*x + y*y);
+    if (currentKeyStates[SDL_SCANCODE_A])
+    {
+        input.dir = -1;
+    }
 
-    double addx = x / length;
-    double addy = y / length;
+    if (currentKeyStates[SDL_SCANCODE_S])
+    {
+        input.speed = -1;
+    }
 
-    x = start.GetX();
-    y = start.GetY();
+    if (currentKeyStates[SDL_SCANCODE_D])
+    {
+        input.dir = 1;
+    }
 
-    for (int i = 0; i < length; i += 1)
+    if (currentKeyStates[SDL_SCANCODE_Q])
     {
-        SetPixel(start.GetX(), start.GetY(), color);
-        start = start + Vector2D(addx, addy);
+
     }
 }
 
-void DrawRect(int x, int y, int RENDER_WIDTH, int RENDER_HEIGHT, Color color)
+void Render()
 {
-    for (int xIndex = 0; xIndex < RENDER_WIDTH; xIndex++)
+    frameStats.bytesCopied = 0;
+
+    // Only the part of the texture this frame's resolution covers
+    SDL_Rect frameRect = { 0, 0, renderWidth, renderHeight };
+
+    void* pPixels;
+    int pitch = 0;
+    bool locked = false;
+    if (presentMode == PRESENT_LOCK)
     {
-        for (int yIndex = 0; yIndex < RENDER_HEIGHT; yIndex++)
-        {
-            SetPixel(x + xIndex, y + yIndex, color);
-        }
+        PROFILE_SCOPE(PROFILE_UPLOAD);
+        locked = (SDL_LockTexture(screenTexture, &frameRect, &pPixels, &pitch) == 0);
+    }
+
+    if (locked)
+    {
+        // The texture rows may be padded, so draw with its pitch rather than renderWidth
+        SetFramebuffer((Pixel*)pPixels, pitch / sizeof(Pixel));
+        Draw();
+
+        PROFILE_SCOPE(PROFILE_UPLOAD);
+        SDL_UnlockTexture(screenTexture);
     }
+    else
+    {
+        presentMode = PRESENT_COPY;
+
+        Pixel* buffer = (frameCount & 1) ? backBuffer : pixels;
+        SetFramebuffer(buffer, renderWidth);
+        Draw();
+
+        PROFILE_SCOPE(PROFILE_UPLOAD);
+        SDL_UpdateTexture(screenTexture, &frameRect, buffer, renderWidth * sizeof(Pixel));
+        frameStats.bytesCopied = (Uint64)renderWidth * renderHeight * sizeof(Pixel);
+    }
+
+    frameCount++;
+}
+
+void Present(int width, int height)
+{
+    PROFILE_SCOPE(PROFILE_PRESENT);
+
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderClear(renderer);
+
+    // Scaled up from the frame's resolution to the whole window
+    SDL_Rect frameRect = { 0, 0, width, height };
+    SDL_Rect windowRect = { 0, 0, windowWidth, windowHeight };
+    SDL_RenderCopy(renderer, screenTexture, &frameRect, &windowRect);
+
+    SDL_RenderPresent(renderer);
+}
+
+void Quit()
+{
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_DestroyTexture(screenTexture);
+
+    delete renderPool;
+    renderPool = nullptr;
+
+    SDL_Quit();
 }
\ No newline at end of file
@@ -2,94 +2,98 @@
 
 #include "PCH.hpp"
 #include <math.h>
+#include <algorithm>
 #include "Timer.hpp"
-#include "Color.hpp"
-#include "Vector2D.hpp"
+#include "FrameScheduler.hpp"
+#include "ResolutionController.hpp"
+#include "FramePipeline.hpp"
+#include "Raycaster.hpp"
 
 const int FRAMERATE = 60;
-const int TEX_WIDTH = 64;
-const int TEX_HEIGHT = 64;
-const int MAP_WIDTH = 30;
-const int MAP_HEIGHT = 30;
-
-int map[MAP_WIDTH * MAP_HEIGHT] =
-{
-    2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,3,1,1,1,1,1,3,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,3,1,1,0,1,1,3,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
-    2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2
-};
 
 bool isRunning;
 
 SDL_Window* window;
 SDL_Renderer* renderer;
 SDL_Texture* screenTexture;
-SDL_Texture* testTexture;
 
+// Default window size, --window WxH changes it. Frames are drawn at the render
+// resolution and scaled to fit when presented.
 const int WINDOW_WIDTH = 640;
 const int WINDOW_HEIGHT = 480;
 
-const int RENDER_WIDTH = 640;
-const int RENDER_HEIGHT = 480;
+int windowWidth = WINDOW_WIDTH;
+int windowHeight = WINDOW_HEIGHT;
+
+// With dynamic resolution on, the render resolution is lowered whenever updating
+// and drawing a frame takes longer than frameBudgetMs, and raised again once it
+// fits. The budget defaults to this share of the frame time at the target rate,
+// which leaves the rest for input, simulation and presenting.
+const double FRAME_BUDGET_SHARE = 0.8;
 
-const double TWO_PI = 2 * M_PI;
-const double FOV = 90 * (M_PI / 180);
-const int TILE_SIZE = 64;
+bool dynamicResolution = true;
+double frameBudgetMs = 0;
 
-// Player variables
-double playerX = 14.5;
-double playerY = 22;
-double playerDir = 0;
-double playerRot = 0;
-double playerSpeed = 0;
-double playerMoveSpeed = 32;
-double playerRotSpeed = 180 * (M_PI / 180);
+// How a drawn frame gets into screenTexture
+enum PresentMode
+{
+    PRESENT_LOCK, // Draw straight into the locked texture
+    PRESENT_COPY // Draw into a system memory buffer and upload it, for drivers where locking is slow
+};
 
-double viewDist;
+PresentMode presentMode = PRESENT_LOCK;
 
-double deltaTime;
+// The copy path alternates between pixels and this, so a frame is never drawn
+// into the buffer the driver may still be uploading from
+Pixel backBuffer[RENDER_WIDTH * RENDER_HEIGHT];
+int frameCount;
 
-byte pixels[RENDER_WIDTH * RENDER_HEIGHT * 4];
+// With more than one slot, frames are drawn on a render thread while the main
+// thread presents the ones before, see FramePipeline. --pipeline double or triple.
+int pipelineSlots = 1;
 
-void ProcessInput();
-void Update();
-void CastRay(double rayAngle, int col);
-void Render();
-void Quit();
+FramePacing pacing = PACING_SLEEP_SPIN;
+int targetFps = FRAMERATE;
 
-double Rad(double deg);
-void Minimap();
+// A frame longer than this (a breakpoint, the window being dragged) is treated
+// as this long, so the simulation doesn't try to catch up all at once
+const double MAX_FRAME_TIME = 0.25;
 
-int GetTile(Vector2D position);
-void DrawRay(int x, int y);
-void SetPixel(int x, int y, Color color);
-void DrawVerticalLine(int x, int y1, int y2, Color color);
-void DrawLine(Vector2D start, Vector2D end, Color color);
-void DrawRect(int x, int y, int RENDER_WIDTH, int RENDER_HEIGHT, Color color);
\ No newline at end of file
+// While nothing on screen changes, the loop sleeps until an event comes in, waking
+// up at least this often anyway
+const int IDLE_WAIT_MS = 250;
+
+// Frame rate, work time, bytes moved and input latency, averaged into the window
+// title once a second. Work is performance counter ticks spent updating and drawing.
+Uint64 statsWork;
+Uint64 statsBytes;
+Uint64 statsLatency;
+int statsFrames;
+Uint32 statsStart;
+
+// Ticks from sampling the input a frame was drawn with to presenting it, over
+// the whole run, printed on exit
+Uint64 runStart;
+Uint64 latencyTotal;
+Uint64 latencyMax;
+Uint64 latencyFrames;
+
+// F9 writes the profiler's frames here
+const char* const PROFILE_CSV_FILE = "profile.csv";
+const char* const PROFILE_TRACE_FILE = "profile.json";
+
+bool ParseGameOption(int argc, char** argv, int& i);
+double GetSimulationTime(double frameTime);
+void RunSerial(FrameScheduler& scheduler, ResolutionController& resolution);
+void RunPipelined(FrameScheduler& scheduler, ResolutionController& resolution);
+void ResetTitleStats();
+void AddFrameStats(Uint64 work, Uint64 bytes, Uint64 latency, int width, int height);
+void PrintLatency();
+
+// Handles the pending events and samples the held keys
+void PollInput(FrameInput& input);
+void ApplyInput(const FrameInput& input);
+void ProcessInput(FrameInput& input);
+void Render();
+void Present(int width, int height);
+void Quit();
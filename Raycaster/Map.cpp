@@ -0,0 +1,295 @@
+#include "Map.hpp"
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAP_MAGIC[4] = { 'R', 'C', 'M', 'P' };
+
+// Maps the whole file copy-on-write, so tiles can be edited in memory
+static void* MapFile(const std::string& fileName, size_t& size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    }
+
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+
+    // The view keeps the file open
+    if (mapping)
+    {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+
+    size = view ? (size_t)fileSize.QuadPart : 0;
+    return view;
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        view = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    }
+
+    // The mapping keeps the file open
+    close(file);
+
+    if (view == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    size = info.st_size;
+    return view;
+#endif
+}
+
+static void UnmapFile(void* view, size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view, size);
+#endif
+}
+
+Map::Map() :
+    m_width(0),
+    m_height(0),
+    m_tileSize(1),
+    m_chunkShift(0),
+    m_chunksX(0),
+    m_dataSize(0),
+    m_tiles(nullptr),
+    m_mapping(nullptr),
+    m_mappingSize(0)
+{
+}
+
+Map::~Map()
+{
+    Unload();
+}
+
+bool Map::Load(const std::string& fileName)
+{
+    size_t size = 0;
+    void* view = MapFile(fileName, size);
+    if (!view)
+    {
+        std::cerr << "Could not open map " << fileName << std::endl;
+        return false;
+    }
+
+    MapHeader header;
+    bool valid = (size >= sizeof(header));
+    if (valid)
+    {
+        memcpy(&header, view, sizeof(header));
+        valid = (memcmp(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC)) == 0 && header.version == MAP_VERSION);
+    }
+
+    // Check the layout on a scratch map, so a bad file leaves this one alone
+    Map loaded;
+    if (valid)
+    {
+        valid = loaded.SetLayout(header.width, header.height, header.tileSize, header.chunkShift) &&
+            size >= sizeof(header) + loaded.m_dataSize;
+    }
+
+    if (!valid)
+    {
+        std::cerr << "Not a valid version " << MAP_VERSION << " map: " << fileName << std::endl;
+        UnmapFile(view, size);
+        return false;
+    }
+
+    Unload();
+    SetLayout(header.width, header.height, header.tileSize, header.chunkShift);
+    m_mapping = view;
+    m_mappingSize = size;
+    m_tiles = (byte*)view + sizeof(header);
+
+    return true;
+}
+
+bool Map::Create(int width, int height, int tileSize, int chunkShift)
+{
+    Unload();
+    if (!SetLayout(width, height, tileSize, chunkShift))
+    {
+        return false;
+    }
+
+    m_storage.assign(m_dataSize, 0);
+    m_tiles = m_storage.data();
+
+    return true;
+}
+
+bool Map::Save(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    MapHeader header = {};
+    memcpy(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+    header.version = MAP_VERSION;
+    header.width = m_width;
+    header.height = m_height;
+    header.tileSize = m_tileSize;
+    header.chunkShift = m_chunkShift;
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)m_tiles, m_dataSize);
+
+    return file.good();
+}
+
+void Map::Unload()
+{
+    if (m_mapping)
+    {
+        UnmapFile(m_mapping, m_mappingSize);
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+    }
+
+    std::vector<byte>().swap(m_storage);
+    m_tiles = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_chunksX = 0;
+    m_dataSize = 0;
+}
+
+bool Map::SetLayout(int width, int height, int tileSize, int chunkShift)
+{
+    if (width <= 0 || height <= 0 || (tileSize != 1 && tileSize != 2 && tileSize != 4) ||
+        chunkShift < 0 || chunkShift > MAP_MAX_CHUNK_SHIFT)
+    {
+        return false;
+    }
+
+    int chunkSize = 1 << chunkShift;
+    Uint64 chunksX = ((Uint64)width + chunkSize - 1) >> chunkShift;
+    Uint64 chunksY = ((Uint64)height + chunkSize - 1) >> chunkShift;
+    Uint64 chunkBytes = (Uint64)tileSize << (2 * chunkShift);
+
+    // Too big to address at all. Maps past the packet tracers' 32 bit offsets are
+    // fine, they're traced a ray at a time, see FitsPacketTracers().
+    if (chunksX * chunksY > ((Uint64)SIZE_MAX - MAP_PADDING) / chunkBytes)
+    {
+        return false;
+    }
+
+    Uint64 tileBytes = chunksX * chunksY * chunkBytes;
+
+    m_width = width;
+    m_height = height;
+    m_tileSize = tileSize;
+    m_chunkShift = chunkShift;
+    m_chunksX = (int)chunksX;
+    m_dataSize = (size_t)tileBytes + MAP_PADDING;
+
+    return true;
+}
+
+size_t Map::GetTileOffset(int x, int y) const
+{
+    int mask = (1 << m_chunkShift) - 1;
+    size_t chunk = (size_t)(y >> m_chunkShift) * m_chunksX + (x >> m_chunkShift);
+    size_t index = (chunk << (2 * m_chunkShift)) + ((size_t)(y & mask) << m_chunkShift) + (x & mask);
+
+    return index * m_tileSize;
+}
+
+int Map::GetWidth() const
+{
+    return m_width;
+}
+
+int Map::GetHeight() const
+{
+    return m_height;
+}
+
+int Map::GetTileSize() const
+{
+    return m_tileSize;
+}
+
+int Map::GetChunkShift() const
+{
+    return m_chunkShift;
+}
+
+bool Map::IsInside(int x, int y) const
+{
+    return x >= 0 && y >= 0 && x < m_width && y < m_height;
+}
+
+int Map::GetTile(int x, int y) const
+{
+    const byte* p = m_tiles + GetTileOffset(x, y);
+
+    unsigned int tile = 0;
+    for (int i = 0; i < m_tileSize; i++)
+    {
+        tile |= (unsigned int)p[i] << (i * 8);
+    }
+
+    return (int)tile;
+}
+
+void Map::SetTile(int x, int y, int tile)
+{
+    byte* p = m_tiles + GetTileOffset(x, y);
+    for (int i = 0; i < m_tileSize; i++)
+    {
+        p[i] = (byte)(tile >> (i * 8));
+    }
+}
+
+GridView Map::GetGridView(double originX, double originY) const
+{
+    GridView grid;
+    grid.tiles = m_tiles;
+    grid.width = m_width;
+    grid.height = m_height;
+    grid.tileSize = m_tileSize;
+    grid.chunkShift = m_chunkShift;
+    grid.chunksX = m_chunksX;
+    grid.originX = originX;
+    grid.originY = originY;
+    grid.space = nullptr;
+
+    return grid;
+}
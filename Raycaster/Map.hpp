@@ -0,0 +1,78 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <string>
+#include <vector>
+#include "RayTrace.hpp"
+
+// Binary map file:
+//   MapHeader, then the tiles, then MAP_PADDING zero bytes.
+//
+// Tiles are tileSize bytes each, little-endian. They're stored in square chunks of
+// (1 << chunkShift) tiles on a side, chunk after chunk in rows, and row by row
+// inside each chunk. A ray only touches a few chunks, so a map far larger than
+// memory can be mapped in and paged from disk as it's looked at.
+// Chunks on the right and bottom edges are stored full size.
+// A chunkShift of 0 is plain row-major storage.
+//
+// The padding lets tiles be read 4 bytes at a time, whatever their size.
+
+const Uint32 MAP_VERSION = 1;
+const int MAP_PADDING = 4;
+const int MAP_MAX_CHUNK_SHIFT = 10;
+
+struct MapHeader
+{
+    char magic[4]; // "RCMP"
+    Uint32 version;
+    Uint32 width;
+    Uint32 height;
+    Uint32 tileSize; // 1, 2 or 4
+    Uint32 chunkShift;
+    Uint32 reserved[2];
+};
+
+class Map
+{
+public:
+    Map();
+    ~Map();
+
+    // Maps a map file into memory. Pages are read in as the tiles are touched,
+    // and SetTile() only changes the copy in memory, never the file.
+    bool Load(const std::string& fileName);
+
+    // A new map held in memory, with every tile empty
+    bool Create(int width, int height, int tileSize, int chunkShift);
+
+    bool Save(const std::string& fileName) const;
+    void Unload();
+
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetTileSize() const;
+    int GetChunkShift() const;
+
+    bool IsInside(int x, int y) const;
+    int GetTile(int x, int y) const;
+    void SetTile(int x, int y, int tile);
+
+    // For the ray tracers, with the rays starting at the given point
+    GridView GetGridView(double originX, double originY) const;
+
+private:
+    bool SetLayout(int width, int height, int tileSize, int chunkShift);
+    size_t GetTileOffset(int x, int y) const;
+
+    int m_width;
+    int m_height;
+    int m_tileSize;
+    int m_chunkShift;
+    int m_chunksX;
+    size_t m_dataSize; // Tiles and padding
+
+    byte* m_tiles;
+    std::vector<byte> m_storage; // Created maps
+    void* m_mapping; // Loaded maps, the whole file
+    size_t m_mappingSize;
+};
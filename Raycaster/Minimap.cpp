@@ -0,0 +1,243 @@
+#include "Minimap.hpp"
+#include <algorithm>
+#include <string.h>
+
+MinimapLayer::MinimapLayer() :
+    m_mapWidth(0),
+    m_mapHeight(0),
+    m_tilePixels(MINIMAP_MAX_TILE_PIXELS),
+    m_windowX(0),
+    m_windowY(0),
+    m_windowTilesX(0),
+    m_windowTilesY(0),
+    m_cacheX(0),
+    m_cacheY(0),
+    m_cacheTilesX(0),
+    m_cacheTilesY(0),
+    m_rebuild(true)
+{
+}
+
+void MinimapLayer::Invalidate()
+{
+    m_rebuild = true;
+    m_dirtyTiles.clear();
+}
+
+void MinimapLayer::InvalidateTile(int x, int y)
+{
+    if (!m_rebuild)
+    {
+        m_dirtyTiles.push_back(std::make_pair(x, y));
+    }
+}
+
+void MinimapLayer::Update(const Map& map, double playerX, double playerY, int size, Pixel (*tileColor)(int tile))
+{
+    if (map.GetWidth() != m_mapWidth || map.GetHeight() != m_mapHeight)
+    {
+        m_mapWidth = map.GetWidth();
+        m_mapHeight = map.GetHeight();
+        m_rebuild = true;
+    }
+
+    // Every cached tile is drawn at the old size when the tiles change size
+    int largest = std::max(std::max(m_mapWidth, m_mapHeight), 1);
+    int tilePixels = std::min(std::max(size / largest, MINIMAP_MIN_TILE_PIXELS), MINIMAP_MAX_TILE_PIXELS);
+    if (tilePixels != m_tilePixels)
+    {
+        m_tilePixels = tilePixels;
+        m_rebuild = true;
+    }
+
+    // Centered on the player, but kept inside the map
+    int windowTiles = std::max(size / m_tilePixels, 1);
+    m_windowTilesX = std::min(m_mapWidth, windowTiles);
+    m_windowTilesY = std::min(m_mapHeight, windowTiles);
+    m_windowX = std::min(std::max((int)floor(playerX) - m_windowTilesX / 2, 0), m_mapWidth - m_windowTilesX);
+    m_windowY = std::min(std::max((int)floor(playerY) - m_windowTilesY / 2, 0), m_mapHeight - m_windowTilesY);
+
+    // On maps too big for the buffer, it moves once the window runs off its edge
+    bool inside = m_windowX >= m_cacheX && m_windowX + m_windowTilesX <= m_cacheX + m_cacheTilesX &&
+        m_windowY >= m_cacheY && m_windowY + m_windowTilesY <= m_cacheY + m_cacheTilesY;
+
+    if (m_rebuild || !inside)
+    {
+        Rebuild(map, tileColor);
+        return;
+    }
+
+    for (size_t i = 0; i < m_dirtyTiles.size(); i++)
+    {
+        int x = m_dirtyTiles[i].first;
+        int y = m_dirtyTiles[i].second;
+        if (x >= m_cacheX && x < m_cacheX + m_cacheTilesX && y >= m_cacheY && y < m_cacheY + m_cacheTilesY)
+        {
+            DrawTile(map, x, y, tileColor);
+            FindRuns(map, y);
+        }
+    }
+
+    m_dirtyTiles.clear();
+}
+
+void MinimapLayer::Rebuild(const Map& map, Pixel (*tileColor)(int tile))
+{
+    m_cacheTilesX = std::min(m_mapWidth, MINIMAP_CACHE_TILES);
+    m_cacheTilesY = std::min(m_mapHeight, MINIMAP_CACHE_TILES);
+    m_cacheX = std::min(std::max(m_windowX + m_windowTilesX / 2 - m_cacheTilesX / 2, 0), m_mapWidth - m_cacheTilesX);
+    m_cacheY = std::min(std::max(m_windowY + m_windowTilesY / 2 - m_cacheTilesY / 2, 0), m_mapHeight - m_cacheTilesY);
+
+    m_pixels.assign((size_t)m_cacheTilesX * m_cacheTilesY * m_tilePixels * m_tilePixels, 0);
+    m_runs.assign(m_cacheTilesY, std::vector<Run>());
+
+    for (int y = m_cacheY; y < m_cacheY + m_cacheTilesY; y++)
+    {
+        for (int x = m_cacheX; x < m_cacheX + m_cacheTilesX; x++)
+        {
+            DrawTile(map, x, y, tileColor);
+        }
+
+        FindRuns(map, y);
+    }
+
+    m_rebuild = false;
+    m_dirtyTiles.clear();
+}
+
+void MinimapLayer::DrawTile(const Map& map, int x, int y, Pixel (*tileColor)(int tile))
+{
+    int tile = map.GetTile(x, y);
+    Pixel color = (tile != 0) ? tileColor(tile) : 0;
+
+    int pitch = m_cacheTilesX * m_tilePixels;
+    Pixel* topLeft = &m_pixels[(size_t)(y - m_cacheY) * m_tilePixels * pitch + (size_t)(x - m_cacheX) * m_tilePixels];
+    FillRect(topLeft, pitch, m_tilePixels, m_tilePixels, color);
+}
+
+void MinimapLayer::FindRuns(const Map& map, int y)
+{
+    std::vector<Run>& runs = m_runs[y - m_cacheY];
+    runs.clear();
+
+    for (int x = 0; x < m_cacheTilesX; x++)
+    {
+        if (map.GetTile(m_cacheX + x, y) == 0)
+        {
+            continue;
+        }
+
+        if (!runs.empty() && runs.back().start + runs.back().length == x)
+        {
+            runs.back().length++;
+        }
+        else
+        {
+            Run run = { x, 1 };
+            runs.push_back(run);
+        }
+    }
+}
+
+void MinimapLayer::Draw(Pixel* target, int pitch, int targetWidth, int targetHeight, const Pvs* pvs, const byte* visible) const
+{
+    int left = m_windowX - m_cacheX;
+    int right = left + m_windowTilesX;
+
+    for (int tileY = 0; tileY < m_windowTilesY; tileY++)
+    {
+        int screenY = tileY * m_tilePixels;
+        int rows = std::min(m_tilePixels, targetHeight - screenY);
+        if (rows <= 0)
+        {
+            break;
+        }
+
+        int cacheRow = m_windowY - m_cacheY + tileY;
+        const std::vector<Run>& runs = m_runs[cacheRow];
+
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            int start = std::max(runs[i].start, left);
+            int end = std::min(runs[i].start + runs[i].length, right);
+            if (!pvs)
+            {
+                DrawRun(target, pitch, targetWidth, screenY, rows, cacheRow, start, end);
+                continue;
+            }
+
+            // A cluster at a time, joining up the visible ones next to each other
+            int mapY = m_cacheY + cacheRow;
+            int clusterShift = pvs->GetClusterShift();
+            while (start < end)
+            {
+                int pieceEnd = start;
+                bool shown = pvs->IsTileVisible(visible, m_cacheX + start, mapY);
+                while (pieceEnd < end && pvs->IsTileVisible(visible, m_cacheX + pieceEnd, mapY) == shown)
+                {
+                    pieceEnd = ((((m_cacheX + pieceEnd) >> clusterShift) + 1) << clusterShift) - m_cacheX;
+                }
+
+                pieceEnd = std::min(pieceEnd, end);
+                if (shown)
+                {
+                    DrawRun(target, pitch, targetWidth, screenY, rows, cacheRow, start, pieceEnd);
+                }
+
+                start = pieceEnd;
+            }
+        }
+    }
+}
+
+void MinimapLayer::DrawRun(Pixel* target, int pitch, int targetWidth, int screenY, int rows, int cacheRow, int start, int end) const
+{
+    int left = m_windowX - m_cacheX;
+    if (start >= end)
+    {
+        return;
+    }
+
+    // Each run is a solid block of walls, a row of pixels at a time
+    int screenX = (start - left) * m_tilePixels;
+    int width = std::min((end - start) * m_tilePixels, targetWidth - screenX);
+    if (width <= 0)
+    {
+        return;
+    }
+
+    size_t cachePitch = (size_t)m_cacheTilesX * m_tilePixels;
+    const Pixel* source = &m_pixels[(size_t)cacheRow * m_tilePixels * cachePitch + (size_t)start * m_tilePixels];
+    Pixel* destination = target + (size_t)screenY * pitch + screenX;
+    for (int row = 0; row < rows; row++)
+    {
+        memcpy(destination, source, width * sizeof(Pixel));
+        source += cachePitch;
+        destination += pitch;
+    }
+}
+
+int MinimapLayer::GetTilePixels() const
+{
+    return m_tilePixels;
+}
+
+int MinimapLayer::GetWindowX() const
+{
+    return m_windowX;
+}
+
+int MinimapLayer::GetWindowY() const
+{
+    return m_windowY;
+}
+
+int MinimapLayer::GetWindowTilesX() const
+{
+    return m_windowTilesX;
+}
+
+int MinimapLayer::GetWindowTilesY() const
+{
+    return m_windowTilesY;
+}
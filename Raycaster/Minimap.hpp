@@ -0,0 +1,89 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <utility>
+#include <vector>
+#include "Map.hpp"
+#include "Pixel.hpp"
+#include "Pvs.hpp"
+
+// The minimap, drawn once into its own buffer and copied onto each frame.
+// Only the tiles that change get drawn again.
+//
+// Maps up to MINIMAP_MAX_TILES across are shown whole, each tile scaled to fit
+// MINIMAP_SIZE pixels. Bigger maps show a window of that many tiles around the player.
+// At lower render resolutions the minimap shrinks to match.
+
+// Pixels across the minimap at the largest render resolution, at most
+const int MINIMAP_SIZE = 240;
+
+// Pixels across a tile, at most and at least
+const int MINIMAP_MAX_TILE_PIXELS = 8;
+const int MINIMAP_MIN_TILE_PIXELS = 2;
+
+const int MINIMAP_MAX_TILES = MINIMAP_SIZE / MINIMAP_MIN_TILE_PIXELS;
+
+// The buffer holds at most this many tiles on a side, around the window
+const int MINIMAP_CACHE_TILES = 512;
+
+class MinimapLayer
+{
+public:
+    MinimapLayer();
+
+    // The whole map changed, draw it all again
+    void Invalidate();
+
+    // One tile changed
+    void InvalidateTile(int x, int y);
+
+    // Places the window around the player, and brings the buffer up to date.
+    // size is the most pixels across the minimap can take up.
+    void Update(const Map& map, double playerX, double playerY, int size, Pixel (*tileColor)(int tile));
+
+    // Copies the walls onto the target, leaving the open tiles see-through. With a
+    // PVS row, only the walls in clusters it can see are drawn.
+    void Draw(Pixel* target, int pitch, int targetWidth, int targetHeight, const Pvs* pvs, const byte* visible) const;
+
+    // The window is tiles [windowX, windowX + windowTiles) on each axis, drawn
+    // from the top left of the screen at GetTilePixels() pixels a tile
+    int GetTilePixels() const;
+    int GetWindowX() const;
+    int GetWindowY() const;
+    int GetWindowTilesX() const;
+    int GetWindowTilesY() const;
+
+private:
+    // A run of walls along a row of tiles, in tiles from the buffer's left edge
+    struct Run
+    {
+        int start;
+        int length;
+    };
+
+    void Rebuild(const Map& map, Pixel (*tileColor)(int tile));
+    void DrawTile(const Map& map, int x, int y, Pixel (*tileColor)(int tile));
+    void FindRuns(const Map& map, int y);
+
+    // Copies tiles [start, end) of a row of the buffer, rows pixels high
+    void DrawRun(Pixel* target, int pitch, int targetWidth, int screenY, int rows, int cacheRow, int start, int end) const;
+
+    int m_mapWidth;
+    int m_mapHeight;
+    int m_tilePixels;
+    int m_windowX;
+    int m_windowY;
+    int m_windowTilesX;
+    int m_windowTilesY;
+
+    // The part of the map in the buffer
+    int m_cacheX;
+    int m_cacheY;
+    int m_cacheTilesX;
+    int m_cacheTilesY;
+
+    bool m_rebuild;
+    std::vector<std::pair<int, int> > m_dirtyTiles;
+    std::vector<Pixel> m_pixels;
+    std::vector<std::vector<Run> > m_runs; // One list per row of tiles
+};
@@ -0,0 +1,77 @@
+#include "Pixel.hpp"
+#include "Simd.hpp"
+
+#ifdef RAYCASTER_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+void FillSpan(Pixel* start, int count, Pixel color)
+{
+    Pixel* pixel = start;
+    Pixel* end = start + (count > 0 ? count : 0);
+
+#ifdef RAYCASTER_HAVE_SSE2
+    // Single pixels up to a 16 byte boundary, then aligned stores of 8 and 4
+    while (pixel < end && ((size_t)pixel & 15) != 0)
+    {
+        *pixel++ = color;
+    }
+
+    const __m128i wide = _mm_set1_epi32((int)color);
+    for (; end - pixel >= 8; pixel += 8)
+    {
+        _mm_store_si128((__m128i*)pixel, wide);
+        _mm_store_si128((__m128i*)(pixel + 4), wide);
+    }
+
+    if (end - pixel >= 4)
+    {
+        _mm_store_si128((__m128i*)pixel, wide);
+        pixel += 4;
+    }
+#endif
+
+    while (pixel < end)
+    {
+        *pixel++ = color;
+    }
+}
+
+void FillVerticalSpan(Pixel* top, int pitch, int count, Pixel color)
+{
+    Pixel* pixel = top;
+    int y = 0;
+
+    for (; y + 4 <= count; y += 4, pixel += 4 * pitch)
+    {
+        pixel[0] = color;
+        pixel[pitch] = color;
+        pixel[2 * pitch] = color;
+        pixel[3 * pitch] = color;
+    }
+
+    for (; y < count; y++, pixel += pitch)
+    {
+        *pixel = color;
+    }
+}
+
+void FillRect(Pixel* topLeft, int pitch, int width, int height, Pixel color)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    // Rows with nothing between them are one long span
+    if (width == pitch)
+    {
+        FillSpan(topLeft, width * height, color);
+        return;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        FillSpan(topLeft + (size_t)y * pitch, width, color);
+    }
+}
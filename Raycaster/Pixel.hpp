@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PCH.hpp"
+
+// One SDL_PIXELFORMAT_RGBA8888 pixel: red in the top byte, alpha in the bottom one
+typedef Uint32 Pixel;
+
+constexpr Pixel MakePixel(Uint32 red, Uint32 green, Uint32 blue, Uint32 alpha = 255)
+{
+    return (red << 24) | (green << 16) | (blue << 8) | alpha;
+}
+
+constexpr Pixel PIXEL_BLACK = MakePixel(0, 0, 0);
+constexpr Pixel PIXEL_WHITE = MakePixel(255, 255, 255);
+constexpr Pixel PIXEL_GRAY = MakePixel(128, 128, 128);
+constexpr Pixel PIXEL_RED = MakePixel(194, 59, 34);
+constexpr Pixel PIXEL_GREEN = MakePixel(119, 190, 119);
+constexpr Pixel PIXEL_BLUE = MakePixel(119, 158, 203);
+constexpr Pixel PIXEL_CYAN = MakePixel(0, 255, 255);
+constexpr Pixel PIXEL_MAGENTA = MakePixel(255, 0, 255);
+
+// Half as bright, same alpha
+constexpr Pixel ShadePixel(Pixel pixel)
+{
+    return ((pixel >> 1) & 0x7F7F7F00) | (pixel & 0xFF);
+}
+
+// Fills without any bounds checks: the caller clips. Counts of 0 or less draw nothing.
+
+// count pixels along a row, four at a time where it can
+void FillSpan(Pixel* start, int count, Pixel color);
+
+// count pixels down a column, pitch pixels apart
+void FillVerticalSpan(Pixel* top, int pitch, int count, Pixel color);
+
+// width x height pixels, from the top left corner
+void FillRect(Pixel* topLeft, int pitch, int width, int height, Pixel color);
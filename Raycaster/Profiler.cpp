@@ -0,0 +1,263 @@
+#include "PCH.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+Profiler profiler;
+
+static const char* STAGE_NAMES[PROFILE_STAGE_COUNT] =
+{
+    "input",
+    "simulate",
+    "surfaces",
+    "cast",
+    "raster",
+    "sprites",
+    "minimap",
+    "capture",
+    "upload",
+    "present",
+    "wait"
+};
+
+const char* GetProfileStageName(ProfileStage stage)
+{
+    return STAGE_NAMES[stage];
+}
+
+static const char* TRACK_NAMES[PROFILE_TRACK_COUNT] =
+{
+    "main",
+    "render"
+};
+
+const char* GetProfileTrackName(ProfileTrack track)
+{
+    return TRACK_NAMES[track];
+}
+
+Profiler::Profiler()
+{
+    for (int i = 0; i < PROFILE_TRACK_COUNT; i++)
+    {
+        Track& track = m_tracks[i];
+        track.current.index = 0;
+        track.current.start = 0;
+        track.current.end = 0;
+        track.current.eventCount = 0;
+        track.frames.resize(PROFILE_HISTORY);
+        track.written.store(0);
+        track.thread.store(std::thread::id());
+    }
+
+    m_tracks[PROFILE_TRACK_MAIN].thread.store(std::this_thread::get_id());
+}
+
+void Profiler::SetThread(ProfileTrack track)
+{
+    m_tracks[track].thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
+
+Profiler::Track* Profiler::GetTrack()
+{
+    std::thread::id thread = std::this_thread::get_id();
+    for (int i = 0; i < PROFILE_TRACK_COUNT; i++)
+    {
+        if (m_tracks[i].thread.load(std::memory_order_relaxed) == thread)
+        {
+            return &m_tracks[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void Profiler::AddEvent(ProfileStage stage, Uint64 start, Uint64 end)
+{
+    Track* track = GetTrack();
+    if (!track)
+    {
+        return;
+    }
+
+    // The first frame starts with its first scope, the rest where the last one ended
+    ProfileFrame& current = track->current;
+    if (current.start == 0)
+    {
+        current.start = start;
+    }
+
+    if (current.eventCount < PROFILE_MAX_EVENTS)
+    {
+        ProfileEvent& event = current.events[current.eventCount++];
+        event.stage = stage;
+        event.start = start;
+        event.end = end;
+    }
+}
+
+void Profiler::EndFrame()
+{
+    Track* track = GetTrack();
+    if (!track)
+    {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 written = track->written.load(std::memory_order_relaxed);
+    ProfileFrame& current = track->current;
+
+    current.index = written;
+    current.end = now;
+    if (current.start == 0)
+    {
+        current.start = now;
+    }
+
+    track->frames[written % PROFILE_HISTORY] = current;
+    track->written.store(written + 1, std::memory_order_release);
+
+    current.start = now;
+    current.eventCount = 0;
+}
+
+void Profiler::GetFrames(ProfileTrack trackIndex, std::vector<ProfileFrame>& frames) const
+{
+    const Track& track = m_tracks[trackIndex];
+    Uint64 before = track.written.load(std::memory_order_acquire);
+    Uint64 first = (before > (Uint64)PROFILE_HISTORY) ? before - PROFILE_HISTORY : 0;
+
+    frames.clear();
+    for (Uint64 index = first; index < before; index++)
+    {
+        frames.push_back(track.frames[index % PROFILE_HISTORY]);
+    }
+
+    // Any slot the writer got to while we were copying may hold half of a newer
+    // frame. It has finished up to frame after - 1 and may be copying frame after,
+    // over frame after - PROFILE_HISTORY, so only the frames past that are whole.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    Uint64 after = track.written.load(std::memory_order_relaxed);
+    if (after + 1 > (Uint64)PROFILE_HISTORY && after + 1 - PROFILE_HISTORY > first)
+    {
+        size_t dropped = (size_t)std::min(after + 1 - PROFILE_HISTORY - first, (Uint64)frames.size());
+        frames.erase(frames.begin(), frames.begin() + dropped);
+    }
+}
+
+Uint64 Profiler::GetFrameCount(ProfileTrack track) const
+{
+    return m_tracks[track].written.load(std::memory_order_acquire);
+}
+
+// One row per frame of each track, with the total time in each stage
+bool Profiler::WriteCsv(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file)
+    {
+        std::cerr << "Could not write " << fileName << std::endl;
+        return false;
+    }
+
+    double tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+
+    file << std::fixed << std::setprecision(4);
+    file << "thread,frame,frame_ms";
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        file << "," << STAGE_NAMES[stage] << "_ms";
+    }
+    file << std::endl;
+
+    std::vector<ProfileFrame> frames;
+    for (int track = 0; track < PROFILE_TRACK_COUNT; track++)
+    {
+        GetFrames((ProfileTrack)track, frames);
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            const ProfileFrame& frame = frames[i];
+
+            Uint64 stageTicks[PROFILE_STAGE_COUNT] = {};
+            for (int e = 0; e < frame.eventCount; e++)
+            {
+                stageTicks[frame.events[e].stage] += frame.events[e].end - frame.events[e].start;
+            }
+
+            file << TRACK_NAMES[track] << "," << frame.index << "," << (frame.end - frame.start) * tickMs;
+            for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+            {
+                file << "," << stageTicks[stage] * tickMs;
+            }
+            file << std::endl;
+        }
+    }
+
+    return true;
+}
+
+// A complete ("X") event per frame and per stage, in microseconds from the first
+// frame. Each track gets a row for its frames and one for its stages.
+bool Profiler::WriteChromeTrace(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file)
+    {
+        std::cerr << "Could not write " << fileName << std::endl;
+        return false;
+    }
+
+    std::vector<ProfileFrame> frames[PROFILE_TRACK_COUNT];
+    Uint64 origin = 0;
+    for (int track = 0; track < PROFILE_TRACK_COUNT; track++)
+    {
+        GetFrames((ProfileTrack)track, frames[track]);
+        if (!frames[track].empty() && (origin == 0 || frames[track][0].start < origin))
+        {
+            origin = frames[track][0].start;
+        }
+    }
+
+    double tickUs = 1000000.0 / SDL_GetPerformanceFrequency();
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    // Names for the rows
+    for (int track = 0; track < PROFILE_TRACK_COUNT; track++)
+    {
+        for (int row = 0; row < 2; row++)
+        {
+            file << (track + row == 0 ? "" : ",") << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track * 2 + row + 1
+                << ",\"args\":{\"name\":\"" << TRACK_NAMES[track] << (row ? " stages" : " frames") << "\"}}";
+        }
+    }
+
+    for (int track = 0; track < PROFILE_TRACK_COUNT; track++)
+    {
+        int frameRow = track * 2 + 1;
+        int stageRow = track * 2 + 2;
+
+        for (size_t i = 0; i < frames[track].size(); i++)
+        {
+            const ProfileFrame& frame = frames[track][i];
+
+            file << "," << std::endl << "{\"name\":\"" << TRACK_NAMES[track] << " frame " << frame.index
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << frameRow << ",\"ts\":"
+                << (frame.start - origin) * tickUs << ",\"dur\":" << (frame.end - frame.start) * tickUs << "}";
+
+            for (int e = 0; e < frame.eventCount; e++)
+            {
+                const ProfileEvent& event = frame.events[e];
+                file << "," << std::endl << "{\"name\":\"" << STAGE_NAMES[event.stage] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << stageRow << ",\"ts\":"
+                    << (event.start - origin) * tickUs << ",\"dur\":" << (event.end - event.start) * tickUs << "}";
+            }
+        }
+    }
+    file << std::endl << "]}" << std::endl;
+
+    return true;
+}
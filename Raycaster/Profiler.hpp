@@ -0,0 +1,134 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Times the stages of each frame off the performance counter, and keeps the last
+// PROFILE_HISTORY frames for writing out as CSV or as a Chrome trace
+// (chrome://tracing or ui.perfetto.dev).
+//
+// Stages are timed with PROFILE_SCOPE(stage), which times the rest of the enclosing
+// block, and a frame is closed with PROFILE_FRAME_END(). Each thread that records
+// has a track of its own: the main thread's, and with the pipelined game loop the
+// render thread's, which it claims with PROFILE_THREAD(PROFILE_TRACK_RENDER). Scopes
+// on any other thread aren't recorded. Building with -DRAYCASTER_PROFILE=OFF turns
+// them into nothing.
+
+enum ProfileStage
+{
+    PROFILE_INPUT, // Events and ProcessInput()
+    PROFILE_SIMULATE, // The fixed simulation steps
+    PROFILE_SURFACES, // Distance field, sprite grid and ceiling and floor rows
+    PROFILE_CAST, // The column loop
+    PROFILE_RASTER, // Filling the framebuffer from the display list
+    PROFILE_SPRITES,
+    PROFILE_MINIMAP, // The rays and the minimap
+    PROFILE_CAPTURE, // Handing the frame to the capture writer
+    PROFILE_UPLOAD, // Getting the frame into the screen texture
+    PROFILE_PRESENT,
+    PROFILE_WAIT, // Waiting for the next frame to be due
+    PROFILE_STAGE_COUNT
+};
+
+const char* GetProfileStageName(ProfileStage stage);
+
+enum ProfileTrack
+{
+    PROFILE_TRACK_MAIN, // The thread the profiler was made on
+    PROFILE_TRACK_RENDER, // The pipelined loop's render thread
+    PROFILE_TRACK_COUNT
+};
+
+const char* GetProfileTrackName(ProfileTrack track);
+
+const int PROFILE_HISTORY = 1024;
+
+// Scopes past this many in a frame aren't recorded
+const int PROFILE_MAX_EVENTS = 32;
+
+struct ProfileEvent
+{
+    int stage;
+    Uint64 start; // Performance counter ticks
+    Uint64 end;
+};
+
+struct ProfileFrame
+{
+    Uint64 index;
+    Uint64 start;
+    Uint64 end;
+    int eventCount;
+    ProfileEvent events[PROFILE_MAX_EVENTS];
+};
+
+// Each track's frames go in a ring written by its thread alone. Any thread can copy
+// them out without stopping it: frames overwritten during the copy are dropped.
+class Profiler
+{
+public:
+    Profiler();
+
+    // Records the calling thread's scopes on the track from now on
+    void SetThread(ProfileTrack track);
+
+    void AddEvent(ProfileStage stage, Uint64 start, Uint64 end);
+    void EndFrame();
+
+    // The track's frames still in the ring, oldest first
+    void GetFrames(ProfileTrack track, std::vector<ProfileFrame>& frames) const;
+
+    Uint64 GetFrameCount(ProfileTrack track) const;
+
+    bool WriteCsv(const std::string& fileName) const;
+    bool WriteChromeTrace(const std::string& fileName) const;
+
+private:
+    struct Track
+    {
+        ProfileFrame current;
+        std::vector<ProfileFrame> frames;
+        std::atomic<Uint64> written; // Frames ever finished
+        std::atomic<std::thread::id> thread; // The one whose scopes are recorded
+    };
+
+    Track* GetTrack();
+
+    Track m_tracks[PROFILE_TRACK_COUNT];
+};
+
+extern Profiler profiler;
+
+class ProfileScope
+{
+public:
+    ProfileScope(ProfileStage stage) :
+        m_stage(stage),
+        m_start(SDL_GetPerformanceCounter())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        profiler.AddEvent(m_stage, m_start, SDL_GetPerformanceCounter());
+    }
+
+private:
+    ProfileStage m_stage;
+    Uint64 m_start;
+};
+
+#ifdef RAYCASTER_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage)
+#define PROFILE_FRAME_END() profiler.EndFrame()
+#define PROFILE_THREAD(track) profiler.SetThread(track)
+#else
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_THREAD(track) ((void)0)
+#endif
@@ -0,0 +1,604 @@
+#include "Pvs.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include "DistanceField.hpp"
+
+static const char PVS_MAGIC[4] = { 'R', 'P', 'V', 'S' };
+
+// Each sample point turns its fan of rays by this fraction of the gap between
+// rays more than the last, so together they fill in the gaps
+static const double SAMPLE_TURN = 0.6180339887;
+
+// FillGaps() tries clusters from two up to this many from one the fans reached,
+// with up to this many random lines each
+static const int FILL_REACH = 3;
+static const int FILL_CHECKS = 1024;
+
+static bool IsSet(const byte* bits, int index)
+{
+    return (bits[index >> 3] >> (index & 7)) & 1;
+}
+
+Uint64 HashWalls(const Map& map)
+{
+    // FNV-1a over one bit per tile, 8 tiles a byte
+    Uint64 hash = 14695981039346656037ull;
+    hash = (hash ^ (Uint64)map.GetWidth()) * 1099511628211ull;
+    hash = (hash ^ (Uint64)map.GetHeight()) * 1099511628211ull;
+
+    int bits = 0;
+    int count = 0;
+    for (int y = 0; y < map.GetHeight(); y++)
+    {
+        for (int x = 0; x < map.GetWidth(); x++)
+        {
+            bits |= (map.GetTile(x, y) != 0) << count;
+            if (++count == 8)
+            {
+                hash = (hash ^ (Uint64)bits) * 1099511628211ull;
+                bits = 0;
+                count = 0;
+            }
+        }
+    }
+
+    return (hash ^ (Uint64)bits) * 1099511628211ull;
+}
+
+Pvs::Pvs() :
+    m_mapWidth(0),
+    m_mapHeight(0),
+    m_clusterShift(0),
+    m_clustersX(0),
+    m_clustersY(0),
+    m_rowBytes(0),
+    m_angleCount(0),
+    m_samplesPerTile(0),
+    m_wallHash(0)
+{
+}
+
+bool Pvs::Bake(const Map& map, int clusterShift, int angleCount, int samplesPerTile, ThreadPool* pool)
+{
+    Clear();
+
+    if (angleCount < 1 || samplesPerTile < 1 || !SetLayout(map.GetWidth(), map.GetHeight(), clusterShift))
+    {
+        return false;
+    }
+
+    m_angleCount = angleCount;
+    m_samplesPerTile = samplesPerTile;
+    m_wallHash = HashWalls(map);
+    m_bits.assign(m_rowBytes * GetClusterCount(), 0);
+
+    // The rays skip across open space, which most of a big map is
+    DistanceField field;
+    field.Build(map);
+    GridView grid = map.GetGridView(0, 0);
+    grid.space = field.GetCells();
+
+    std::vector<double> dirX(angleCount);
+    std::vector<double> dirY(angleCount);
+    for (int i = 0; i < angleCount; i++)
+    {
+        dirX[i] = cos(i * 2 * M_PI / angleCount);
+        dirY[i] = sin(i * 2 * M_PI / angleCount);
+    }
+
+    // Each cluster only writes its own row
+    ThreadPool::Job job = [&](int begin, int end, int)
+    {
+        std::vector<byte> scratch;
+        std::vector<int> openTiles;
+        for (int cluster = begin; cluster < end; cluster++)
+        {
+            BakeCluster(map, grid, cluster, dirX, dirY, samplesPerTile, scratch, openTiles);
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(GetClusterCount(), 1, job);
+    }
+    else
+    {
+        job(0, GetClusterCount(), 0);
+    }
+
+    return true;
+}
+
+void Pvs::BakeCluster(const Map& map, const GridView& grid, int cluster, const std::vector<double>& dirX, const std::vector<double>& dirY,
+    int samplesPerTile, std::vector<byte>& scratch, std::vector<int>& openTiles)
+{
+    byte* row = &m_bits[(size_t)cluster * m_rowBytes];
+    int clusterX = cluster % m_clustersX;
+    int clusterY = cluster / m_clustersX;
+    int size = 1 << m_clusterShift;
+    int right = std::min((clusterX + 1) * size, m_mapWidth);
+    int bottom = std::min((clusterY + 1) * size, m_mapHeight);
+
+    Mark(row, clusterX, clusterY);
+
+    GridView view = grid;
+    GridHit hit;
+    int sample = 0;
+    openTiles.clear();
+
+    for (int tileY = clusterY * size; tileY < bottom; tileY++)
+    {
+        for (int tileX = clusterX * size; tileX < right; tileX++)
+        {
+            if (map.GetTile(tileX, tileY) != 0)
+            {
+                continue;
+            }
+
+            openTiles.push_back(tileY * m_mapWidth + tileX);
+
+            for (int sampleY = 0; sampleY < samplesPerTile; sampleY++)
+            {
+                for (int sampleX = 0; sampleX < samplesPerTile; sampleX++, sample++)
+                {
+                    view.originX = tileX + (sampleX + 0.5) / samplesPerTile;
+                    view.originY = tileY + (sampleY + 0.5) / samplesPerTile;
+
+                    double turn = fmod(sample * SAMPLE_TURN, 1.0) * 2 * M_PI / dirX.size();
+                    double turnCos = cos(turn);
+                    double turnSin = sin(turn);
+
+                    for (size_t i = 0; i < dirX.size(); i++)
+                    {
+                        double rayDirX = dirX[i] * turnCos - dirY[i] * turnSin;
+                        double rayDirY = dirX[i] * turnSin + dirY[i] * turnCos;
+                        TraceRayDDA(view, rayDirX, rayDirY, hit);
+
+                        MarkSegment(row, view.originX, view.originY, hit.x, hit.y);
+                        if (hit.hit)
+                        {
+                            Mark(row, hit.tileX >> m_clusterShift, hit.tileY >> m_clusterShift);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (!openTiles.empty())
+    {
+        FillGaps(grid, cluster, openTiles, row, scratch);
+    }
+
+    // Grown by one cluster all round
+    scratch.assign(row, row + m_rowBytes);
+    Grow(scratch.data(), row, 1);
+}
+
+// Lines of sight that thread between walls far off can slip through every fan, so
+// the clusters near what the fans reached get random lines from this one as well
+void Pvs::FillGaps(const GridView& grid, int cluster, const std::vector<int>& openTiles, byte* row, std::vector<byte>& scratch) const
+{
+    int size = 1 << m_clusterShift;
+    GridView view = grid;
+    GridHit hit;
+
+    // Clusters next to what the fans reached are in the set anyway once it's grown,
+    // so only the ones further out are tried
+    scratch.assign(m_rowBytes * 2, 0);
+    byte* next = scratch.data();
+    byte* nearby = next + m_rowBytes;
+    Grow(row, next, 1);
+    Grow(row, nearby, FILL_REACH);
+
+    // Seeded by cluster, so the sets don't depend on how the bake was split over threads
+    std::mt19937 rng(cluster + 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (int other = 0; other < GetClusterCount(); other++)
+    {
+        if (!IsSet(nearby, other) || IsSet(next, other))
+        {
+            continue;
+        }
+
+        int otherX = other % m_clustersX;
+        int otherY = other / m_clustersX;
+        int otherWidth = std::min(size, m_mapWidth - otherX * size);
+        int otherHeight = std::min(size, m_mapHeight - otherY * size);
+
+        for (int check = 0; check < FILL_CHECKS; check++)
+        {
+            int tile = openTiles[rng() % openTiles.size()];
+            view.originX = tile % m_mapWidth + uniform(rng);
+            view.originY = tile / m_mapWidth + uniform(rng);
+            double targetX = otherX * size + uniform(rng) * otherWidth;
+            double targetY = otherY * size + uniform(rng) * otherHeight;
+
+            // Either nothing is in the way, or the wall in the way is in the other cluster
+            TraceSegmentDDA(view, targetX - view.originX, targetY - view.originY, 1, hit);
+            if (!hit.hit || ((hit.tileX >> m_clusterShift) == otherX && (hit.tileY >> m_clusterShift) == otherY))
+            {
+                MarkSegment(row, view.originX, view.originY, targetX, targetY);
+                break;
+            }
+        }
+    }
+}
+
+// Marks every cluster within reach of one set in from, in both directions
+void Pvs::Grow(const byte* from, byte* to, int reach) const
+{
+    for (size_t i = 0; i < m_rowBytes; i++)
+    {
+        for (int bit = 0; from[i] >> bit; bit++)
+        {
+            if (!((from[i] >> bit) & 1))
+            {
+                continue;
+            }
+
+            int index = (int)(i * 8) + bit;
+            int x = index % m_clustersX;
+            int y = index / m_clustersX;
+            for (int dy = -reach; dy <= reach; dy++)
+            {
+                for (int dx = -reach; dx <= reach; dx++)
+                {
+                    Mark(to, x + dx, y + dy);
+                }
+            }
+        }
+    }
+}
+
+// Marks every cluster the segment crosses, walking the cluster grid the same way
+// the tracers walk the tiles
+void Pvs::MarkSegment(byte* row, double startX, double startY, double endX, double endY) const
+{
+    double scale = 1.0 / (1 << m_clusterShift);
+    double x = startX * scale;
+    double y = startY * scale;
+    double dirX = (endX - startX) * scale;
+    double dirY = (endY - startY) * scale;
+
+    int clusterX = (int)floor(x);
+    int clusterY = (int)floor(y);
+    int lastX = (int)floor(endX * scale);
+    int lastY = (int)floor(endY * scale);
+
+    double deltaX = (dirX == 0) ? 1e30 : fabs(1 / dirX);
+    double deltaY = (dirY == 0) ? 1e30 : fabs(1 / dirY);
+    int stepX = (dirX < 0) ? -1 : 1;
+    int stepY = (dirY < 0) ? -1 : 1;
+    double sideX = (dirX < 0) ? (x - clusterX) * deltaX : (clusterX + 1.0 - x) * deltaX;
+    double sideY = (dirY < 0) ? (y - clusterY) * deltaY : (clusterY + 1.0 - y) * deltaY;
+
+    Mark(row, clusterX, clusterY);
+
+    // As many steps as it takes to get to the last cluster, which is marked
+    // anyway in case rounding took the walk off to one side of it
+    for (int steps = abs(lastX - clusterX) + abs(lastY - clusterY); steps > 0; steps--)
+    {
+        if (sideX < sideY)
+        {
+            clusterX += stepX;
+            sideX += deltaX;
+        }
+        else
+        {
+            clusterY += stepY;
+            sideY += deltaY;
+        }
+
+        Mark(row, clusterX, clusterY);
+    }
+
+    Mark(row, lastX, lastY);
+}
+
+void Pvs::Mark(byte* row, int clusterX, int clusterY) const
+{
+    if (clusterX < 0 || clusterY < 0 || clusterX >= m_clustersX || clusterY >= m_clustersY)
+    {
+        return;
+    }
+
+    int index = clusterY * m_clustersX + clusterX;
+    row[index >> 3] |= (byte)(1 << (index & 7));
+}
+
+bool Pvs::Save(const std::string& fileName) const
+{
+    if (!IsBaked())
+    {
+        return false;
+    }
+
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    PvsHeader header = {};
+    memcpy(header.magic, PVS_MAGIC, sizeof(PVS_MAGIC));
+    header.version = PVS_VERSION;
+    header.mapWidth = m_mapWidth;
+    header.mapHeight = m_mapHeight;
+    header.clusterShift = m_clusterShift;
+    header.angleCount = m_angleCount;
+    header.samplesPerTile = m_samplesPerTile;
+    header.wallHash = m_wallHash;
+    file.write((const char*)&header, sizeof(header));
+
+    std::vector<byte> coded((GetClusterCount() + 7) / 8, 0);
+    std::vector<byte> encoded;
+    for (int cluster = 0; cluster < GetClusterCount(); cluster++)
+    {
+        if (EncodeRow(&m_bits[(size_t)cluster * m_rowBytes], encoded))
+        {
+            coded[cluster >> 3] |= (byte)(1 << (cluster & 7));
+        }
+    }
+
+    file.write((const char*)coded.data(), coded.size());
+    file.write((const char*)encoded.data(), encoded.size());
+    return file.good();
+}
+
+// Appends the row run-length coded, or as it is when that's no smaller. Returns
+// whether it was coded.
+bool Pvs::EncodeRow(const byte* row, std::vector<byte>& out) const
+{
+    size_t start = out.size();
+    for (size_t i = 0; i < m_rowBytes && out.size() - start < m_rowBytes; )
+    {
+        if (row[i] != 0)
+        {
+            out.push_back(row[i++]);
+            continue;
+        }
+
+        size_t run = 0;
+        while (i < m_rowBytes && row[i] == 0 && run < 255)
+        {
+            i++;
+            run++;
+        }
+
+        out.push_back(0);
+        out.push_back((byte)run);
+    }
+
+    if (out.size() - start < m_rowBytes)
+    {
+        return true;
+    }
+
+    out.resize(start);
+    out.insert(out.end(), row, row + m_rowBytes);
+    return false;
+}
+
+bool Pvs::Load(const std::string& fileName, const Map& map)
+{
+    Clear();
+
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    PvsHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, PVS_MAGIC, sizeof(PVS_MAGIC)) != 0 || header.version != PVS_VERSION
+        || (int)header.mapWidth != map.GetWidth() || (int)header.mapHeight != map.GetHeight() || header.wallHash != HashWalls(map)
+        || !SetLayout(map.GetWidth(), map.GetHeight(), (int)header.clusterShift))
+    {
+        Clear();
+        return false;
+    }
+
+    std::vector<byte> encoded((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    m_bits.assign(m_rowBytes * GetClusterCount(), 0);
+
+    // Which rows are coded, then the rows back to back
+    size_t in = (GetClusterCount() + 7) / 8;
+    bool valid = (encoded.size() >= in);
+    for (int cluster = 0; cluster < GetClusterCount() && valid; cluster++)
+    {
+        byte* row = &m_bits[(size_t)cluster * m_rowBytes];
+        if (!((encoded[cluster >> 3] >> (cluster & 7)) & 1))
+        {
+            valid = (encoded.size() - in >= m_rowBytes);
+            if (valid)
+            {
+                std::copy(&encoded[in], &encoded[in] + m_rowBytes, row);
+                in += m_rowBytes;
+            }
+
+            continue;
+        }
+
+        size_t out = 0;
+        while (out < m_rowBytes && in < encoded.size())
+        {
+            if (encoded[in] != 0)
+            {
+                row[out++] = encoded[in++];
+                continue;
+            }
+
+            if (in + 1 >= encoded.size() || encoded[in + 1] == 0 || out + encoded[in + 1] > m_rowBytes)
+            {
+                break;
+            }
+
+            out += encoded[in + 1];
+            in += 2;
+        }
+
+        valid = (out == m_rowBytes);
+    }
+
+    if (!valid || in != encoded.size())
+    {
+        Clear();
+        return false;
+    }
+
+    m_angleCount = header.angleCount;
+    m_samplesPerTile = header.samplesPerTile;
+    m_wallHash = header.wallHash;
+    return true;
+}
+
+void Pvs::Clear()
+{
+    std::vector<byte>().swap(m_bits);
+    m_mapWidth = 0;
+    m_mapHeight = 0;
+    m_clusterShift = 0;
+    m_clustersX = 0;
+    m_clustersY = 0;
+    m_rowBytes = 0;
+    m_angleCount = 0;
+    m_samplesPerTile = 0;
+    m_wallHash = 0;
+}
+
+bool Pvs::IsBaked() const
+{
+    return !m_bits.empty();
+}
+
+bool Pvs::SetLayout(int mapWidth, int mapHeight, int clusterShift)
+{
+    if (mapWidth <= 0 || mapHeight <= 0 || clusterShift < PVS_MIN_CLUSTER_SHIFT || clusterShift > PVS_MAX_CLUSTER_SHIFT)
+    {
+        return false;
+    }
+
+    int size = 1 << clusterShift;
+    int clustersX = (mapWidth + size - 1) / size;
+    int clustersY = (mapHeight + size - 1) / size;
+    size_t count = (size_t)clustersX * clustersY;
+    size_t rowBytes = (count + 7) / 8;
+    if (rowBytes * count > PVS_MAX_BYTES)
+    {
+        return false;
+    }
+
+    m_mapWidth = mapWidth;
+    m_mapHeight = mapHeight;
+    m_clusterShift = clusterShift;
+    m_clustersX = clustersX;
+    m_clustersY = clustersY;
+    m_rowBytes = rowBytes;
+    return true;
+}
+
+int Pvs::GetClusterShift() const
+{
+    return m_clusterShift;
+}
+
+int Pvs::GetClustersX() const
+{
+    return m_clustersX;
+}
+
+int Pvs::GetClustersY() const
+{
+    return m_clustersY;
+}
+
+int Pvs::GetClusterCount() const
+{
+    return m_clustersX * m_clustersY;
+}
+
+int Pvs::GetAngleCount() const
+{
+    return m_angleCount;
+}
+
+int Pvs::GetSamplesPerTile() const
+{
+    return m_samplesPerTile;
+}
+
+const byte* Pvs::GetVisible(double x, double y) const
+{
+    if (!IsBaked() || x < 0 || y < 0 || x >= m_mapWidth || y >= m_mapHeight)
+    {
+        return nullptr;
+    }
+
+    int cluster = ((int)y >> m_clusterShift) * m_clustersX + ((int)x >> m_clusterShift);
+    return &m_bits[(size_t)cluster * m_rowBytes];
+}
+
+bool Pvs::IsClusterVisible(const byte* visible, int clusterX, int clusterY) const
+{
+    if (clusterX < 0 || clusterY < 0 || clusterX >= m_clustersX || clusterY >= m_clustersY)
+    {
+        return true;
+    }
+
+    int index = clusterY * m_clustersX + clusterX;
+    return (visible[index >> 3] >> (index & 7)) & 1;
+}
+
+bool Pvs::IsTileVisible(const byte* visible, int tileX, int tileY) const
+{
+    if (tileX < 0 || tileY < 0)
+    {
+        return true;
+    }
+
+    return IsClusterVisible(visible, tileX >> m_clusterShift, tileY >> m_clusterShift);
+}
+
+int Pvs::CountVisible(const byte* visible) const
+{
+    int count = 0;
+    for (int i = 0; i < GetClusterCount(); i++)
+    {
+        count += (visible[i >> 3] >> (i & 7)) & 1;
+    }
+
+    return count;
+}
+
+int Pvs::CullPoints(const byte* visible, const double* x, const double* y, int count, int* indices) const
+{
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (IsTileVisible(visible, (int)floor(x[i]), (int)floor(y[i])))
+        {
+            indices[kept++] = i;
+        }
+    }
+
+    return kept;
+}
+
+size_t Pvs::GetSize() const
+{
+    return m_bits.size();
+}
+
+size_t Pvs::GetFileSize() const
+{
+    std::vector<byte> encoded;
+    for (int cluster = 0; cluster < GetClusterCount(); cluster++)
+    {
+        EncodeRow(&m_bits[(size_t)cluster * m_rowBytes], encoded);
+    }
+
+    return sizeof(PvsHeader) + (GetClusterCount() + 7) / 8 + encoded.size();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <string>
+#include <vector>
+#include "Map.hpp"
+#include "Sprites.hpp"
+#include "ThreadPool.hpp"
+
+// Potentially visible sets. The map is split into square clusters of tiles, and
+// for each one a bitset says which clusters can be seen from anywhere inside it.
+// Anything in a cluster that isn't in the set can be skipped before a ray is cast.
+//
+// Sets are baked offline by casting rays from sample points all over each cluster,
+// and marking every cluster the rays cross up to the wall they hit. Far lines of
+// sight that thread between walls can slip between the rays, so the clusters a little
+// way past what they reached are then tried with random lines from the cluster.
+// Last, the set is grown by one cluster all round, to cover what slips between the
+// rays nearby and things that stand over a cluster's edge. It's all sampled, so
+// pvsbake checks the sets with random line of sight queries.
+//
+// PVS file, next to the map as <map>.pvs:
+//   PvsHeader, then a bit per cluster saying which bitsets are run-length coded,
+//   then one bitset per cluster, row by row. Each has a bit per cluster, in the
+//   same order, low bit first. A coded one has a zero byte followed by a byte with
+//   how many zero bytes it stands for; the others are stored as they are, since
+//   coding a dense one would make it bigger.
+
+const Uint32 PVS_VERSION = 2;
+
+// Clusters are (1 << clusterShift) tiles on a side. At least a sprite grid cell,
+// so each cell lies in one cluster.
+const int PVS_MIN_CLUSTER_SHIFT = SPRITE_CELL_SHIFT;
+const int PVS_MAX_CLUSTER_SHIFT = 8;
+
+// What pvsbake and --pvs bake use unless told otherwise
+const int PVS_DEFAULT_CLUSTER_SHIFT = PVS_MIN_CLUSTER_SHIFT;
+const int PVS_DEFAULT_ANGLES = 512;
+const int PVS_DEFAULT_SAMPLES = 2;
+
+// Baking gives up rather than hold more than this many bytes of bitsets
+const size_t PVS_MAX_BYTES = (size_t)256 << 20;
+
+struct PvsHeader
+{
+    char magic[4]; // "RPVS"
+    Uint32 version;
+    Uint32 mapWidth;
+    Uint32 mapHeight;
+    Uint32 clusterShift;
+    Uint32 angleCount; // How it was baked
+    Uint32 samplesPerTile;
+    Uint32 reserved;
+    Uint64 wallHash; // HashWalls() of the map it was baked for
+};
+
+class Pvs
+{
+public:
+    Pvs();
+
+    // Casts angleCount rays from samplesPerTile x samplesPerTile points in every
+    // open tile, spread over the pool's threads if there is one. Returns false if
+    // the settings are out of range or the sets would be too big.
+    bool Bake(const Map& map, int clusterShift, int angleCount, int samplesPerTile, ThreadPool* pool);
+
+    bool Save(const std::string& fileName) const;
+
+    // Fails if the file wasn't baked for a map with the same walls
+    bool Load(const std::string& fileName, const Map& map);
+
+    void Clear();
+    bool IsBaked() const;
+
+    int GetClusterShift() const;
+    int GetClustersX() const;
+    int GetClustersY() const;
+    int GetClusterCount() const;
+    int GetAngleCount() const;
+    int GetSamplesPerTile() const;
+
+    // The bitset of clusters visible from a point, or nullptr when there's no
+    // PVS or the point is outside the map
+    const byte* GetVisible(double x, double y) const;
+
+    // Clusters outside the map count as visible
+    bool IsClusterVisible(const byte* visible, int clusterX, int clusterY) const;
+    bool IsTileVisible(const byte* visible, int tileX, int tileY) const;
+    int CountVisible(const byte* visible) const;
+
+    // Writes the indices of the points in visible clusters to indices, for culling
+    // entities or anything else kept as positions. Returns how many there were.
+    int CullPoints(const byte* visible, const double* x, const double* y, int count, int* indices) const;
+
+    // Bytes of bitsets in memory, and in the file
+    size_t GetSize() const;
+    size_t GetFileSize() const;
+
+private:
+    bool SetLayout(int mapWidth, int mapHeight, int clusterShift);
+    void BakeCluster(const Map& map, const GridView& grid, int cluster, const std::vector<double>& dirX, const std::vector<double>& dirY,
+        int samplesPerTile, std::vector<byte>& scratch, std::vector<int>& openTiles);
+    void FillGaps(const GridView& grid, int cluster, const std::vector<int>& openTiles, byte* row, std::vector<byte>& scratch) const;
+    void Grow(const byte* from, byte* to, int reach) const;
+    void MarkSegment(byte* row, double startX, double startY, double endX, double endY) const;
+    void Mark(byte* row, int clusterX, int clusterY) const;
+    bool EncodeRow(const byte* row, std::vector<byte>& out) const;
+
+    int m_mapWidth;
+    int m_mapHeight;
+    int m_clusterShift;
+    int m_clustersX;
+    int m_clustersY;
+    size_t m_rowBytes;
+    int m_angleCount;
+    int m_samplesPerTile;
+    Uint64 m_wallHash;
+    std::vector<byte> m_bits; // One row of m_rowBytes per cluster
+};
+
+// A hash of which tiles are walls, to tell whether a PVS still fits a map
+Uint64 HashWalls(const Map& map);
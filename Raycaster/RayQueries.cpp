@@ -0,0 +1,93 @@
+#include "RayQueries.hpp"
+#include <algorithm>
+#include <stdlib.h>
+
+// How far past the target, in multiples of the segment, a sight query still looks
+// for walls
+static const double SIGHT_EDGE_TOLERANCE = 1e-9;
+
+RayQueries::RayQueries(ThreadPool* pool) :
+    m_pool(pool)
+{
+}
+
+void RayQueries::TestSight(const GridView& grid, const double* originX, const double* originY, const double* targetX, const double* targetY,
+    int count, byte* blocked) const
+{
+    // The distance field has the same layout as the tiles, with one byte per cell
+    GridView spaceGrid = grid;
+    spaceGrid.tiles = grid.space;
+    spaceGrid.tileSize = 1;
+
+    Run(count, [&](int begin, int end, int)
+    {
+        GridView view = grid;
+        GridHit hit;
+
+        for (int i = begin; i < end; i++)
+        {
+            int fromX = (int)floor(originX[i]);
+            int fromY = (int)floor(originY[i]);
+            int toX = (int)floor(targetX[i]);
+            int toY = (int)floor(targetY[i]);
+
+            // Every cell nearer than the distance field's value is open, and the
+            // segment can't leave the square of them around the origin. A target on
+            // a grid line also touches the cells one further out.
+            int reach = std::max(abs(toX - fromX), abs(toY - fromY));
+            if (reach == 0 || (grid.space && fromX >= 0 && fromX < grid.width && fromY >= 0 && fromY < grid.height
+                && reach + 1 < GetGridTile(spaceGrid, fromX, fromY)))
+            {
+                blocked[i] = 0;
+                continue;
+            }
+
+            // The target is one direction length away. A wall whose edge is at the
+            // target blocks it, so the walk goes a hair further in case rounding puts
+            // that edge just past the end.
+            view.originX = originX[i];
+            view.originY = originY[i];
+            TraceSegmentDDA(view, targetX[i] - originX[i], targetY[i] - originY[i], 1 + SIGHT_EDGE_TOLERANCE, hit);
+            blocked[i] = hit.hit;
+        }
+    });
+}
+
+void RayQueries::FindWalls(const GridView& grid, const double* originX, const double* originY, const double* dirX, const double* dirY,
+    double maxDist, int count, byte* hit, double* dist, int* tile) const
+{
+    Run(count, [&](int begin, int end, int)
+    {
+        GridView view = grid;
+        GridHit wall;
+
+        for (int i = begin; i < end; i++)
+        {
+            // With a unit direction, the distance along it is in tiles
+            double length = sqrt(dirX[i] * dirX[i] + dirY[i] * dirY[i]);
+            wall.hit = false;
+            if (length > 0)
+            {
+                view.originX = originX[i];
+                view.originY = originY[i];
+                TraceSegmentDDA(view, dirX[i] / length, dirY[i] / length, maxDist, wall);
+            }
+
+            hit[i] = wall.hit;
+            dist[i] = wall.hit ? wall.perpDist : maxDist;
+            tile[i] = wall.hit ? GetGridTile(grid, wall.tileX, wall.tileY) : 0;
+        }
+    });
+}
+
+void RayQueries::Run(int count, const ThreadPool::Job& job) const
+{
+    if (m_pool)
+    {
+        m_pool->ParallelFor(count, RAY_QUERY_CHUNK_SIZE, job);
+    }
+    else
+    {
+        job(0, count, 0);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PCH.hpp"
+#include "RayTrace.hpp"
+#include "ThreadPool.hpp"
+
+// Queries per ParallelFor() chunk
+const int RAY_QUERY_CHUNK_SIZE = 256;
+
+// Line of sight and wall distance queries against the tile grid, for game code that
+// asks thousands of them a tick. Each call takes count queries as parallel arrays and
+// spreads them over the pool's threads, if there is a pool. The grid's own origin is
+// ignored, each query has its own. With a distance field in the grid, the walks skip
+// across open space.
+class RayQueries
+{
+public:
+    RayQueries(ThreadPool* pool);
+
+    // Whether a wall is in the way from each origin to its target. Stops at the
+    // first wall without working out where it is, and with a distance field, doesn't
+    // walk at all when the target is inside the open space around the origin.
+    // A target inside a wall or on its edge is blocked, a wall the origin is inside isn't.
+    void TestSight(const GridView& grid, const double* originX, const double* originY, const double* targetX, const double* targetY,
+        int count, byte* blocked) const;
+
+    // The first wall along each direction, no further than maxDist tiles. The
+    // directions needn't be unit length. Where hit is non-zero, dist is how many
+    // tiles away the wall is and tile is its tile ID; elsewhere they're maxDist and 0.
+    void FindWalls(const GridView& grid, const double* originX, const double* originY, const double* dirX, const double* dirY,
+        double maxDist, int count, byte* hit, double* dist, int* tile) const;
+
+private:
+    void Run(int count, const ThreadPool::Job& job) const;
+
+    ThreadPool* m_pool;
+};
@@ -0,0 +1,551 @@
+#include "PCH.hpp"
+#include "RayTrace.hpp"
+#include <string.h>
+#include <algorithm>
+#include "Map.hpp"
+
+#ifdef RAYCASTER_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+static const double TWO_PI = 2 * M_PI;
+
+static RayTracer rayTracer = RAY_TRACER_SCALAR;
+
+static double NormalizeAngle(double rayAngle)
+{
+    if (rayAngle < 0)
+    {
+        rayAngle += TWO_PI;
+    }
+    else if (rayAngle >= TWO_PI)
+    {
+        rayAngle -= TWO_PI;
+    }
+
+    return rayAngle;
+}
+
+int GetGridTile(const GridView& grid, int x, int y)
+{
+    int mask = (1 << grid.chunkShift) - 1;
+    size_t chunk = (size_t)(y >> grid.chunkShift) * grid.chunksX + (x >> grid.chunkShift);
+    size_t index = (chunk << (2 * grid.chunkShift)) + ((size_t)(y & mask) << grid.chunkShift) + (x & mask);
+    const unsigned char* tile = grid.tiles + index * grid.tileSize;
+
+    switch (grid.tileSize)
+    {
+    case 1:
+        return tile[0];
+    case 2:
+        return tile[0] | (tile[1] << 8);
+    default:
+        return (int)(tile[0] | (tile[1] << 8) | (tile[2] << 16) | ((unsigned int)tile[3] << 24));
+    }
+}
+
+void TraceRay(const GridView& grid, double rayAngle, GridHit& hit)
+{
+    rayAngle = NormalizeAngle(rayAngle);
+
+    // Check the quadrant of the ray
+    bool right = (rayAngle > TWO_PI * 0.75 || rayAngle < TWO_PI * 0.25);
+    bool up = (rayAngle < 0 || rayAngle > M_PI);
+
+    double dist = 0.0; // Distance to tile we hit
+
+    hit.side = 0;
+    hit.tileX = 0;
+    hit.tileY = 0;
+    hit.x = 0.0;
+    hit.y = 0.0;
+
+    // First check against the vertical tile lines
+    // We do this by moving to thr right or left edge of the block we're standing in,
+    // and then moving in 1 map unit steps horizontally. The amount we have to move vertically
+    // is determined by the slope of the way.
+
+    double slope = sin(rayAngle) / cos(rayAngle);
+    double dx = right ? 1 : -1; // We move either 1 map unit to the left or right
+    double dy = dx * slope; // How much to move up or done
+
+    double x = right ? ceil(grid.originX) : floor(grid.originX); // Starting horizontal position, at one of the edges of the current map tile
+    double y = grid.originY + (x - grid.originX) * slope; // starting vertical position. We add the small horizontal step we just made, multiplied by the slope.
+
+    while (x >= 0 && x < grid.width && y >= 0 && y < grid.height)
+    {
+        int tileMapX = floor(x + (right ? 0 : -1));
+        int tileMapY = floor(y);
+
+        // Is this point inside a wall block?
+        if (GetGridTile(grid, tileMapX, tileMapY) > 0)
+        {
+            double distX = x - grid.originX;
+            double distY = y - grid.originY;
+            dist = (distX * distX) + (distY * distY); // the distance from the player to this point, squared.
+
+            hit.side = 0;
+
+            hit.tileX = tileMapX;
+            hit.tileY = tileMapY;
+
+            hit.x = x;
+            hit.y = y;
+
+            break;
+        }
+
+        x += dx;
+        y += dy;
+    }
+
+    // Now check against horizontal lines. it's basically the same thing, but turned around.
+    // The only difference here is that once we hit a map block, we check if there was also one
+    // found there in the vertical run. If so, we only register this hit if this distance is smaller.
+
+    slope = cos(rayAngle) / sin(rayAngle);
+    dy = up ? -1 : 1;
+    dx = dy * slope;
+    y = up ? floor(grid.originY) : ceil(grid.originY);
+    x = grid.originX + (y - grid.originY) * slope;
+
+    while (x >= 0 && x < grid.width && y >= 0 && y < grid.height)
+    {
+        int tileMapX = floor(x);
+        int tileMapY = floor(y + (up ? -1 : 0));
+
+        // Is this point inside a wall block?
+        if (GetGridTile(grid, tileMapX, tileMapY) > 0)
+        {
+            double distX = x - grid.originX;
+            double distY = y - grid.originY;
+            double tileDist = (distX * distX) + (distY * distY);
+            if (!dist || tileDist < dist)
+            {
+                dist = tileDist;
+
+                hit.side = 1;
+
+                hit.tileX = tileMapX;
+                hit.tileY = tileMapY;
+
+                hit.x = x;
+                hit.y = y;
+            }
+
+            break;
+        }
+
+        x += dx;
+        y += dy;
+    }
+
+    hit.hit = (dist != 0);
+    hit.distSq = dist;
+}
+
+// Distance along the ray between two crossings of the same set of grid lines.
+// A ray parallel to the lines never crosses them.
+static double DeltaDist(double rayDir)
+{
+    return (rayDir == 0) ? 1e30 : fabs(1 / rayDir);
+}
+
+// How many of the crossings first, first + 1, ... last - 1 are before limit (at or
+// before, if inclusive), plus first. Crossing n is at side + n * delta, exactly as
+// the walk computes it, so the division only gives a first guess.
+static int CountCrossings(double side, double delta, int first, int last, double limit, bool inclusive)
+{
+    double guess = floor((limit - side) / delta) + 1;
+    int n = (int)std::min(std::max(guess, (double)first), (double)last);
+
+    while (n > first && (inclusive ? side + (n - 1) * delta > limit : side + (n - 1) * delta >= limit))
+    {
+        n--;
+    }
+
+    while (n < last && (inclusive ? side + n * delta <= limit : side + n * delta < limit))
+    {
+        n++;
+    }
+
+    return n;
+}
+
+// Every cell up to reach cells away on either axis is open. Takes every crossing
+// the walk would take inside that square, leaving the one that leaves it for the walk.
+// The walk steps on whichever crossing is nearer, and takes the horizontal one on a tie.
+static void SkipOpenSquare(int reach, double sideDistX, double deltaDistX, double sideDistY, double deltaDistY, int& stepsX, int& stepsY)
+{
+    int lastX = stepsX + reach;
+    int lastY = stepsY + reach;
+    double exitX = sideDistX + lastX * deltaDistX;
+    double exitY = sideDistY + lastY * deltaDistY;
+
+    if (exitX < exitY)
+    {
+        stepsY = CountCrossings(sideDistY, deltaDistY, stepsY, lastY, exitX, true);
+        stepsX = lastX;
+    }
+    else
+    {
+        stepsX = CountCrossings(sideDistX, deltaDistX, stepsX, lastX, exitY, false);
+        stepsY = lastY;
+    }
+}
+
+// The distance field has the same layout as the tiles, with one byte per cell
+static GridView SpaceGrid(const GridView& grid)
+{
+    GridView space = grid;
+    space.tiles = grid.space;
+    space.tileSize = 1;
+
+    return space;
+}
+
+void TraceRayDDA(const GridView& grid, double rayDirX, double rayDirY, GridHit& hit)
+{
+    TraceSegmentDDA(grid, rayDirX, rayDirY, 1e300, hit);
+}
+
+void TraceSegmentDDA(const GridView& grid, double rayDirX, double rayDirY, double maxDist, GridHit& hit)
+{
+    // The cell the ray starts in
+    int mapX = (int)floor(grid.originX);
+    int mapY = (int)floor(grid.originY);
+
+    double deltaDistX = DeltaDist(rayDirX);
+    double deltaDistY = DeltaDist(rayDirY);
+
+    // Which way to step, and how far along the ray the first grid line crossings are
+    int stepX = (rayDirX < 0) ? -1 : 1;
+    int stepY = (rayDirY < 0) ? -1 : 1;
+    double sideDistX = (rayDirX < 0) ? (grid.originX - mapX) * deltaDistX : (mapX + 1.0 - grid.originX) * deltaDistX;
+    double sideDistY = (rayDirY < 0) ? (grid.originY - mapY) * deltaDistY : (mapY + 1.0 - grid.originY) * deltaDistY;
+
+    // Crossings are counted rather than summed up, so long rays don't build up rounding error
+    int stepsX = 0;
+    int stepsY = 0;
+
+    // Open space around the current cell, when there's a distance field to skip with
+    GridView spaceGrid = SpaceGrid(grid);
+    int space = 0;
+    if (grid.space && mapX >= 0 && mapX < grid.width && mapY >= 0 && mapY < grid.height)
+    {
+        space = GetGridTile(spaceGrid, mapX, mapY);
+    }
+
+    hit.hit = false;
+    hit.perpDist = 0;
+    hit.side = 0;
+
+    while (true)
+    {
+        if (space >= SKIP_MIN_SPACE)
+        {
+            int skippedX = stepsX;
+            int skippedY = stepsY;
+            SkipOpenSquare(space - 1, sideDistX, deltaDistX, sideDistY, deltaDistY, stepsX, stepsY);
+
+            mapX += (stepsX - skippedX) * stepX;
+            mapY += (stepsY - skippedY) * stepY;
+        }
+
+        double nextX = sideDistX + stepsX * deltaDistX;
+        double nextY = sideDistY + stepsY * deltaDistY;
+
+        if (nextX < nextY)
+        {
+            mapX += stepX;
+            stepsX++;
+            hit.perpDist = nextX;
+            hit.side = 0;
+        }
+        else
+        {
+            mapY += stepY;
+            stepsY++;
+            hit.perpDist = nextY;
+            hit.side = 1;
+        }
+
+        if (hit.perpDist > maxDist || mapX < 0 || mapX >= grid.width || mapY < 0 || mapY >= grid.height)
+        {
+            break;
+        }
+
+        // A distance of 0 is a wall
+        bool wall;
+        if (grid.space)
+        {
+            space = GetGridTile(spaceGrid, mapX, mapY);
+            wall = (space == 0);
+        }
+        else
+        {
+            wall = (GetGridTile(grid, mapX, mapY) > 0);
+        }
+
+        if (wall)
+        {
+            hit.hit = true;
+            break;
+        }
+    }
+
+    hit.tileX = mapX;
+    hit.tileY = mapY;
+    hit.x = grid.originX + rayDirX * hit.perpDist;
+    hit.y = grid.originY + rayDirY * hit.perpDist;
+}
+
+// Per lane setup, done in scalar code so sin/cos match TraceRay() bit for bit
+static void SetupPacketLane(const GridView& grid, double rayAngle, RayPacket& packet, int lane)
+{
+    rayAngle = NormalizeAngle(rayAngle);
+
+    bool right = (rayAngle > TWO_PI * 0.75 || rayAngle < TWO_PI * 0.25);
+    bool up = (rayAngle < 0 || rayAngle > M_PI);
+
+    double slope = sin(rayAngle) / cos(rayAngle);
+    packet.vdx[lane] = right ? 1 : -1;
+    packet.vdy[lane] = packet.vdx[lane] * slope;
+    packet.vx[lane] = right ? ceil(grid.originX) : floor(grid.originX);
+    packet.vy[lane] = grid.originY + (packet.vx[lane] - grid.originX) * slope;
+    packet.vTileOffset[lane] = right ? 0 : -1;
+
+    slope = cos(rayAngle) / sin(rayAngle);
+    packet.hdy[lane] = up ? -1 : 1;
+    packet.hdx[lane] = packet.hdy[lane] * slope;
+    packet.hy[lane] = up ? floor(grid.originY) : ceil(grid.originY);
+    packet.hx[lane] = grid.originX + (packet.hy[lane] - grid.originY) * slope;
+    packet.hTileOffset[lane] = up ? -1 : 0;
+}
+
+bool FitsPacketTracers(const GridView& grid)
+{
+    Uint64 chunksY = ((Uint64)grid.height + (1 << grid.chunkShift) - 1) >> grid.chunkShift;
+    Uint64 tileBytes = ((Uint64)grid.chunksX * chunksY << (2 * grid.chunkShift)) * grid.tileSize;
+
+    return tileBytes <= (Uint64)0x7FFFFFFF - MAP_PADDING;
+}
+
+void TraceRayPacket(const GridView& grid, const double* rayAngles, GridHit* hits)
+{
+    if (!FitsPacketTracers(grid))
+    {
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            TraceRay(grid, rayAngles[lane], hits[lane]);
+        }
+
+        return;
+    }
+
+    RayPacket packet;
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+    {
+        SetupPacketLane(grid, rayAngles[lane], packet, lane);
+    }
+
+    switch (rayTracer)
+    {
+    case RAY_TRACER_AVX2:
+        TracePacketAVX2(grid, packet, hits);
+        break;
+    case RAY_TRACER_SSE2:
+        TracePacketSSE2(grid, packet, hits);
+        break;
+    default:
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            TraceRay(grid, rayAngles[lane], hits[lane]);
+        }
+        break;
+    }
+}
+
+void TraceRayPacketDDA(const GridView& grid, const double* rayDirX, const double* rayDirY, GridHit* hits)
+{
+    if (rayTracer == RAY_TRACER_SCALAR || !FitsPacketTracers(grid))
+    {
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            TraceRayDDA(grid, rayDirX[lane], rayDirY[lane], hits[lane]);
+        }
+
+        return;
+    }
+
+    RayPacketDDA packet;
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+    {
+        int mapX = (int)floor(grid.originX);
+        int mapY = (int)floor(grid.originY);
+
+        packet.mapX[lane] = mapX;
+        packet.mapY[lane] = mapY;
+        packet.deltaDistX[lane] = DeltaDist(rayDirX[lane]);
+        packet.deltaDistY[lane] = DeltaDist(rayDirY[lane]);
+        packet.stepX[lane] = (rayDirX[lane] < 0) ? -1 : 1;
+        packet.stepY[lane] = (rayDirY[lane] < 0) ? -1 : 1;
+        packet.sideDistX[lane] = (rayDirX[lane] < 0) ? (grid.originX - mapX) * packet.deltaDistX[lane] : (mapX + 1.0 - grid.originX) * packet.deltaDistX[lane];
+        packet.sideDistY[lane] = (rayDirY[lane] < 0) ? (grid.originY - mapY) * packet.deltaDistY[lane] : (mapY + 1.0 - grid.originY) * packet.deltaDistY[lane];
+    }
+
+    if (rayTracer == RAY_TRACER_AVX2)
+    {
+        TracePacketDDAAVX2(grid, packet, hits);
+    }
+    else
+    {
+        TracePacketDDASSE2(grid, packet, hits);
+    }
+
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+    {
+        hits[lane].x = grid.originX + rayDirX[lane] * hits[lane].perpDist;
+        hits[lane].y = grid.originY + rayDirY[lane] * hits[lane].perpDist;
+    }
+}
+
+RayTracer SelectRayTracer(RayTracer requested)
+{
+    rayTracer = RAY_TRACER_SCALAR;
+
+#ifdef RAYCASTER_HAVE_SSE2
+    if (requested >= RAY_TRACER_SSE2 && SDL_HasSSE2())
+    {
+        rayTracer = RAY_TRACER_SSE2;
+    }
+#endif
+
+#ifdef RAYCASTER_HAVE_AVX2
+    if (requested >= RAY_TRACER_AVX2 && SDL_HasAVX2())
+    {
+        rayTracer = RAY_TRACER_AVX2;
+    }
+#endif
+
+    return rayTracer;
+}
+
+RayTracer GetRayTracer()
+{
+    return rayTracer;
+}
+
+const char* GetRayTracerName(RayTracer tracer)
+{
+    switch (tracer)
+    {
+    case RAY_TRACER_AVX2:
+        return "avx2";
+    case RAY_TRACER_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+#ifdef RAYCASTER_HAVE_SSE2
+
+// SSE2 only holds two doubles per register, so a packet is a pair of them
+struct Sse2Ops
+{
+    struct Vec
+    {
+        __m128d lo;
+        __m128d hi;
+    };
+
+    static Vec Make(__m128d lo, __m128d hi)
+    {
+        Vec v = { lo, hi };
+        return v;
+    }
+
+    static Vec Load(const double* p) { return Make(_mm_loadu_pd(p), _mm_loadu_pd(p + 2)); }
+    static void Store(double* p, Vec v) { _mm_storeu_pd(p, v.lo); _mm_storeu_pd(p + 2, v.hi); }
+    static Vec Set1(double v) { return Make(_mm_set1_pd(v), _mm_set1_pd(v)); }
+
+    static Vec Add(Vec a, Vec b) { return Make(_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)); }
+    static Vec Sub(Vec a, Vec b) { return Make(_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)); }
+    static Vec Mul(Vec a, Vec b) { return Make(_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)); }
+    static Vec Div(Vec a, Vec b) { return Make(_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)); }
+    static Vec Min(Vec a, Vec b) { return Make(_mm_min_pd(a.lo, b.lo), _mm_min_pd(a.hi, b.hi)); }
+    static Vec Max(Vec a, Vec b) { return Make(_mm_max_pd(a.lo, b.lo), _mm_max_pd(a.hi, b.hi)); }
+
+    static __m128d Floor(__m128d a)
+    {
+        // Truncate, then step down where that rounded towards zero from below.
+        // Only used on lanes inside the map, where the values fit in an int.
+        __m128d truncated = _mm_cvtepi32_pd(_mm_cvttpd_epi32(a));
+        return _mm_sub_pd(truncated, _mm_and_pd(_mm_cmpgt_pd(truncated, a), _mm_set1_pd(1)));
+    }
+
+    static Vec Floor(Vec a) { return Make(Floor(a.lo), Floor(a.hi)); }
+
+    static Vec CmpLt(Vec a, Vec b) { return Make(_mm_cmplt_pd(a.lo, b.lo), _mm_cmplt_pd(a.hi, b.hi)); }
+    static Vec CmpGe(Vec a, Vec b) { return Make(_mm_cmpge_pd(a.lo, b.lo), _mm_cmpge_pd(a.hi, b.hi)); }
+    static Vec CmpGt(Vec a, Vec b) { return Make(_mm_cmpgt_pd(a.lo, b.lo), _mm_cmpgt_pd(a.hi, b.hi)); }
+    static Vec CmpEq(Vec a, Vec b) { return Make(_mm_cmpeq_pd(a.lo, b.lo), _mm_cmpeq_pd(a.hi, b.hi)); }
+
+    static Vec And(Vec a, Vec b) { return Make(_mm_and_pd(a.lo, b.lo), _mm_and_pd(a.hi, b.hi)); }
+    static Vec Or(Vec a, Vec b) { return Make(_mm_or_pd(a.lo, b.lo), _mm_or_pd(a.hi, b.hi)); }
+    static Vec AndNot(Vec a, Vec b) { return Make(_mm_andnot_pd(a.lo, b.lo), _mm_andnot_pd(a.hi, b.hi)); }
+
+    static Vec Select(Vec mask, Vec a, Vec b)
+    {
+        return Make(_mm_or_pd(_mm_and_pd(mask.lo, a.lo), _mm_andnot_pd(mask.lo, b.lo)),
+            _mm_or_pd(_mm_and_pd(mask.hi, a.hi), _mm_andnot_pd(mask.hi, b.hi)));
+    }
+
+    static int MoveMask(Vec m) { return _mm_movemask_pd(m.lo) | (_mm_movemask_pd(m.hi) << 2); }
+
+    static Vec LoadTiles(const unsigned char* tiles, Vec offset, int tileMask, Vec mask)
+    {
+        double laneOffset[RAY_PACKET_SIZE];
+        double laneTile[RAY_PACKET_SIZE];
+        Store(laneOffset, offset);
+
+        int lanes = MoveMask(mask);
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            int tile = 0;
+            if (lanes & (1 << lane))
+            {
+                memcpy(&tile, tiles + (int)laneOffset[lane], sizeof(tile));
+            }
+
+            laneTile[lane] = tile & tileMask;
+        }
+
+        return Load(laneTile);
+    }
+};
+
+#include "RayTraceKernel.inl"
+
+void TracePacketSSE2(const GridView& grid, const RayPacket& packet, GridHit* hits)
+{
+    TracePacket<Sse2Ops>(grid, packet, hits);
+}
+
+void TracePacketDDASSE2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits)
+{
+    TracePacketDDA<Sse2Ops>(grid, packet, hits);
+}
+
+#else
+
+void TracePacketSSE2(const GridView& grid, const RayPacket& packet, GridHit* hits)
+{
+}
+
+void TracePacketDDASSE2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits)
+{
+}
+
+#endif
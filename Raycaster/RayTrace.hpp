@@ -0,0 +1,123 @@
+#pragma once
+
+// Walks rays through the tile grid. There are two ways of walking:
+//  - DDA: one pass from cell to cell along a ray direction vector
+//  - Angle: the original caster, a pass over the vertical grid lines and another
+//    over the horizontal ones, for a ray given by its angle
+// Both have a scalar tracer, and packet tracers that step RAY_PACKET_SIZE adjacent
+// columns together with SSE2 or AVX2. Every packet tracer finds exactly the same
+// hits as its scalar one.
+//
+// This header is also compiled with AVX2 code generation enabled, so it must
+// not pull in anything with inline functions (PCH.hpp, SDL, the standard library).
+
+#include "Simd.hpp"
+
+const int RAY_PACKET_SIZE = 4;
+
+enum RayTracer
+{
+    RAY_TRACER_SCALAR,
+    RAY_TRACER_SSE2,
+    RAY_TRACER_AVX2
+};
+
+// The tile map and the point the rays start from. The tiles are laid out in
+// chunks, see Map.hpp, and there must be at least 4 readable bytes past the last one.
+struct GridView
+{
+    const unsigned char* tiles;
+    int width;
+    int height;
+    int tileSize; // Bytes per tile: 1, 2 or 4
+    int chunkShift; // Chunks are (1 << chunkShift) tiles on a side
+    int chunksX; // Chunks per row of chunks
+    double originX;
+    double originY;
+
+    // Optional, for the DDA tracers: each cell's Chebyshev distance to the nearest
+    // wall, one byte per cell in the same chunks as the tiles, see DistanceField.hpp.
+    // With it, the tracers jump across open space and find walls where the distance is 0.
+    const unsigned char* space;
+};
+
+// Open space is only skipped where the jump is worth the extra math
+const int SKIP_MIN_SPACE = 3;
+
+struct GridHit
+{
+    bool hit;
+    double distSq; // Squared distance to the hit, only filled in by the angle tracers
+    double perpDist; // Distance to the hit along the view direction, only filled in by the DDA tracers
+    int side; // 0 for a vertical grid line, 1 for a horizontal one
+    int tileX;
+    int tileY;
+    double x;
+    double y;
+};
+
+// Where each lane starts on the vertical and horizontal grid line passes,
+// and how far it moves per step.
+struct RayPacket
+{
+    double vx[RAY_PACKET_SIZE];
+    double vy[RAY_PACKET_SIZE];
+    double vdx[RAY_PACKET_SIZE];
+    double vdy[RAY_PACKET_SIZE];
+    double vTileOffset[RAY_PACKET_SIZE];
+
+    double hx[RAY_PACKET_SIZE];
+    double hy[RAY_PACKET_SIZE];
+    double hdx[RAY_PACKET_SIZE];
+    double hdy[RAY_PACKET_SIZE];
+    double hTileOffset[RAY_PACKET_SIZE];
+};
+
+// DDA state for each lane. Crossing number n of the vertical grid lines is at
+// sideDistX + n * deltaDistX along the ray, same for the horizontal lines.
+struct RayPacketDDA
+{
+    double mapX[RAY_PACKET_SIZE];
+    double mapY[RAY_PACKET_SIZE];
+    double stepX[RAY_PACKET_SIZE];
+    double stepY[RAY_PACKET_SIZE];
+    double sideDistX[RAY_PACKET_SIZE];
+    double sideDistY[RAY_PACKET_SIZE];
+    double deltaDistX[RAY_PACKET_SIZE];
+    double deltaDistY[RAY_PACKET_SIZE];
+};
+
+// The tile at (x, y), which must be inside the grid
+int GetGridTile(const GridView& grid, int x, int y);
+
+// The packet tracers address tiles with 32 bit offsets. Grids too big for that are
+// traced a ray at a time with the scalar tracers, whichever tracer is selected.
+bool FitsPacketTracers(const GridView& grid);
+
+// Picks the best tracer this CPU supports, no better than the one requested.
+RayTracer SelectRayTracer(RayTracer requested);
+RayTracer GetRayTracer();
+const char* GetRayTracerName(RayTracer tracer);
+
+// rayAngle must be in [0, 2 pi)
+void TraceRay(const GridView& grid, double rayAngle, GridHit& hit);
+
+// Traces RAY_PACKET_SIZE rays with the selected tracer
+void TraceRayPacket(const GridView& grid, const double* rayAngles, GridHit* hits);
+
+// The ray direction doesn't need to be normalized. perpDist is measured in
+// multiples of its length, so with a camera plane ray it's the distance along
+// the view direction.
+void TraceRayDDA(const GridView& grid, double rayDirX, double rayDirY, GridHit& hit);
+
+// TraceRayDDA(), but giving up on walls more than maxDist multiples of the direction
+// away. A wall whose edge is exactly maxDist away is still hit.
+void TraceSegmentDDA(const GridView& grid, double rayDirX, double rayDirY, double maxDist, GridHit& hit);
+
+// Traces RAY_PACKET_SIZE DDA rays with the selected tracer
+void TraceRayPacketDDA(const GridView& grid, const double* rayDirX, const double* rayDirY, GridHit* hits);
+
+void TracePacketSSE2(const GridView& grid, const RayPacket& packet, GridHit* hits);
+void TracePacketAVX2(const GridView& grid, const RayPacket& packet, GridHit* hits);
+void TracePacketDDASSE2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits);
+void TracePacketDDAAVX2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits);
@@ -0,0 +1,73 @@
+// Built with AVX2 code generation, so only the AVX2 tracer lives in here.
+// Nothing in this file may be called unless SDL_HasAVX2() said yes.
+#include "RayTrace.hpp"
+
+#ifdef RAYCASTER_HAVE_AVX2
+
+#include <immintrin.h>
+
+struct Avx2Ops
+{
+    typedef __m256d Vec;
+
+    static Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec Set1(double v) { return _mm256_set1_pd(v); }
+
+    static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec Div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static Vec Min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+    static Vec Max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    static Vec Floor(Vec a) { return _mm256_floor_pd(a); }
+
+    static Vec CmpLt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Vec CmpGe(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static Vec CmpGt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Vec CmpEq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+
+    static Vec And(Vec a, Vec b) { return _mm256_and_pd(a, b); }
+    static Vec Or(Vec a, Vec b) { return _mm256_or_pd(a, b); }
+    static Vec AndNot(Vec a, Vec b) { return _mm256_andnot_pd(a, b); }
+    static Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_pd(b, a, mask); }
+
+    static int MoveMask(Vec m) { return _mm256_movemask_pd(m); }
+
+    static Vec LoadTiles(const unsigned char* tiles, Vec offset, int tileMask, Vec mask)
+    {
+        // Narrow the 64 bit lane masks down to 32 bits to match the offsets
+        __m256i wideMask = _mm256_castpd_si256(mask);
+        __m128i laneMask = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(wideMask, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+
+        __m128i laneOffset = _mm256_cvttpd_epi32(offset);
+        __m128i tile = _mm_mask_i32gather_epi32(_mm_setzero_si128(), (const int*)tiles, laneOffset, laneMask, 1);
+        tile = _mm_and_si128(tile, _mm_set1_epi32(tileMask));
+
+        return _mm256_cvtepi32_pd(tile);
+    }
+};
+
+#include "RayTraceKernel.inl"
+
+void TracePacketAVX2(const GridView& grid, const RayPacket& packet, GridHit* hits)
+{
+    TracePacket<Avx2Ops>(grid, packet, hits);
+}
+
+void TracePacketDDAAVX2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits)
+{
+    TracePacketDDA<Avx2Ops>(grid, packet, hits);
+}
+
+#else
+
+void TracePacketAVX2(const GridView& grid, const RayPacket& packet, GridHit* hits)
+{
+}
+
+void TracePacketDDAAVX2(const GridView& grid, const RayPacketDDA& packet, GridHit* hits)
+{
+}
+
+#endif
@@ -0,0 +1,363 @@
+// The packet traversal, written once against a small set of vector operations.
+// Included by RayTrace.cpp (SSE2) and RayTraceAVX2.cpp (AVX2), which each
+// supply their own Ops type. Every lane does exactly the same floating point
+// operations, in the same order, as TraceRay() or TraceRayDDA() does for a single ray.
+//
+// Ops must provide:
+//   Vec                           four doubles, one per lane
+//   Load, Store, Set1             memory and broadcast
+//   Add, Sub, Mul, Div, Floor     arithmetic
+//   Min, Max
+//   CmpLt, CmpGe, CmpGt, CmpEq    comparisons, returning an all-ones/all-zeros mask per lane
+//   And, Or, AndNot(a, b)         mask logic, AndNot is (~a & b)
+//   Select(mask, a, b)            mask ? a : b
+//   MoveMask                      one bit per lane
+//   LoadTiles(tiles, offset, tileMask, mask)
+//                                 the 4 bytes at each byte offset masked with tileMask,
+//                                 for the lanes in mask
+
+namespace
+{
+    // Finds tiles in the chunked layout with the same arithmetic as GetGridTile().
+    // Everything stays in doubles; the values are whole numbers well inside the
+    // range where that's exact.
+    template <class Ops>
+    struct GridTiles
+    {
+        typedef typename Ops::Vec Vec;
+
+        const unsigned char* tiles;
+        int tileMask;
+        Vec chunkSize;
+        Vec chunkScale;
+        Vec chunksX;
+        Vec chunkArea;
+        Vec tileSize;
+
+        // tileData and tileBytes stand in for the grid's own, e.g. for the distance field
+        GridTiles(const GridView& grid, const unsigned char* tileData, int tileBytes)
+        {
+            tiles = tileData;
+            tileMask = (tileBytes == 4) ? -1 : (1 << (tileBytes * 8)) - 1;
+            chunkSize = Ops::Set1(1 << grid.chunkShift);
+            chunkScale = Ops::Set1(1.0 / (1 << grid.chunkShift));
+            chunksX = Ops::Set1(grid.chunksX);
+            chunkArea = Ops::Set1(1 << (2 * grid.chunkShift));
+            tileSize = Ops::Set1(tileBytes);
+        }
+
+        // The tiles at (x, y), for the lanes in mask
+        Vec Load(Vec x, Vec y, Vec mask) const
+        {
+            Vec chunkX = Ops::Floor(Ops::Mul(x, chunkScale));
+            Vec chunkY = Ops::Floor(Ops::Mul(y, chunkScale));
+            Vec localX = Ops::Sub(x, Ops::Mul(chunkX, chunkSize));
+            Vec localY = Ops::Sub(y, Ops::Mul(chunkY, chunkSize));
+
+            Vec chunk = Ops::Add(Ops::Mul(chunkY, chunksX), chunkX);
+            Vec index = Ops::Add(Ops::Mul(chunk, chunkArea), Ops::Add(Ops::Mul(localY, chunkSize), localX));
+
+            return Ops::LoadTiles(tiles, Ops::Mul(index, tileSize), tileMask, mask);
+        }
+    };
+
+    template <class Ops>
+    void TracePacket(const GridView& grid, const RayPacket& packet, GridHit* hits)
+    {
+        typedef typename Ops::Vec Vec;
+
+        const Vec zero = Ops::Set1(0);
+        const Vec one = Ops::Set1(1);
+        const Vec width = Ops::Set1(grid.width);
+        const Vec height = Ops::Set1(grid.height);
+        const Vec originX = Ops::Set1(grid.originX);
+        const Vec originY = Ops::Set1(grid.originY);
+        const GridTiles<Ops> tiles(grid, grid.tiles, grid.tileSize);
+
+        Vec dist = zero;
+        Vec side = zero;
+        Vec tileX = zero;
+        Vec tileY = zero;
+        Vec hitX = zero;
+        Vec hitY = zero;
+
+        // Vertical grid lines
+        Vec x = Ops::Load(packet.vx);
+        Vec y = Ops::Load(packet.vy);
+        Vec dx = Ops::Load(packet.vdx);
+        Vec dy = Ops::Load(packet.vdy);
+        Vec offset = Ops::Load(packet.vTileOffset);
+        Vec active = Ops::CmpEq(zero, zero);
+
+        while (true)
+        {
+            Vec inside = Ops::And(Ops::And(Ops::CmpGe(x, zero), Ops::CmpLt(x, width)),
+                Ops::And(Ops::CmpGe(y, zero), Ops::CmpLt(y, height)));
+            active = Ops::And(active, inside);
+            if (Ops::MoveMask(active) == 0)
+            {
+                break;
+            }
+
+            Vec tileMapX = Ops::Floor(Ops::Add(x, offset));
+            Vec tileMapY = Ops::Floor(y);
+            Vec tile = tiles.Load(tileMapX, tileMapY, active);
+
+            Vec wall = Ops::And(active, Ops::CmpGt(tile, zero));
+            if (Ops::MoveMask(wall) != 0)
+            {
+                Vec distX = Ops::Sub(x, originX);
+                Vec distY = Ops::Sub(y, originY);
+                Vec tileDist = Ops::Add(Ops::Mul(distX, distX), Ops::Mul(distY, distY));
+
+                dist = Ops::Select(wall, tileDist, dist);
+                tileX = Ops::Select(wall, tileMapX, tileX);
+                tileY = Ops::Select(wall, tileMapY, tileY);
+                hitX = Ops::Select(wall, x, hitX);
+                hitY = Ops::Select(wall, y, hitY);
+
+                active = Ops::AndNot(wall, active);
+            }
+
+            x = Ops::Add(x, dx);
+            y = Ops::Add(y, dy);
+        }
+
+        // Horizontal grid lines, only kept where they're closer than the vertical hit
+        x = Ops::Load(packet.hx);
+        y = Ops::Load(packet.hy);
+        dx = Ops::Load(packet.hdx);
+        dy = Ops::Load(packet.hdy);
+        offset = Ops::Load(packet.hTileOffset);
+        active = Ops::CmpEq(zero, zero);
+
+        while (true)
+        {
+            Vec inside = Ops::And(Ops::And(Ops::CmpGe(x, zero), Ops::CmpLt(x, width)),
+                Ops::And(Ops::CmpGe(y, zero), Ops::CmpLt(y, height)));
+            active = Ops::And(active, inside);
+            if (Ops::MoveMask(active) == 0)
+            {
+                break;
+            }
+
+            Vec tileMapX = Ops::Floor(x);
+            Vec tileMapY = Ops::Floor(Ops::Add(y, offset));
+            Vec tile = tiles.Load(tileMapX, tileMapY, active);
+
+            Vec wall = Ops::And(active, Ops::CmpGt(tile, zero));
+            if (Ops::MoveMask(wall) != 0)
+            {
+                Vec distX = Ops::Sub(x, originX);
+                Vec distY = Ops::Sub(y, originY);
+                Vec tileDist = Ops::Add(Ops::Mul(distX, distX), Ops::Mul(distY, distY));
+                Vec closer = Ops::And(wall, Ops::Or(Ops::CmpEq(dist, zero), Ops::CmpLt(tileDist, dist)));
+
+                dist = Ops::Select(closer, tileDist, dist);
+                side = Ops::Select(closer, one, side);
+                tileX = Ops::Select(closer, tileMapX, tileX);
+                tileY = Ops::Select(closer, tileMapY, tileY);
+                hitX = Ops::Select(closer, x, hitX);
+                hitY = Ops::Select(closer, y, hitY);
+
+                active = Ops::AndNot(wall, active);
+            }
+
+            x = Ops::Add(x, dx);
+            y = Ops::Add(y, dy);
+        }
+
+        double laneDist[RAY_PACKET_SIZE];
+        double laneSide[RAY_PACKET_SIZE];
+        double laneTileX[RAY_PACKET_SIZE];
+        double laneTileY[RAY_PACKET_SIZE];
+        double laneX[RAY_PACKET_SIZE];
+        double laneY[RAY_PACKET_SIZE];
+        Ops::Store(laneDist, dist);
+        Ops::Store(laneSide, side);
+        Ops::Store(laneTileX, tileX);
+        Ops::Store(laneTileY, tileY);
+        Ops::Store(laneX, hitX);
+        Ops::Store(laneY, hitY);
+
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            hits[lane].hit = (laneDist[lane] != 0);
+            hits[lane].distSq = laneDist[lane];
+            hits[lane].side = (int)laneSide[lane];
+            hits[lane].tileX = (int)laneTileX[lane];
+            hits[lane].tileY = (int)laneTileY[lane];
+            hits[lane].x = laneX[lane];
+            hits[lane].y = laneY[lane];
+        }
+    }
+
+    // CountCrossings() from RayTrace.cpp, for the lanes in mask
+    template <class Ops>
+    typename Ops::Vec CountCrossings(typename Ops::Vec mask, typename Ops::Vec side, typename Ops::Vec delta,
+        typename Ops::Vec first, typename Ops::Vec last, typename Ops::Vec limit, bool inclusive)
+    {
+        typedef typename Ops::Vec Vec;
+
+        const Vec one = Ops::Set1(1);
+
+        // Clamped before the floor, the guess can be far out of int range
+        Vec guess = Ops::Div(Ops::Sub(limit, side), delta);
+        guess = Ops::Min(Ops::Max(guess, Ops::Sub(first, one)), last);
+        Vec n = Ops::Min(Ops::Max(Ops::Add(Ops::Floor(guess), one), first), last);
+
+        while (true)
+        {
+            Vec crossing = Ops::Add(side, Ops::Mul(Ops::Sub(n, one), delta));
+            Vec after = inclusive ? Ops::CmpGt(crossing, limit) : Ops::CmpGe(crossing, limit);
+            Vec down = Ops::And(mask, Ops::And(Ops::CmpGt(n, first), after));
+            if (Ops::MoveMask(down) == 0)
+            {
+                break;
+            }
+
+            n = Ops::Sub(n, Ops::And(down, one));
+        }
+
+        while (true)
+        {
+            Vec crossing = Ops::Add(side, Ops::Mul(n, delta));
+            Vec before = inclusive ? Ops::CmpGe(limit, crossing) : Ops::CmpLt(crossing, limit);
+            Vec up = Ops::And(mask, Ops::And(Ops::CmpLt(n, last), before));
+            if (Ops::MoveMask(up) == 0)
+            {
+                break;
+            }
+
+            n = Ops::Add(n, Ops::And(up, one));
+        }
+
+        return n;
+    }
+
+    // The hit point is left for the caller, it's the same scalar math for every tracer
+    template <class Ops>
+    void TracePacketDDA(const GridView& grid, const RayPacketDDA& packet, GridHit* hits)
+    {
+        typedef typename Ops::Vec Vec;
+
+        const Vec zero = Ops::Set1(0);
+        const Vec one = Ops::Set1(1);
+        const Vec width = Ops::Set1(grid.width);
+        const Vec height = Ops::Set1(grid.height);
+        const GridTiles<Ops> tiles(grid, grid.tiles, grid.tileSize);
+
+        Vec mapX = Ops::Load(packet.mapX);
+        Vec mapY = Ops::Load(packet.mapY);
+        Vec stepX = Ops::Load(packet.stepX);
+        Vec stepY = Ops::Load(packet.stepY);
+        Vec sideDistX = Ops::Load(packet.sideDistX);
+        Vec sideDistY = Ops::Load(packet.sideDistY);
+        Vec deltaDistX = Ops::Load(packet.deltaDistX);
+        Vec deltaDistY = Ops::Load(packet.deltaDistY);
+
+        Vec stepsX = zero;
+        Vec stepsY = zero;
+        Vec dist = zero;
+        Vec side = zero;
+        Vec hit = Ops::CmpLt(one, zero);
+        Vec active = Ops::CmpEq(zero, zero);
+
+        // Open space around each lane's cell, when there's a distance field to skip with
+        const GridTiles<Ops> spaceCells(grid, grid.space, 1);
+        const Vec skipMin = Ops::Set1(SKIP_MIN_SPACE);
+        Vec space = zero;
+        if (grid.space)
+        {
+            Vec inside = Ops::And(Ops::And(Ops::CmpGe(mapX, zero), Ops::CmpLt(mapX, width)),
+                Ops::And(Ops::CmpGe(mapY, zero), Ops::CmpLt(mapY, height)));
+            space = spaceCells.Load(mapX, mapY, inside);
+        }
+
+        while (true)
+        {
+            // Jump to the edge of the open square around the cell, see SkipOpenSquare()
+            Vec skip = Ops::And(active, Ops::CmpGe(space, skipMin));
+            if (Ops::MoveMask(skip) != 0)
+            {
+                Vec reach = Ops::Sub(space, one);
+                Vec lastX = Ops::Add(stepsX, reach);
+                Vec lastY = Ops::Add(stepsY, reach);
+                Vec exitX = Ops::Add(sideDistX, Ops::Mul(lastX, deltaDistX));
+                Vec exitY = Ops::Add(sideDistY, Ops::Mul(lastY, deltaDistY));
+                Vec exitIsX = Ops::CmpLt(exitX, exitY);
+
+                Vec countX = CountCrossings<Ops>(Ops::AndNot(exitIsX, skip), sideDistX, deltaDistX, stepsX, lastX, exitY, false);
+                Vec countY = CountCrossings<Ops>(Ops::And(exitIsX, skip), sideDistY, deltaDistY, stepsY, lastY, exitX, true);
+                Vec skippedX = Ops::Select(skip, Ops::Select(exitIsX, lastX, countX), stepsX);
+                Vec skippedY = Ops::Select(skip, Ops::Select(exitIsX, countY, lastY), stepsY);
+
+                mapX = Ops::Add(mapX, Ops::Mul(Ops::Sub(skippedX, stepsX), stepX));
+                mapY = Ops::Add(mapY, Ops::Mul(Ops::Sub(skippedY, stepsY), stepY));
+                stepsX = skippedX;
+                stepsY = skippedY;
+            }
+
+            // Step into whichever cell the ray reaches first
+            Vec nextX = Ops::Add(sideDistX, Ops::Mul(stepsX, deltaDistX));
+            Vec nextY = Ops::Add(sideDistY, Ops::Mul(stepsY, deltaDistY));
+            Vec inX = Ops::CmpLt(nextX, nextY);
+            Vec moveX = Ops::And(active, inX);
+            Vec moveY = Ops::AndNot(inX, active);
+
+            mapX = Ops::Add(mapX, Ops::And(moveX, stepX));
+            mapY = Ops::Add(mapY, Ops::And(moveY, stepY));
+            stepsX = Ops::Add(stepsX, Ops::And(moveX, one));
+            stepsY = Ops::Add(stepsY, Ops::And(moveY, one));
+            dist = Ops::Select(moveX, nextX, Ops::Select(moveY, nextY, dist));
+            side = Ops::Select(moveX, zero, Ops::Select(moveY, one, side));
+
+            Vec inside = Ops::And(Ops::And(Ops::CmpGe(mapX, zero), Ops::CmpLt(mapX, width)),
+                Ops::And(Ops::CmpGe(mapY, zero), Ops::CmpLt(mapY, height)));
+            active = Ops::And(active, inside);
+            if (Ops::MoveMask(active) == 0)
+            {
+                break;
+            }
+
+            // A distance of 0 is a wall
+            Vec wall;
+            if (grid.space)
+            {
+                space = spaceCells.Load(mapX, mapY, active);
+                wall = Ops::And(active, Ops::CmpEq(space, zero));
+            }
+            else
+            {
+                Vec tile = tiles.Load(mapX, mapY, active);
+                wall = Ops::And(active, Ops::CmpGt(tile, zero));
+            }
+
+            hit = Ops::Or(hit, wall);
+            active = Ops::AndNot(wall, active);
+            if (Ops::MoveMask(active) == 0)
+            {
+                break;
+            }
+        }
+
+        double laneDist[RAY_PACKET_SIZE];
+        double laneSide[RAY_PACKET_SIZE];
+        double laneTileX[RAY_PACKET_SIZE];
+        double laneTileY[RAY_PACKET_SIZE];
+        Ops::Store(laneDist, dist);
+        Ops::Store(laneSide, side);
+        Ops::Store(laneTileX, mapX);
+        Ops::Store(laneTileY, mapY);
+
+        int lanesHit = Ops::MoveMask(hit);
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            hits[lane].hit = (lanesHit & (1 << lane)) != 0;
+            hits[lane].perpDist = laneDist[lane];
+            hits[lane].side = (int)laneSide[lane];
+            hits[lane].tileX = (int)laneTileX[lane];
+            hits[lane].tileY = (int)laneTileY[lane];
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#include "PCH.hpp"
+#include "RayTraceTyped.hpp"
+
+// Distance along the ray between two crossings of the same set of grid lines.
+// A ray parallel to the lines never crosses them.
+template <typename Scalar>
+static Scalar DeltaDistTyped(Scalar rayDir)
+{
+    typedef ScalarTraits<Scalar> Traits;
+    return (rayDir == Scalar(0)) ? Traits::Largest() : Traits::Abs(Scalar(1) / rayDir);
+}
+
+template <typename Scalar>
+void TraceRayTyped(const GridView& grid, Scalar rayDirX, Scalar rayDirY, GridHitT<Scalar>& hit)
+{
+    typedef ScalarTraits<Scalar> Traits;
+
+    Scalar originX = Traits::FromDouble(grid.originX);
+    Scalar originY = Traits::FromDouble(grid.originY);
+
+    // The cell the ray starts in
+    int mapX = Traits::Floor(originX);
+    int mapY = Traits::Floor(originY);
+
+    Scalar deltaDistX = DeltaDistTyped(rayDirX);
+    Scalar deltaDistY = DeltaDistTyped(rayDirY);
+
+    // Which way to step, and how far along the ray the first grid line crossings are
+    int stepX = (rayDirX < Scalar(0)) ? -1 : 1;
+    int stepY = (rayDirY < Scalar(0)) ? -1 : 1;
+    Scalar sideDistX = (rayDirX < Scalar(0)) ? (originX - Scalar(mapX)) * deltaDistX : (Scalar(mapX + 1) - originX) * deltaDistX;
+    Scalar sideDistY = (rayDirY < Scalar(0)) ? (originY - Scalar(mapY)) * deltaDistY : (Scalar(mapY + 1) - originY) * deltaDistY;
+
+    // Counted rather than summed up, as in TraceRayDDA(). With fixed point the
+    // products saturate, so a ray too long to measure still ends at the grid's edge.
+    int stepsX = 0;
+    int stepsY = 0;
+
+    hit.hit = false;
+    hit.perpDist = Scalar(0);
+    hit.side = 0;
+
+    while (true)
+    {
+        Scalar nextX = sideDistX + Scalar(stepsX) * deltaDistX;
+        Scalar nextY = sideDistY + Scalar(stepsY) * deltaDistY;
+
+        if (nextX < nextY)
+        {
+            mapX += stepX;
+            stepsX++;
+            hit.perpDist = nextX;
+            hit.side = 0;
+        }
+        else
+        {
+            mapY += stepY;
+            stepsY++;
+            hit.perpDist = nextY;
+            hit.side = 1;
+        }
+
+        if (mapX < 0 || mapX >= grid.width || mapY < 0 || mapY >= grid.height)
+        {
+            break;
+        }
+
+        if (GetGridTile(grid, mapX, mapY) > 0)
+        {
+            hit.hit = true;
+            break;
+        }
+    }
+
+    hit.tileX = mapX;
+    hit.tileY = mapY;
+    hit.x = originX + rayDirX * hit.perpDist;
+    hit.y = originY + rayDirY * hit.perpDist;
+}
+
+template void TraceRayTyped<double>(const GridView& grid, double rayDirX, double rayDirY, GridHitT<double>& hit);
+template void TraceRayTyped<float>(const GridView& grid, float rayDirX, float rayDirY, GridHitT<float>& hit);
+template void TraceRayTyped<Fixed>(const GridView& grid, Fixed rayDirX, Fixed rayDirY, GridHitT<Fixed>& hit);
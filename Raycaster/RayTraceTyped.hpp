@@ -0,0 +1,43 @@
+#pragma once
+
+#include "PCH.hpp"
+#include "RayTrace.hpp"
+#include "Scalar.hpp"
+
+// The DDA walk with its math done in any of the scalar types from Scalar.hpp, for
+// builds that trade accuracy for speed or for CPUs without fast doubles. With double
+// it finds exactly what TraceRayDDA() finds without a distance field. It never uses
+// the distance field, and there are no packet versions.
+
+template <typename Scalar>
+struct GridHitT
+{
+    bool hit;
+    Scalar perpDist; // Distance to the hit along the view direction
+    int side; // 0 for a vertical grid line, 1 for a horizontal one
+    int tileX;
+    int tileY;
+    Scalar x;
+    Scalar y;
+};
+
+// Instantiated for double, float and Fixed
+template <typename Scalar>
+void TraceRayTyped(const GridView& grid, Scalar rayDirX, Scalar rayDirY, GridHitT<Scalar>& hit);
+
+// The same hit with everything in doubles
+template <typename Scalar>
+GridHit ToGridHit(const GridHitT<Scalar>& hit)
+{
+    GridHit result;
+    result.hit = hit.hit;
+    result.distSq = 0;
+    result.perpDist = ScalarTraits<Scalar>::ToDouble(hit.perpDist);
+    result.side = hit.side;
+    result.tileX = hit.tileX;
+    result.tileY = hit.tileY;
+    result.x = ScalarTraits<Scalar>::ToDouble(hit.x);
+    result.y = ScalarTraits<Scalar>::ToDouble(hit.y);
+
+    return result;
+}
@@ -0,0 +1,1290 @@
+#include "PCH.hpp"
+#include "Raycaster.hpp"
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+static const int DEFAULT_MAP_WIDTH = 30;
+static const int DEFAULT_MAP_HEIGHT = 30;
+
+static const int DEFAULT_MAP[DEFAULT_MAP_WIDTH * DEFAULT_MAP_HEIGHT] =
+{
+    2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,3,1,1,1,1,1,3,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,3,1,1,0,1,1,3,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,
+    2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2
+};
+
+// Pillars at the corners of the middle room, and barrels and lamps around it
+static const Sprite DEFAULT_SPRITES[] =
+{
+    { 10.5, 7.5, 1 }, { 18.5, 7.5, 1 }, { 10.5, 13.5, 1 }, { 18.5, 13.5, 1 },
+    { 13.5, 10.5, 2 }, { 15.5, 10.5, 2 },
+    { 4.5, 4.5, 0 }, { 5.5, 4.5, 0 }, { 4.5, 5.5, 0 },
+    { 24.5, 24.5, 0 }, { 25.5, 25.5, 0 },
+    { 8.5, 20.5, 2 }, { 20.5, 20.5, 2 }
+};
+
+Map map;
+
+SkipMode skipMode = SKIP_AUTO;
+DistanceField distanceField;
+static bool distanceFieldDirty = true;
+
+Pvs pvs;
+const byte* visibleClusters = nullptr;
+
+// Off with --pvs off, otherwise a map's .pvs file is loaded along with it. With
+// --pvs bake every map gets one baked as it's loaded instead.
+static bool pvsEnabled = true;
+static bool pvsBaked = false;
+
+TextureAtlas textures;
+bool texturedWalls = true;
+bool texturedFloors = true;
+
+std::vector<Sprite> sprites;
+TextureAtlas spriteTextures;
+static SpriteGrid spriteGrid;
+static SpriteRenderer spriteRenderer;
+static bool spritesDirty = true;
+float depthBuffer[RENDER_WIDTH];
+
+static MinimapLayer minimap;
+RayOverlay rayOverlay = RAY_OVERLAY_LINES;
+static LineBatch rayLines;
+
+// What the columns were last cast from. While none of it changes, Update() reuses them,
+// and after a few tiles change it only casts the columns whose rays crossed them again.
+struct CastState
+{
+    double x;
+    double y;
+    double rot;
+    int width;
+    int height;
+    Caster caster;
+    bool texturedWalls;
+    bool texturedFloors;
+};
+
+static CastState lastCast;
+static bool lastCastValid = false;
+static std::vector<std::pair<int, int> > editedTiles;
+
+// Past this many edits in a frame, casting every column again is about as cheap
+static const size_t MAX_EDITED_TILES = 64;
+
+// Columns to cast again this frame, one flag each
+static std::vector<char> recastColumns;
+
+// Where SaveProfile() writes the profiler's frames, if anywhere
+static std::string profileCsvFile;
+static std::string profileTraceFile;
+
+FrameCapture frameCapture;
+static std::string captureFile;
+static int captureBuffers = CAPTURE_BUFFERS;
+
+// Player variables
+double playerX = 14.5;
+double playerY = 22;
+double playerDir = 0;
+double playerRot = 0;
+double playerSpeed = 0;
+double playerMoveSpeed = 32;
+double playerRotSpeed = 180 * (M_PI / 180);
+
+double viewDist;
+
+
+int renderWidth = RENDER_WIDTH;
+int renderHeight = RENDER_HEIGHT;
+
+Pixel pixels[RENDER_WIDTH * RENDER_HEIGHT];
+Pixel* framebuffer = pixels;
+int framebufferPitch = RENDER_WIDTH;
+
+FrameStats frameStats;
+
+DisplayList displayList;
+
+RayHit rayHits[RENDER_WIDTH];
+
+Caster caster = CASTER_DDA;
+
+double planeLength;
+double columnCameraX[RENDER_WIDTH];
+
+double cameraDirX;
+double cameraDirY;
+double cameraPlaneX;
+double cameraPlaneY;
+
+ThreadPool* renderPool = nullptr;
+
+void SetRenderThreads(int threadCount)
+{
+    if (threadCount < 1)
+    {
+        threadCount = SDL_GetCPUCount();
+    }
+
+    if (renderPool && renderPool->GetThreadCount() == threadCount)
+    {
+        return;
+    }
+
+    delete renderPool;
+    renderPool = new ThreadPool(threadCount);
+}
+
+void InitRaycaster()
+{
+    LoadDefaultMap();
+    textures.Generate();
+    spriteTextures.GenerateSprites();
+    SetRenderThreads(0);
+    SelectRayTracer(RAY_TRACER_AVX2);
+    SetupProjection();
+}
+
+void SetupProjection()
+{
+    viewDist = (renderWidth / 2) / tan(FOV / 2);
+
+    // The camera plane is perpendicular to the view direction, and long enough
+    // that its ends line up with the edges of the field of view
+    planeLength = tan(FOV / 2);
+
+    for (int x = 0; x < renderWidth; x++)
+    {
+        columnCameraX[x] = (double)(-renderWidth / 2 + x) / (renderWidth / 2);
+    }
+
+    // Ceiling and floor are left black, like the framebuffer used to be cleared to
+    ResizeDisplayList(displayList, renderWidth, renderHeight);
+    displayList.ceilingColor = 0;
+    displayList.floorColor = 0;
+
+    InvalidateFrame();
+}
+
+void SetRenderSize(int width, int height)
+{
+    width = std::min(std::max(width, MIN_RENDER_WIDTH), RENDER_WIDTH);
+    height = std::min(std::max(height, MIN_RENDER_HEIGHT), RENDER_HEIGHT);
+    if (width == renderWidth && height == renderHeight)
+    {
+        return;
+    }
+
+    renderWidth = width;
+    renderHeight = height;
+    SetupProjection();
+}
+
+void LoadDefaultMap()
+{
+    map.Create(DEFAULT_MAP_WIDTH, DEFAULT_MAP_HEIGHT, 1, 0);
+    for (int y = 0; y < DEFAULT_MAP_HEIGHT; y++)
+    {
+        for (int x = 0; x < DEFAULT_MAP_WIDTH; x++)
+        {
+            map.SetTile(x, y, DEFAULT_MAP[(y * DEFAULT_MAP_WIDTH) + x]);
+        }
+    }
+
+    sprites.assign(DEFAULT_SPRITES, DEFAULT_SPRITES + sizeof(DEFAULT_SPRITES) / sizeof(DEFAULT_SPRITES[0]));
+    spritesDirty = true;
+    distanceFieldDirty = true;
+    minimap.Invalidate();
+    InvalidateFrame();
+}
+
+// Moves the player to the nearest open tile, if they're inside a wall or off the map
+static void PlacePlayer()
+{
+    int startX = (int)floor(playerX);
+    int startY = (int)floor(playerY);
+    if (map.IsInside(startX, startY) && map.GetTile(startX, startY) == 0)
+    {
+        return;
+    }
+
+    startX = std::min(std::max(startX, 0), map.GetWidth() - 1);
+    startY = std::min(std::max(startY, 0), map.GetHeight() - 1);
+
+    // Search outwards in growing squares
+    int maxRadius = std::max(map.GetWidth(), map.GetHeight());
+    for (int radius = 0; radius < maxRadius; radius++)
+    {
+        for (int y = startY - radius; y <= startY + radius; y++)
+        {
+            // Only the edge of the square, the inside was searched already
+            int step = (y == startY - radius || y == startY + radius) ? 1 : radius * 2;
+            for (int x = startX - radius; x <= startX + radius; x += std::max(step, 1))
+            {
+                if (map.IsInside(x, y) && map.GetTile(x, y) == 0)
+                {
+                    playerX = x + 0.5;
+                    playerY = y + 0.5;
+                    return;
+                }
+            }
+        }
+    }
+}
+
+bool LoadMap(const std::string& fileName)
+{
+    if (!map.Load(fileName))
+    {
+        return false;
+    }
+
+    if (!FitsPacketTracers(map.GetGridView(0, 0)))
+    {
+        std::cerr << fileName << " is past the packet tracers' 2 GB, its rays are traced one at a time" << std::endl;
+    }
+
+    PlacePlayer();
+    sprites.clear();
+    spritesDirty = true;
+    distanceFieldDirty = true;
+    minimap.Invalidate();
+    InvalidateFrame();
+
+    pvs.Clear();
+    std::string pvsFile = fileName + ".pvs";
+    if (pvsBaked)
+    {
+        BakePvs();
+    }
+    else if (pvsEnabled && std::ifstream(pvsFile.c_str()) && !LoadPvs(pvsFile))
+    {
+        std::cerr << pvsFile << " doesn't fit " << fileName << ", bake it again with pvsbake" << std::endl;
+    }
+
+    return true;
+}
+
+bool LoadPvs(const std::string& fileName)
+{
+    return pvs.Load(fileName, map);
+}
+
+bool BakePvs()
+{
+    return pvs.Bake(map, PVS_DEFAULT_CLUSTER_SHIFT, PVS_DEFAULT_ANGLES, PVS_DEFAULT_SAMPLES, renderPool);
+}
+
+void ScatterSprites(int count, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> randomX(0, map.GetWidth() - 1);
+    std::uniform_int_distribution<int> randomY(0, map.GetHeight() - 1);
+    std::uniform_int_distribution<int> randomTexture(0, spriteTextures.GetTextureCount() - 1);
+
+    // Gives up on a map with hardly any open tiles rather than looking forever
+    for (int tries = 0; count > 0 && tries < count * 100; tries++)
+    {
+        int x = randomX(rng);
+        int y = randomY(rng);
+        if (map.GetTile(x, y) == 0)
+        {
+            Sprite sprite = { x + 0.5, y + 0.5, randomTexture(rng) };
+            sprites.push_back(sprite);
+            count--;
+        }
+    }
+
+    spritesDirty = true;
+}
+
+void SpritesChanged()
+{
+    spritesDirty = true;
+}
+
+void SetMapTile(int x, int y, int tile)
+{
+    if (!map.IsInside(x, y) || map.GetTile(x, y) == tile)
+    {
+        return;
+    }
+
+    map.SetTile(x, y, tile);
+    minimap.InvalidateTile(x, y);
+
+    // Opening a wall up can let more be seen than was baked
+    if (pvs.IsBaked())
+    {
+        pvs.Clear();
+        std::cerr << "The map changed, so the PVS is off until it's baked again" << std::endl;
+    }
+
+    if (editedTiles.size() < MAX_EDITED_TILES)
+    {
+        editedTiles.push_back(std::make_pair(x, y));
+    }
+    else
+    {
+        InvalidateFrame();
+    }
+
+    if (distanceField.IsBuilt() && !distanceFieldDirty)
+    {
+        distanceField.UpdateTile(map, x, y);
+    }
+}
+
+void InvalidateFrame()
+{
+    lastCastValid = false;
+}
+
+static CastState GetCastState()
+{
+    CastState state;
+    state.x = playerX;
+    state.y = playerY;
+    state.rot = playerRot;
+    state.width = renderWidth;
+    state.height = renderHeight;
+    state.caster = caster;
+    state.texturedWalls = texturedWalls;
+    state.texturedFloors = texturedFloors;
+
+    return state;
+}
+
+static bool SameCastState(const CastState& a, const CastState& b)
+{
+    return a.x == b.x && a.y == b.y && a.rot == b.rot && a.width == b.width && a.height == b.height &&
+        a.caster == b.caster && a.texturedWalls == b.texturedWalls && a.texturedFloors == b.texturedFloors;
+}
+
+bool FrameChanged()
+{
+    return !lastCastValid || !editedTiles.empty() || spritesDirty || !SameCastState(lastCast, GetCastState());
+}
+
+// Whether the segment from (x0, y0) to (x1, y1) touches tile (tileX, tileY), edges
+// included, so a ray that ended on the tile's face counts
+static bool SegmentTouchesTile(double x0, double y0, double x1, double y1, int tileX, int tileY)
+{
+    const double EDGE = 1e-6;
+    double t0 = 0;
+    double t1 = 1;
+    double start[2] = { x0, y0 };
+    double delta[2] = { x1 - x0, y1 - y0 };
+    double low[2] = { tileX - EDGE, tileY - EDGE };
+    double high[2] = { tileX + 1 + EDGE, tileY + 1 + EDGE };
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (delta[axis] == 0)
+        {
+            if (start[axis] < low[axis] || start[axis] > high[axis])
+            {
+                return false;
+            }
+            continue;
+        }
+
+        double enter = (low[axis] - start[axis]) / delta[axis];
+        double exit = (high[axis] - start[axis]) / delta[axis];
+        if (enter > exit)
+        {
+            std::swap(enter, exit);
+        }
+
+        t0 = std::max(t0, enter);
+        t1 = std::min(t1, exit);
+        if (t0 > t1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Flags the columns whose rays crossed or ended on an edited tile. Rays that
+// hit nothing ran off the map, so any of them might hit the new tile.
+static int FindRecastColumns()
+{
+    recastColumns.assign(renderWidth, 0);
+
+    int count = 0;
+    for (int x = 0; x < renderWidth; x++)
+    {
+        bool recast = !rayHits[x].hit;
+        for (size_t i = 0; !recast && i < editedTiles.size(); i++)
+        {
+            recast = SegmentTouchesTile(playerX, playerY, rayHits[x].x, rayHits[x].y, editedTiles[i].first, editedTiles[i].second);
+        }
+
+        recastColumns[x] = recast;
+        count += recast;
+    }
+
+    return count;
+}
+
+static void CastAllColumns()
+{
+    if (renderPool)
+    {
+        renderPool->ParallelFor(renderWidth, COLUMN_CHUNK, [](int begin, int end, int)
+        {
+            CastColumns(begin, end);
+        });
+    }
+    else
+    {
+        CastColumns(0, renderWidth);
+    }
+}
+
+// Casts each run of flagged columns. There are only ever a few, so on one thread.
+static void CastFlaggedColumns()
+{
+    int x = 0;
+    while (x < renderWidth)
+    {
+        if (!recastColumns[x])
+        {
+            x++;
+            continue;
+        }
+
+        int begin = x;
+        while (x < renderWidth && recastColumns[x])
+        {
+            x++;
+        }
+
+        CastColumns(begin, x);
+    }
+}
+
+void ToggleWallInFront()
+{
+    int x = (int)floor(playerX + cos(playerRot));
+    int y = (int)floor(playerY + sin(playerRot));
+
+    // Never the player's own tile, or the walls around the edge that keep them in
+    if ((x == (int)floor(playerX) && y == (int)floor(playerY)) || x <= 0 || y <= 0 || x >= map.GetWidth() - 1 || y >= map.GetHeight() - 1)
+    {
+        return;
+    }
+
+    SetMapTile(x, y, (map.GetTile(x, y) == 0) ? 1 : 0);
+}
+
+bool IsSkipping()
+{
+    if (skipMode == SKIP_AUTO)
+    {
+        return (Uint64)map.GetWidth() * map.GetHeight() >= SKIP_AUTO_MIN_TILES;
+    }
+
+    return skipMode == SKIP_ON;
+}
+
+// Builds the distance field if the map changed since it was last built, or throws it away
+// when it's not being used
+void UpdateDistanceField()
+{
+    if (!IsSkipping())
+    {
+        distanceField.Clear();
+        distanceFieldDirty = true;
+    }
+    else if (distanceFieldDirty)
+    {
+        distanceField.Build(map);
+        distanceFieldDirty = false;
+    }
+}
+
+ViewBasis GetViewBasis()
+{
+    ViewBasis view;
+    view.x = playerX;
+    view.y = playerY;
+    view.dirX = cameraDirX;
+    view.dirY = cameraDirY;
+    view.planeX = cameraPlaneX;
+    view.planeY = cameraPlaneY;
+    view.planeLength = planeLength;
+    view.viewDist = viewDist;
+
+    return view;
+}
+
+GridView GetPlayerGrid()
+{
+    GridView grid = map.GetGridView(playerX, playerY);
+    if (IsSkipping() && !distanceFieldDirty)
+    {
+        grid.space = distanceField.GetCells();
+    }
+
+    return grid;
+}
+
+int GetRenderThreads()
+{
+    return renderPool ? renderPool->GetThreadCount() : 1;
+}
+
+// Handles the command line options shared by the game and the benchmarks.
+// Returns false if argv[i] isn't one of them.
+bool ParseRenderOption(int argc, char** argv, int& i)
+{
+    bool hasValue = (i + 1 < argc);
+
+    if (strcmp(argv[i], "--threads") == 0 && hasValue)
+    {
+        SetRenderThreads(atoi(argv[++i]));
+        return true;
+    }
+
+    if (strcmp(argv[i], "--render") == 0 && hasValue)
+    {
+        int width = 0;
+        int height = 0;
+        if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width > RENDER_WIDTH || height > RENDER_HEIGHT)
+        {
+            return false;
+        }
+
+        SetRenderSize(width, height);
+        return true;
+    }
+
+    if (strcmp(argv[i], "--tracer") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        for (int tracer = RAY_TRACER_SCALAR; tracer <= RAY_TRACER_AVX2; tracer++)
+        {
+            if (strcmp(name, GetRayTracerName((RayTracer)tracer)) == 0)
+            {
+                SelectRayTracer((RayTracer)tracer);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    if (strcmp(argv[i], "--map") == 0 && hasValue)
+    {
+        return LoadMap(argv[++i]);
+    }
+
+    if (strcmp(argv[i], "--pvs") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        pvsEnabled = (strcmp(name, "off") != 0);
+        pvsBaked = (strcmp(name, "bake") == 0);
+        if (!pvsEnabled)
+        {
+            pvs.Clear();
+            return true;
+        }
+
+        if (pvsBaked)
+        {
+            return BakePvs();
+        }
+
+        return LoadPvs(name);
+    }
+
+    if (strcmp(argv[i], "--skip") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        if (strcmp(name, "auto") == 0)
+        {
+            skipMode = SKIP_AUTO;
+        }
+        else if (strcmp(name, "on") == 0)
+        {
+            skipMode = SKIP_ON;
+        }
+        else if (strcmp(name, "off") == 0)
+        {
+            skipMode = SKIP_OFF;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    if (strcmp(argv[i], "--textures") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        if (strcmp(name, "on") == 0)
+        {
+            texturedWalls = true;
+        }
+        else if (strcmp(name, "off") == 0)
+        {
+            texturedWalls = false;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    if (strcmp(argv[i], "--floors") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        if (strcmp(name, "on") == 0)
+        {
+            texturedFloors = true;
+        }
+        else if (strcmp(name, "off") == 0)
+        {
+            texturedFloors = false;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    if (strcmp(argv[i], "--sprites") == 0 && hasValue)
+    {
+        sprites.clear();
+        ScatterSprites(atoi(argv[++i]), 1);
+        return true;
+    }
+
+    if (strcmp(argv[i], "--atlas") == 0 && hasValue)
+    {
+        if (!textures.Load(argv[++i]))
+        {
+            return false;
+        }
+
+        InvalidateFrame();
+        return true;
+    }
+
+    if (strcmp(argv[i], "--sprite-atlas") == 0 && hasValue)
+    {
+        if (!spriteTextures.Load(argv[++i]))
+        {
+            return false;
+        }
+
+        // The sprites' textures are checked against the new atlas
+        spritesDirty = true;
+        InvalidateFrame();
+        return true;
+    }
+
+    if (strcmp(argv[i], "--minimap-rays") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        if (strcmp(name, "lines") == 0)
+        {
+            rayOverlay = RAY_OVERLAY_LINES;
+        }
+        else if (strcmp(name, "cone") == 0)
+        {
+            rayOverlay = RAY_OVERLAY_CONE;
+        }
+        else if (strcmp(name, "off") == 0)
+        {
+            rayOverlay = RAY_OVERLAY_OFF;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    if (strcmp(argv[i], "--profile-csv") == 0 && hasValue)
+    {
+        profileCsvFile = argv[++i];
+        return true;
+    }
+
+    if (strcmp(argv[i], "--profile-trace") == 0 && hasValue)
+    {
+        profileTraceFile = argv[++i];
+        return true;
+    }
+
+    if (strcmp(argv[i], "--capture") == 0 && hasValue)
+    {
+        captureFile = argv[++i];
+        return true;
+    }
+
+    if (strcmp(argv[i], "--capture-buffers") == 0 && hasValue)
+    {
+        captureBuffers = atoi(argv[++i]);
+        return captureBuffers > 0;
+    }
+
+    if (strcmp(argv[i], "--caster") == 0 && hasValue)
+    {
+        const char* name = argv[++i];
+        if (strcmp(name, "dda") == 0)
+        {
+            caster = CASTER_DDA;
+        }
+        else if (strcmp(name, "angle") == 0)
+        {
+            caster = CASTER_ANGLE;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// Writes the last frames the profiler has to the files given on the command line
+void SaveProfile()
+{
+    if (profileCsvFile.empty() && profileTraceFile.empty())
+    {
+        return;
+    }
+
+#ifndef RAYCASTER_PROFILE
+    std::cerr << "Profiling was compiled out, see RAYCASTER_PROFILE in CMakeLists.txt" << std::endl;
+#endif
+
+    if (!profileCsvFile.empty())
+    {
+        profiler.WriteCsv(profileCsvFile);
+    }
+
+    if (!profileTraceFile.empty())
+    {
+        profiler.WriteChromeTrace(profileTraceFile);
+    }
+}
+
+bool IsCaptureRequested()
+{
+    return !captureFile.empty();
+}
+
+bool StartCapture(int fps)
+{
+    if (captureFile.empty())
+    {
+        return true;
+    }
+
+    size_t extension = captureFile.rfind('.');
+    bool y4m = (extension != std::string::npos && captureFile.substr(extension) == ".y4m");
+
+    if (!frameCapture.Start(captureFile, y4m ? CAPTURE_Y4M : CAPTURE_RAW, RENDER_WIDTH, RENDER_HEIGHT, fps, captureBuffers))
+    {
+        std::cerr << "Could not open " << captureFile << " for capture" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void StopCapture()
+{
+    if (!frameCapture.IsActive())
+    {
+        return;
+    }
+
+    frameCapture.Stop();
+
+    std::cerr << "Captured " << frameCapture.GetFramesWritten() << " frames of " << frameCapture.GetWidth() << "x" << frameCapture.GetHeight()
+        << " to " << captureFile << ", dropped " << frameCapture.GetFramesDropped() << std::endl;
+    if (frameCapture.HasFailed())
+    {
+        std::cerr << "Writing " << captureFile << " failed, the capture is cut short" << std::endl;
+    }
+}
+
+double Rad(double deg)
+{
+    return deg * (M_PI / 180);
+}
+
+void Simulate()
+{
+    double velX = cos(playerRot) * (playerSpeed * playerMoveSpeed);
+    double velY = sin(playerRot) * (playerSpeed * playerMoveSpeed);
+    MoveCircle(map, PLAYER_RADIUS, WALL_SLIDE, playerX, playerY, velX, velY, SIMULATION_STEP);
+
+    playerRot += playerDir * (playerRotSpeed * SIMULATION_STEP);
+
+    if (playerRot < 0)
+    {
+        playerRot += TWO_PI;
+    }
+    else if (playerRot >= TWO_PI)
+    {
+        playerRot -= TWO_PI;
+    }
+}
+
+static SpriteCamera GetSpriteCamera()
+{
+    SpriteCamera camera;
+    camera.x = playerX;
+    camera.y = playerY;
+    camera.dirX = cameraDirX;
+    camera.dirY = cameraDirY;
+    camera.planeX = cameraPlaneX;
+    camera.planeY = cameraPlaneY;
+    camera.planeLength = planeLength;
+    camera.viewDist = viewDist;
+    camera.width = renderWidth;
+    camera.height = renderHeight;
+    camera.depth = depthBuffer;
+    camera.pvs = visibleClusters ? &pvs : nullptr;
+    camera.visibleClusters = visibleClusters;
+
+    return camera;
+}
+
+void Update()
+{
+    // The only trig per frame, the columns all work off these two vectors
+    cameraDirX = cos(playerRot);
+    cameraDirY = sin(playerRot);
+    cameraPlaneX = -cameraDirY * planeLength;
+    cameraPlaneY = cameraDirX * planeLength;
+
+    CastState state = GetCastState();
+    bool moved = !lastCastValid || !SameCastState(lastCast, state);
+
+    {
+        PROFILE_SCOPE(PROFILE_SURFACES);
+
+        UpdateDistanceField();
+
+        // The ceiling and floor only depend on the camera
+        if (moved)
+        {
+            CastSurfaceRows();
+        }
+
+        if (spritesDirty)
+        {
+            ClampSpriteTextures(sprites, spriteTextures.GetTextureCount());
+            spriteGrid.Build(sprites, map.GetWidth(), map.GetHeight());
+            spritesDirty = false;
+        }
+
+        const byte* visible = pvs.GetVisible(playerX, playerY);
+        if (visible != visibleClusters)
+        {
+            visibleClusters = visible;
+            frameStats.clustersVisible = visible ? pvs.CountVisible(visible) : 0;
+        }
+
+        frameStats.clusterCount = pvs.GetClusterCount();
+
+        // The sprite cells the PVS rules out are dropped before any rays are cast.
+        // DrawSprites() then only has the wall depth test left to do.
+        spriteRenderer.FindCells(sprites, spriteGrid, GetSpriteCamera());
+    }
+
+    PROFILE_SCOPE(PROFILE_CAST);
+
+    if (moved)
+    {
+        CastAllColumns();
+        frameStats.columnsCast = renderWidth;
+    }
+    else if (!editedTiles.empty())
+    {
+        frameStats.columnsCast = FindRecastColumns();
+        CastFlaggedColumns();
+    }
+    else
+    {
+        frameStats.columnsCast = 0;
+    }
+
+    lastCast = state;
+    lastCastValid = true;
+    editedTiles.clear();
+}
+
+void SetFramebuffer(Pixel* target, int pitch)
+{
+    framebuffer = target;
+    framebufferPitch = pitch;
+}
+
+void Draw()
+{
+    {
+        PROFILE_SCOPE(PROFILE_RASTER);
+
+        // Every pixel is covered by a ceiling, wall or floor span, so there's nothing to clear first
+        RasterStats raster = RasterizeDisplayList(displayList, framebuffer, framebufferPitch, renderPool);
+        frameStats.bytesDrawn = (Uint64)renderWidth * renderHeight * sizeof(Uint32);
+
+        double tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+        frameStats.wallMs = raster.wallTicks * tickMs;
+        frameStats.floorMs = raster.surfaceTicks * tickMs;
+    }
+
+    DrawSprites();
+
+    {
+        PROFILE_SCOPE(PROFILE_MINIMAP);
+        Minimap();
+    }
+
+    if (frameCapture.IsActive())
+    {
+        PROFILE_SCOPE(PROFILE_CAPTURE);
+        frameCapture.Submit(framebuffer, framebufferPitch, renderWidth, renderHeight);
+    }
+}
+
+void DrawSprites()
+{
+    PROFILE_SCOPE(PROFILE_SPRITES);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SpriteCamera camera = GetSpriteCamera();
+    spriteRenderer.Cull(sprites, spriteGrid, camera);
+
+    if (spriteRenderer.GetVisibleCount() > 0)
+    {
+        if (renderPool)
+        {
+            renderPool->ParallelFor(renderWidth, COLUMN_CHUNK, [&](int begin, int end, int)
+            {
+                spriteRenderer.DrawColumns(spriteTextures, camera, framebuffer, framebufferPitch, begin, end);
+            });
+        }
+        else
+        {
+            spriteRenderer.DrawColumns(spriteTextures, camera, framebuffer, framebufferPitch, 0, renderWidth);
+        }
+    }
+
+    frameStats.spritesVisible = spriteRenderer.GetVisibleCount();
+    frameStats.spritesCulled = spriteRenderer.GetSpritesCulled();
+    frameStats.spriteMs = (double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+}
+
+void CastSurfaceRows()
+{
+    SetSurfaceRows(displayList, texturedFloors ? &textures : nullptr, GetViewBasis());
+}
+
+double ColumnAngle(int x)
+{
+    // Where on the screen the ray goes through
+    double rayScreenPos = (-renderWidth / 2 + x);
+
+    // The distance from the viewer to the point on the screen
+    double rayViewDist = sqrt((rayScreenPos * rayScreenPos) + (viewDist * viewDist));
+
+    // The angle of the ray, relative to the viewing direction.
+    double rayAngle = asin(rayScreenPos / rayViewDist);
+
+    rayAngle += playerRot;
+    if (rayAngle < 0)
+    {
+        rayAngle += TWO_PI;
+    }
+    else if (rayAngle >= TWO_PI)
+    {
+        rayAngle -= TWO_PI;
+    }
+
+    return rayAngle;
+}
+
+// The wall height is 1 unit, the distance from the player to the screen is viewDist,
+// thus the height on the screen is equal to
+// wallHeight * viewDist / dist
+template <typename Scalar>
+static double StripHeight(Scalar dist)
+{
+    typedef ScalarTraits<Scalar> Traits;
+    return round(Traits::ToDouble(Traits::FromDouble(viewDist) / dist));
+}
+
+// The DDA caster with its math in Scalar, for builds where Real isn't double
+template <typename Scalar>
+static void CastColumnsTyped(int begin, int end)
+{
+    typedef ScalarTraits<Scalar> Traits;
+
+    GridView grid = GetPlayerGrid();
+    Scalar dirX = Traits::FromDouble(cameraDirX);
+    Scalar dirY = Traits::FromDouble(cameraDirY);
+    Scalar planeX = Traits::FromDouble(cameraPlaneX);
+    Scalar planeY = Traits::FromDouble(cameraPlaneY);
+
+    for (int x = begin; x < end; x++)
+    {
+        Scalar cameraX = Traits::FromDouble(columnCameraX[x]);
+        GridHitT<Scalar> hit;
+        TraceRayTyped(grid, dirX + planeX * cameraX, dirY + planeY * cameraX, hit);
+        DrawColumn(x, ToGridHit(hit), StripHeight(hit.perpDist));
+    }
+}
+
+void CastColumns(int begin, int end)
+{
+    if (caster == CASTER_ANGLE)
+    {
+        CastColumnsAngle(begin, end);
+        return;
+    }
+
+#if defined(RAYCASTER_SCALAR_FLOAT) || defined(RAYCASTER_SCALAR_FIXED)
+    CastColumnsTyped<Real>(begin, end);
+#else
+    GridView grid = GetPlayerGrid();
+    ViewBasis view = GetViewBasis();
+
+    // A block of columns at a time
+    GridHit hits[COLUMN_CHUNK];
+    for (int x = begin; x < end; x += COLUMN_CHUNK)
+    {
+        int blockEnd = std::min(x + COLUMN_CHUNK, end);
+        TraceColumnsDDA(grid, view, columnCameraX, x, blockEnd, hits);
+
+        for (int col = x; col < blockEnd; col++)
+        {
+            DrawColumn(col, hits[col - x]);
+        }
+    }
+#endif
+}
+
+// Turns the angle tracer's euclidean distance into the distance along the view direction
+static void AdjustFishEye(double rayAngle, GridHit& hit)
+{
+    if (hit.hit)
+    {
+        // Adjust for fish eye
+        hit.perpDist = sqrt(hit.distSq) * cos(playerRot - rayAngle);
+    }
+}
+
+void CastColumnsAngle(int begin, int end)
+{
+    GridView grid = GetPlayerGrid();
+
+    int x = begin;
+    if (GetRayTracer() != RAY_TRACER_SCALAR)
+    {
+        double rayAngles[RAY_PACKET_SIZE];
+        GridHit hits[RAY_PACKET_SIZE];
+
+        for (; x + RAY_PACKET_SIZE <= end; x += RAY_PACKET_SIZE)
+        {
+            for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+            {
+                rayAngles[lane] = ColumnAngle(x + lane);
+            }
+
+            TraceRayPacket(grid, rayAngles, hits);
+
+            for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+            {
+                AdjustFishEye(rayAngles[lane], hits[lane]);
+                DrawColumn(x + lane, hits[lane]);
+            }
+        }
+    }
+
+    for (; x < end; x++)
+    {
+        CastRay(ColumnAngle(x), x);
+    }
+}
+
+void CastRay(double rayAngle, int col)
+{
+    if (rayAngle < 0)
+    {
+        rayAngle += TWO_PI;
+    }
+    else if (rayAngle >= TWO_PI)
+    {
+        rayAngle -= TWO_PI;
+    }
+
+    GridView grid = GetPlayerGrid();
+    GridHit hit;
+    TraceRay(grid, rayAngle, hit);
+    AdjustFishEye(rayAngle, hit);
+
+    DrawColumn(col, hit);
+}
+
+void DrawColumn(int col, const GridHit& hit)
+{
+    DrawColumn(col, hit, hit.hit ? StripHeight(hit.perpDist) : 0.0);
+}
+
+void DrawColumn(int col, const GridHit& hit, double height)
+{
+    rayHits[col].hit = hit.hit;
+    depthBuffer[col] = hit.hit ? (float)hit.perpDist : INFINITY;
+
+    if (hit.hit)
+    {
+        rayHits[col].x = hit.x;
+        rayHits[col].y = hit.y;
+    }
+
+    int tile = hit.hit ? GetTile(Vector2D(hit.tileX, hit.tileY)) : 0;
+    SetWallColumn(displayList, col, hit, height, tile, texturedWalls ? &textures : nullptr, GetViewBasis());
+}
+
+void Minimap()
+{
+    // Only redraws the tiles that changed since the last frame
+    minimap.Update(map, playerX, playerY, MINIMAP_SIZE * renderHeight / RENDER_HEIGHT, GetTileColor);
+
+    // The rays all draw into the minimap, so they're drawn once the columns are done,
+    // in minimap pixels with the window's top left tile at 0, 0
+    double scale = minimap.GetTilePixels();
+    double left = minimap.GetWindowX();
+    double top = minimap.GetWindowY();
+
+    rayLines.Clear();
+    if (rayOverlay != RAY_OVERLAY_OFF)
+    {
+        for (int x = 0; x < renderWidth; x++)
+        {
+            if (rayHits[x].hit)
+            {
+                rayLines.Add((playerX - left) * scale, (playerY - top) * scale, (rayHits[x].x - left) * scale, (rayHits[x].y - top) * scale);
+            }
+        }
+    }
+
+    ClipRect clip;
+    clip.left = 0;
+    clip.top = 0;
+    clip.right = std::min(minimap.GetWindowTilesX() * minimap.GetTilePixels(), renderWidth);
+    clip.bottom = std::min(minimap.GetWindowTilesY() * minimap.GetTilePixels(), renderHeight);
+
+    if (rayOverlay == RAY_OVERLAY_CONE)
+    {
+        rayLines.FillFan(framebuffer, framebufferPitch, clip, PIXEL_RED);
+    }
+    else
+    {
+        rayLines.Draw(framebuffer, framebufferPitch, clip, PIXEL_RED);
+    }
+
+    minimap.Draw(framebuffer, framebufferPitch, renderWidth, renderHeight, visibleClusters ? &pvs : nullptr, visibleClusters);
+}
+
+int GetTile(Vector2D position)
+{
+    return map.GetTile((int)position.GetX(), (int)position.GetY());
+}
+
+void SetPixel(int x, int y, Pixel color)
+{
+    if (x < 0 || y < 0 || x >= renderWidth || y >= renderHeight)
+    {
+        return;
+    }
+
+    framebuffer[(y * framebufferPitch) + x] = color;
+}
+
+// The shapes below are clipped to the screen once, then filled without checking each pixel
+
+void DrawVerticalLine(int x, int y1, int y2, Pixel color)
+{
+    if (x < 0 || x >= renderWidth)
+    {
+        return;
+    }
+
+    int top = std::max(y1, 0);
+    int bottom = std::min(y2, renderHeight - 1);
+    if (top <= bottom)
+    {
+        FillVerticalSpan(framebuffer + (size_t)top * framebufferPitch + x, framebufferPitch, bottom - top + 1, color);
+    }
+}
+
+void DrawLine(Vector2D start, Vector2D end, Pixel color)
+{
+    ClipRect clip = { 0, 0, renderWidth, renderHeight };
+    DrawClippedLine(framebuffer, framebufferPitch, clip, start.GetX(), start.GetY(), end.GetX(), end.GetY(), color);
+}
+
+void DrawRect(int x, int y, int width, int height, Pixel color)
+{
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + width, renderWidth);
+    int bottom = std::min(y + height, renderHeight);
+    if (left < right && top < bottom)
+    {
+        FillRect(framebuffer + (size_t)top * framebufferPitch + left, framebufferPitch, right - left, bottom - top, color);
+    }
+}
\ No newline at end of file
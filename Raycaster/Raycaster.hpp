@@ -0,0 +1,240 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <math.h>
+#include "Color.hpp"
+#include "Pixel.hpp"
+#include "Vector2D.hpp"
+#include "ThreadPool.hpp"
+#include "RayTrace.hpp"
+#include "RayTraceTyped.hpp"
+#include "DisplayList.hpp"
+#include "Map.hpp"
+#include "DistanceField.hpp"
+#include "TextureAtlas.hpp"
+#include "Sprites.hpp"
+#include "Profiler.hpp"
+#include "Minimap.hpp"
+#include "LineBatch.hpp"
+#include "ViewCast.hpp"
+#include "FrameCapture.hpp"
+#include "Entities.hpp"
+#include "Pvs.hpp"
+
+// The world, the player and the software framebuffer. Everything in here runs
+// without an SDL window, so it is shared by the game and the headless benchmark.
+
+// The built-in level, or one loaded with --map
+extern Map map;
+
+// Whether the game's view skips open space, see SkipMode
+extern SkipMode skipMode;
+extern DistanceField distanceField;
+
+// The map's potentially visible sets, loaded from <map>.pvs next to a --map file if
+// there is one, from --pvs file, or baked with --pvs bake. Dropped once a tile
+// changes, since the sets no longer fit the map. visibleClusters is the player's
+// row, nullptr without a PVS.
+extern Pvs pvs;
+extern const byte* visibleClusters;
+
+// Wall textures, generated at startup or loaded with --atlas. With texturedWalls
+// off the walls are drawn in flat colors, one per tile type, and with
+// texturedFloors off the ceiling and floor are left black.
+extern TextureAtlas textures;
+extern bool texturedWalls;
+extern bool texturedFloors;
+
+// Billboards standing around the map. The built-in level comes with a few, and
+// --sprites N scatters that many instead. Call SpritesChanged() after changing the list.
+extern std::vector<Sprite> sprites;
+extern TextureAtlas spriteTextures;
+
+// The largest render resolution, which the frame buffers are sized for. It can be
+// overridden at build time (see CMakeLists.txt).
+#ifndef RAYCASTER_RENDER_WIDTH
+#define RAYCASTER_RENDER_WIDTH 640
+#endif
+
+#ifndef RAYCASTER_RENDER_HEIGHT
+#define RAYCASTER_RENDER_HEIGHT 480
+#endif
+
+const int RENDER_WIDTH = RAYCASTER_RENDER_WIDTH;
+const int RENDER_HEIGHT = RAYCASTER_RENDER_HEIGHT;
+
+// The smallest the render resolution can be set to
+const int MIN_RENDER_WIDTH = 32;
+const int MIN_RENDER_HEIGHT = 24;
+
+// The resolution frames are actually drawn at, up to RENDER_WIDTH x RENDER_HEIGHT,
+// in the top left of the buffers. Change it with SetRenderSize(); the game scales
+// it up to fill the window.
+extern int renderWidth;
+extern int renderHeight;
+
+const double TWO_PI = 2 * M_PI;
+const double FOV = 90 * (M_PI / 180);
+const int TILE_SIZE = 64;
+
+// Player variables
+extern double playerX;
+extern double playerY;
+extern double playerDir;
+extern double playerRot;
+extern double playerSpeed;
+extern double playerMoveSpeed;
+extern double playerRotSpeed;
+
+// The player is a circle of this radius in tiles, which slides along the walls
+const double PLAYER_RADIUS = 0.25;
+
+extern double viewDist;
+
+// The world moves in fixed steps of this many seconds, however fast frames are drawn
+const double SIMULATION_STEP = 1.0 / 120;
+
+// Packed SDL_PIXELFORMAT_RGBA8888 pixels, row after row, renderWidth apart
+extern Pixel pixels[RENDER_WIDTH * RENDER_HEIGHT];
+
+// Where Draw() renders to, pixels unless SetFramebuffer() says otherwise.
+// The pitch is in pixels, so a locked texture with padded rows can be drawn into directly.
+extern Pixel* framebuffer;
+extern int framebufferPitch;
+
+// How much framebuffer memory a frame touched
+struct FrameStats
+{
+    Uint64 bytesDrawn; // Written by the rasterizer
+    Uint64 bytesCopied; // Copied again to get the frame on screen
+    double wallMs; // Rasterizing wall spans, summed over the render threads
+    double floorMs; // Rasterizing the ceiling and floor, summed over the render threads
+    double spriteMs; // Culling, sorting and drawing sprites
+    int spritesVisible;
+    int spritesCulled; // By the PVS, before any were projected
+    int clustersVisible; // In the player's PVS row, 0 without one
+    int clusterCount;
+    int columnsCast; // By Update(), 0 when the last frame's columns were all reused
+};
+
+extern FrameStats frameStats;
+
+// The wall spans cast this frame, rasterized into pixels by Draw()
+extern DisplayList displayList;
+
+// Where each column's ray ended up, for drawing the rays on the minimap.
+// Every column owns its own entry, so the columns can be cast in parallel.
+struct RayHit
+{
+    bool hit;
+    double x;
+    double y;
+};
+
+extern RayHit rayHits[RENDER_WIDTH];
+
+// Distance to the wall in each column along the view direction, infinite where
+// there is none. Sprites behind it are hidden.
+extern float depthBuffer[RENDER_WIDTH];
+
+// How the columns are cast. The angle caster is the original one, kept around
+// to diff images and benchmarks against.
+enum Caster
+{
+    CASTER_DDA,
+    CASTER_ANGLE
+};
+
+extern Caster caster;
+
+// How the rays are shown on the minimap
+enum RayOverlay
+{
+    RAY_OVERLAY_LINES, // A line per column
+    RAY_OVERLAY_CONE, // The area they sweep, shaded
+    RAY_OVERLAY_OFF
+};
+
+extern RayOverlay rayOverlay;
+
+// Camera plane offset of each column, from -1 on the left edge to 1 on the right.
+// Only changes with the resolution or the field of view, see SetupProjection().
+// The first renderWidth entries are used.
+extern double columnCameraX[RENDER_WIDTH];
+extern double planeLength;
+
+// View direction and camera plane, rebuilt from playerRot every frame
+extern double cameraDirX;
+extern double cameraDirY;
+extern double cameraPlaneX;
+extern double cameraPlaneY;
+
+// With --capture file, Draw() hands every finished frame to this, to be written out
+// on its own thread. The video is RENDER_WIDTH x RENDER_HEIGHT, in Y4M if the file
+// name ends in .y4m and raw RGBA otherwise, with --capture-buffers frames of slack.
+extern FrameCapture frameCapture;
+
+const int CAPTURE_BUFFERS = 8;
+
+// Number of columns handed to a render thread at a time
+const int COLUMN_CHUNK = 16;
+
+extern ThreadPool* renderPool;
+
+// Uses every core and the best ray tracer the CPU supports, until told otherwise
+void InitRaycaster();
+void LoadDefaultMap();
+bool LoadMap(const std::string& fileName);
+bool LoadPvs(const std::string& fileName);
+bool BakePvs(); // With the pvsbake defaults, on the render threads
+void ScatterSprites(int count, unsigned int seed);
+void SpritesChanged();
+
+// Changes one tile, updating everything drawn or built from the map
+void SetMapTile(int x, int y, int tile);
+void ToggleWallInFront();
+
+// Whether the next frame would look any different from the last one drawn: the
+// camera moved, the map or sprites changed, or InvalidateFrame() was called
+bool FrameChanged();
+void InvalidateFrame();
+bool IsSkipping();
+void UpdateDistanceField();
+GridView GetPlayerGrid();
+
+// The camera, as of the last Update()
+ViewBasis GetViewBasis();
+void SetupProjection();
+void SetRenderSize(int width, int height);
+void SetRenderThreads(int threadCount);
+int GetRenderThreads();
+bool ParseRenderOption(int argc, char** argv, int& i);
+void SaveProfile();
+
+// Start and stop the capture asked for on the command line, if any. StopCapture()
+// reports how many frames were written and dropped.
+bool IsCaptureRequested();
+bool StartCapture(int fps);
+void StopCapture();
+
+void Simulate();
+void Update();
+void SetFramebuffer(Pixel* target, int pitch);
+void Draw();
+void CastSurfaceRows();
+void DrawSprites();
+double ColumnAngle(int x);
+void CastColumns(int begin, int end);
+void CastColumnsAngle(int begin, int end);
+void CastRay(double rayAngle, int col);
+void DrawColumn(int col, const GridHit& hit);
+void DrawColumn(int col, const GridHit& hit, double height);
+
+double Rad(double deg);
+void Minimap();
+
+int GetTile(Vector2D position);
+void SetPixel(int x, int y, Pixel color);
+void DrawVerticalLine(int x, int y1, int y2, Pixel color);
+void DrawLine(Vector2D start, Vector2D end, Pixel color);
+void DrawRect(int x, int y, int width, int height, Pixel color);
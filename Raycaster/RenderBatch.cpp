@@ -0,0 +1,189 @@
+#include "RenderBatch.hpp"
+#include <algorithm>
+
+// Columns a thread casts at a time
+static const int CAST_CHUNK = 16;
+
+RenderBatch::RenderBatch(ThreadPool* pool) :
+    m_pool(pool),
+    m_columnsCast(0),
+    m_spritesVisible(0)
+{
+}
+
+void RenderBatch::Render(const Scene& scene, const Camera* cameras, const RenderTarget* targets, int count)
+{
+    if ((int)m_views.size() < count)
+    {
+        m_views.resize(count);
+    }
+
+    const TextureAtlas* wallTextures = scene.GetTexturedWalls() ? &scene.GetTextures() : nullptr;
+    const TextureAtlas* surfaceTextures = scene.GetTexturedFloors() ? &scene.GetTextures() : nullptr;
+
+    // Each view's projection and its ceiling and floor
+    Run(count, 1, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const Camera& camera = cameras[i];
+            View& view = m_views[i];
+
+            int halfWidth = camera.width / 2;
+            double planeLength = tan(camera.fov / 2);
+
+            view.basis.x = camera.x;
+            view.basis.y = camera.y;
+            view.basis.dirX = cos(camera.rot);
+            view.basis.dirY = sin(camera.rot);
+            view.basis.planeX = -view.basis.dirY * planeLength;
+            view.basis.planeY = view.basis.dirX * planeLength;
+            view.basis.planeLength = planeLength;
+            view.basis.viewDist = halfWidth / planeLength;
+            view.grid = scene.GetGridView(camera.x, camera.y);
+
+            view.columnCameraX.resize(camera.width);
+            for (int x = 0; x < camera.width; x++)
+            {
+                view.columnCameraX[x] = (double)(-halfWidth + x) / halfWidth;
+            }
+
+            view.depth.resize(camera.width);
+            if (view.list.width != camera.width || view.list.height != camera.height)
+            {
+                ResizeDisplayList(view.list, camera.width, camera.height);
+                view.list.ceilingColor = 0;
+                view.list.floorColor = 0;
+            }
+
+            SetSurfaceRows(view.list, surfaceTextures, view.basis);
+        }
+    });
+
+    // Every view's columns, a chunk at a time
+    int castChunks = CountPieces(cameras, count, CAST_CHUNK);
+    Run(castChunks, 1, [&](int begin, int end, int)
+    {
+        GridHit hits[CAST_CHUNK];
+        for (int piece = begin; piece < end; piece++)
+        {
+            int i = FindView(piece);
+            View& view = m_views[i];
+            int x0 = (piece - m_pieceStart[i]) * CAST_CHUNK;
+            int x1 = std::min(x0 + CAST_CHUNK, cameras[i].width);
+
+            TraceColumnsDDA(view.grid, view.basis, view.columnCameraX.data(), x0, x1, hits);
+            for (int x = x0; x < x1; x++)
+            {
+                const GridHit& hit = hits[x - x0];
+                double height = hit.hit ? GetStripHeight(view.basis, hit.perpDist) : 0.0;
+                int tile = hit.hit ? scene.GetMap().GetTile(hit.tileX, hit.tileY) : 0;
+
+                view.depth[x] = hit.hit ? (float)hit.perpDist : INFINITY;
+                SetWallColumn(view.list, x, hit, height, tile, wallTextures, view.basis);
+            }
+        }
+    });
+
+    // The sprites in front of each view's walls
+    Run(count, 1, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            View& view = m_views[i];
+            view.spriteCamera.x = view.basis.x;
+            view.spriteCamera.y = view.basis.y;
+            view.spriteCamera.dirX = view.basis.dirX;
+            view.spriteCamera.dirY = view.basis.dirY;
+            view.spriteCamera.planeX = view.basis.planeX;
+            view.spriteCamera.planeY = view.basis.planeY;
+            view.spriteCamera.planeLength = view.basis.planeLength;
+            view.spriteCamera.viewDist = view.basis.viewDist;
+            view.spriteCamera.width = cameras[i].width;
+            view.spriteCamera.height = cameras[i].height;
+            view.spriteCamera.depth = view.depth.data();
+            view.spriteCamera.pvs = nullptr;
+            view.spriteCamera.visibleClusters = nullptr;
+
+            view.sprites.Cull(scene.GetSprites(), scene.GetSpriteGrid(), view.spriteCamera);
+        }
+    });
+
+    // Screen tiles a column of them at a time, then the sprites over them, so a
+    // thread draws its sprites into pixels it has just written
+    int bands = CountPieces(cameras, count, SCREEN_TILE_WIDTH);
+    Run(bands, 1, [&](int begin, int end, int)
+    {
+        RasterStats stats = {};
+        for (int piece = begin; piece < end; piece++)
+        {
+            int i = FindView(piece);
+            const View& view = m_views[i];
+            const RenderTarget& target = targets[i];
+            int x0 = (piece - m_pieceStart[i]) * SCREEN_TILE_WIDTH;
+            int x1 = std::min(x0 + SCREEN_TILE_WIDTH, cameras[i].width);
+
+            for (int y0 = 0; y0 < cameras[i].height; y0 += SCREEN_TILE_HEIGHT)
+            {
+                int y1 = std::min(y0 + SCREEN_TILE_HEIGHT, cameras[i].height);
+                RasterizeTile(view.list, target.pixels, target.pitch, x0, y0, x1, y1, stats);
+            }
+
+            if (view.sprites.GetVisibleCount() > 0)
+            {
+                view.sprites.DrawColumns(scene.GetSpriteTextures(), view.spriteCamera, target.pixels, target.pitch, x0, x1);
+            }
+        }
+    });
+
+    m_columnsCast = 0;
+    m_spritesVisible = 0;
+    for (int i = 0; i < count; i++)
+    {
+        m_columnsCast += cameras[i].width;
+        m_spritesVisible += m_views[i].sprites.GetVisibleCount();
+    }
+}
+
+int RenderBatch::GetColumnsCast() const
+{
+    return m_columnsCast;
+}
+
+int RenderBatch::GetSpritesVisible() const
+{
+    return m_spritesVisible;
+}
+
+void RenderBatch::Run(int count, int chunkSize, const ThreadPool::Job& job)
+{
+    if (m_pool)
+    {
+        m_pool->ParallelFor(count, chunkSize, job);
+    }
+    else
+    {
+        job(0, count, 0);
+    }
+}
+
+int RenderBatch::CountPieces(const Camera* cameras, int count, int pieceWidth)
+{
+    m_pieceStart.resize(count + 1);
+
+    int total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        m_pieceStart[i] = total;
+        total += (cameras[i].width + pieceWidth - 1) / pieceWidth;
+    }
+
+    m_pieceStart[count] = total;
+    return total;
+}
+
+int RenderBatch::FindView(int piece) const
+{
+    // The last view starting at or before the piece
+    return (int)(std::upper_bound(m_pieceStart.begin(), m_pieceStart.end() - 1, piece) - m_pieceStart.begin()) - 1;
+}
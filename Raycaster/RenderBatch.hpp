@@ -0,0 +1,78 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "DisplayList.hpp"
+#include "Pixel.hpp"
+#include "Scene.hpp"
+#include "Sprites.hpp"
+#include "ThreadPool.hpp"
+#include "ViewCast.hpp"
+
+// Where a view is seen from and how big it is drawn, at least 2 x 1 pixels.
+// rot and fov are in radians.
+struct Camera
+{
+    double x;
+    double y;
+    double rot;
+    double fov;
+    int width;
+    int height;
+};
+
+// Somewhere to draw a view: camera width x height packed pixels, pitch pixels
+// apart from one row to the next
+struct RenderTarget
+{
+    Pixel* pixels;
+    int pitch;
+};
+
+// Renders a scene from many cameras in one call, with the cameras' columns spread
+// over the pool's threads together, so a batch of small views keeps every thread
+// as busy as one big one does. Walls are cast with the DDA caster in double, with
+// the selected ray tracer.
+//
+// The per-view buffers are kept between calls, so only the first batch of a
+// given size allocates. One RenderBatch can't be used from two threads at once.
+class RenderBatch
+{
+public:
+    // Renders on the calling thread when pool is null
+    RenderBatch(ThreadPool* pool);
+
+    // Draws cameras[i] into targets[i], for i in [0, count). The scene must have
+    // been prepared since it last changed.
+    void Render(const Scene& scene, const Camera* cameras, const RenderTarget* targets, int count);
+
+    // Columns cast and sprites drawn by the last Render(), over all its cameras
+    int GetColumnsCast() const;
+    int GetSpritesVisible() const;
+
+private:
+    struct View
+    {
+        ViewBasis basis;
+        GridView grid;
+        std::vector<double> columnCameraX;
+        std::vector<float> depth;
+        DisplayList list;
+        SpriteCamera spriteCamera;
+        SpriteRenderer sprites;
+    };
+
+    // Runs job over [0, count) on the pool, or on this thread without one
+    void Run(int count, int chunkSize, const ThreadPool::Job& job);
+
+    // Splits every view into pieces of pieceWidth columns, numbered one view after
+    // another in m_pieceStart. Returns the total.
+    int CountPieces(const Camera* cameras, int count, int pieceWidth);
+    int FindView(int piece) const;
+
+    ThreadPool* m_pool;
+    std::vector<View> m_views;
+    std::vector<int> m_pieceStart; // The first piece of each view, then the total
+    int m_columnsCast;
+    int m_spritesVisible;
+};
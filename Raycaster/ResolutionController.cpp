@@ -0,0 +1,111 @@
+#include "ResolutionController.hpp"
+#include <algorithm>
+#include <math.h>
+
+// Never below this much of the largest resolution on each axis
+static const double MIN_SCALE = 0.25;
+
+// Widths are kept to multiples of this, for the SIMD tracers and the raster tiles
+static const int WIDTH_STEP = 8;
+
+// How far each frame moves the average toward its own time
+static const double AVERAGE_WEIGHT = 0.25;
+
+// Going down aims this far under the budget, and going up waits until frames
+// are this far under it
+static const double DROP_TARGET = 0.9;
+static const double RAISE_BELOW = 0.75;
+
+// Going up, by this much at a time
+static const double RAISE_STEP = 1.05;
+
+// Frames to settle after dropping or raising the resolution
+static const int DROP_COOLDOWN = 4;
+static const int RAISE_COOLDOWN = 30;
+
+ResolutionController::ResolutionController(int maxWidth, int maxHeight, double budgetMs) :
+    m_maxWidth(maxWidth),
+    m_maxHeight(maxHeight),
+    m_budgetMs(budgetMs),
+    m_scale(1),
+    m_width(maxWidth),
+    m_height(maxHeight),
+    m_averageMs(-1),
+    m_cooldown(0)
+{
+}
+
+void ResolutionController::SetBudget(double budgetMs)
+{
+    m_budgetMs = budgetMs;
+}
+
+double ResolutionController::GetBudget() const
+{
+    return m_budgetMs;
+}
+
+bool ResolutionController::Update(double workMs)
+{
+    m_averageMs = (m_averageMs < 0) ? workMs : m_averageMs + (workMs - m_averageMs) * AVERAGE_WEIGHT;
+
+    if (m_cooldown > 0)
+    {
+        m_cooldown--;
+        return false;
+    }
+
+    double scale = m_scale;
+    if (m_averageMs > m_budgetMs)
+    {
+        // Most of the work goes with the pixel count, so the scale on each axis
+        // goes with the square root of the time. One step never drops it below 70%.
+        scale *= std::max(sqrt(m_budgetMs * DROP_TARGET / m_averageMs), 0.7);
+        m_cooldown = DROP_COOLDOWN;
+    }
+    else if (m_averageMs < m_budgetMs * RAISE_BELOW && m_scale < 1)
+    {
+        scale *= RAISE_STEP;
+        m_cooldown = RAISE_COOLDOWN;
+    }
+    else
+    {
+        return false;
+    }
+
+    int oldPixels = m_width * m_height;
+    ApplyScale(scale);
+    if (m_width * m_height == oldPixels)
+    {
+        return false;
+    }
+
+    // Guess at the new resolution's time, rather than waiting for the average to catch up
+    m_averageMs *= (double)(m_width * m_height) / oldPixels;
+
+    return true;
+}
+
+void ResolutionController::ApplyScale(double scale)
+{
+    m_scale = std::min(std::max(scale, MIN_SCALE), 1.0);
+
+    int width = (int)floor(m_maxWidth * m_scale / WIDTH_STEP + 0.5) * WIDTH_STEP;
+    m_width = std::min(std::max(width, WIDTH_STEP), m_maxWidth);
+    m_height = std::min(std::max((int)floor((double)m_maxHeight * m_width / m_maxWidth + 0.5), 1), m_maxHeight);
+}
+
+int ResolutionController::GetWidth() const
+{
+    return m_width;
+}
+
+int ResolutionController::GetHeight() const
+{
+    return m_height;
+}
+
+double ResolutionController::GetScale() const
+{
+    return m_scale;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "PCH.hpp"
+
+// Picks the render resolution for each frame from how long the last few took, so
+// a frame's work fits in a time budget. It drops quickly when frames run long and
+// climbs back slowly once there's room, so it doesn't flicker between two sizes.
+// The aspect ratio of the largest resolution is kept.
+class ResolutionController
+{
+public:
+    ResolutionController(int maxWidth, int maxHeight, double budgetMs);
+
+    void SetBudget(double budgetMs);
+    double GetBudget() const;
+
+    // Takes how long the last frame's work took, at the current resolution.
+    // Returns true if the resolution changed.
+    bool Update(double workMs);
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+    // Of the largest resolution, on each axis
+    double GetScale() const;
+
+private:
+    void ApplyScale(double scale);
+
+    int m_maxWidth;
+    int m_maxHeight;
+    double m_budgetMs;
+    double m_scale;
+    int m_width;
+    int m_height;
+    double m_averageMs; // Smoothed, negative until the first frame
+    int m_cooldown; // Frames to wait before changing again
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "PCH.hpp"
+
+// The number types the ray caster can do its math in, picked at build time with
+// RAYCASTER_SCALAR (see CMakeLists.txt): double, float, or Fixed below.
+//
+// ScalarTraits<T> has what the templated code needs beyond the arithmetic operators.
+
+// 16.16 fixed point. Arithmetic saturates at the ends of the range rather than
+// wrapping around, so a distance too long to hold stays too long.
+class Fixed
+{
+public:
+    static const int FRACTION_BITS = 16;
+
+    Fixed() : m_raw(0) {}
+    Fixed(int value) : m_raw(Saturate((Sint64)value * (1 << FRACTION_BITS))) {}
+    explicit Fixed(double value) : m_raw(FromDouble(value)) {}
+
+    static Fixed FromRaw(Sint32 raw)
+    {
+        Fixed fixed;
+        fixed.m_raw = raw;
+        return fixed;
+    }
+
+    static Fixed Max()
+    {
+        return FromRaw(0x7FFFFFFF);
+    }
+
+    Sint32 GetRaw() const { return m_raw; }
+    double ToDouble() const { return m_raw / (double)(1 << FRACTION_BITS); }
+
+    // Rounds towards minus infinity, like floor()
+    int Floor() const { return m_raw >> FRACTION_BITS; }
+
+    Fixed operator+(Fixed other) const { return FromRaw(Saturate((Sint64)m_raw + other.m_raw)); }
+    Fixed operator-(Fixed other) const { return FromRaw(Saturate((Sint64)m_raw - other.m_raw)); }
+    Fixed operator*(Fixed other) const { return FromRaw(Saturate(((Sint64)m_raw * other.m_raw) >> FRACTION_BITS)); }
+    Fixed operator-() const { return FromRaw(Saturate(-(Sint64)m_raw)); }
+
+    Fixed operator/(Fixed other) const
+    {
+        if (other.m_raw == 0)
+        {
+            return (m_raw < 0) ? -Max() : Max();
+        }
+
+        return FromRaw(Saturate((Sint64)m_raw * (1 << FRACTION_BITS) / other.m_raw));
+    }
+
+    Fixed& operator+=(Fixed other) { return *this = *this + other; }
+    Fixed& operator-=(Fixed other) { return *this = *this - other; }
+
+    bool operator<(Fixed other) const { return m_raw < other.m_raw; }
+    bool operator>(Fixed other) const { return m_raw > other.m_raw; }
+    bool operator<=(Fixed other) const { return m_raw <= other.m_raw; }
+    bool operator>=(Fixed other) const { return m_raw >= other.m_raw; }
+    bool operator==(Fixed other) const { return m_raw == other.m_raw; }
+    bool operator!=(Fixed other) const { return m_raw != other.m_raw; }
+
+private:
+    static Sint32 Saturate(Sint64 value)
+    {
+        return (Sint32)((value > 0x7FFFFFFF) ? 0x7FFFFFFF : (value < -0x7FFFFFFF) ? -0x7FFFFFFF : value);
+    }
+
+    static Sint32 FromDouble(double value)
+    {
+        double raw = floor(value * (1 << FRACTION_BITS) + 0.5);
+        return (raw > 0x7FFFFFFF) ? 0x7FFFFFFF : (raw < -0x7FFFFFFF) ? -0x7FFFFFFF : (Sint32)raw;
+    }
+
+    Sint32 m_raw;
+};
+
+template <typename T>
+struct ScalarTraits;
+
+template <>
+struct ScalarTraits<double>
+{
+    static double FromDouble(double value) { return value; }
+    static double ToDouble(double value) { return value; }
+    static int Floor(double value) { return (int)floor(value); }
+    static double Abs(double value) { return fabs(value); }
+    static double Largest() { return 1e30; }
+    static const char* GetName() { return "double"; }
+};
+
+template <>
+struct ScalarTraits<float>
+{
+    static float FromDouble(double value) { return (float)value; }
+    static double ToDouble(float value) { return value; }
+    static int Floor(float value) { return (int)floorf(value); }
+    static float Abs(float value) { return fabsf(value); }
+    static float Largest() { return 1e30f; }
+    static const char* GetName() { return "float"; }
+};
+
+template <>
+struct ScalarTraits<Fixed>
+{
+    static Fixed FromDouble(double value) { return Fixed(value); }
+    static double ToDouble(Fixed value) { return value.ToDouble(); }
+    static int Floor(Fixed value) { return value.Floor(); }
+    static Fixed Abs(Fixed value) { return (value < Fixed()) ? -value : value; }
+    static Fixed Largest() { return Fixed::Max(); }
+    static const char* GetName() { return "fixed"; }
+};
+
+#if defined(RAYCASTER_SCALAR_FIXED)
+typedef Fixed Real;
+#elif defined(RAYCASTER_SCALAR_FLOAT)
+typedef float Real;
+#else
+typedef double Real;
+#endif
@@ -0,0 +1,187 @@
+#include "Scene.hpp"
+
+Scene::Scene() :
+    m_distanceFieldDirty(true),
+    m_skipMode(SKIP_AUTO),
+    m_texturedWalls(true),
+    m_texturedFloors(true),
+    m_spritesDirty(true)
+{
+    m_textures.Generate();
+    m_spriteTextures.GenerateSprites();
+}
+
+bool Scene::LoadMap(const std::string& fileName)
+{
+    if (!m_map.Load(fileName))
+    {
+        return false;
+    }
+
+    MapChanged();
+    return true;
+}
+
+bool Scene::CreateMap(int width, int height)
+{
+    if (!m_map.Create(width, height, 1, 0))
+    {
+        return false;
+    }
+
+    MapChanged();
+    return true;
+}
+
+bool Scene::CopyMap(const Map& source)
+{
+    if (!m_map.Create(source.GetWidth(), source.GetHeight(), source.GetTileSize(), source.GetChunkShift()))
+    {
+        return false;
+    }
+
+    for (int y = 0; y < source.GetHeight(); y++)
+    {
+        for (int x = 0; x < source.GetWidth(); x++)
+        {
+            m_map.SetTile(x, y, source.GetTile(x, y));
+        }
+    }
+
+    MapChanged();
+    return true;
+}
+
+void Scene::SetTile(int x, int y, int tile)
+{
+    if (!m_map.IsInside(x, y))
+    {
+        return;
+    }
+
+    m_map.SetTile(x, y, tile);
+    if (m_distanceField.IsBuilt() && !m_distanceFieldDirty)
+    {
+        m_distanceField.UpdateTile(m_map, x, y);
+    }
+}
+
+const Map& Scene::GetMap() const
+{
+    return m_map;
+}
+
+std::vector<Sprite>& Scene::GetSprites()
+{
+    return m_sprites;
+}
+
+const std::vector<Sprite>& Scene::GetSprites() const
+{
+    return m_sprites;
+}
+
+void Scene::SpritesChanged()
+{
+    m_spritesDirty = true;
+}
+
+TextureAtlas& Scene::GetTextures()
+{
+    return m_textures;
+}
+
+const TextureAtlas& Scene::GetTextures() const
+{
+    return m_textures;
+}
+
+TextureAtlas& Scene::GetSpriteTextures()
+{
+    return m_spriteTextures;
+}
+
+const TextureAtlas& Scene::GetSpriteTextures() const
+{
+    return m_spriteTextures;
+}
+
+void Scene::SetTexturedWalls(bool textured)
+{
+    m_texturedWalls = textured;
+}
+
+void Scene::SetTexturedFloors(bool textured)
+{
+    m_texturedFloors = textured;
+}
+
+bool Scene::GetTexturedWalls() const
+{
+    return m_texturedWalls;
+}
+
+bool Scene::GetTexturedFloors() const
+{
+    return m_texturedFloors;
+}
+
+void Scene::SetSkipMode(SkipMode mode)
+{
+    m_skipMode = mode;
+}
+
+bool Scene::IsSkipping() const
+{
+    if (m_skipMode == SKIP_AUTO)
+    {
+        return (Uint64)m_map.GetWidth() * m_map.GetHeight() >= SKIP_AUTO_MIN_TILES;
+    }
+
+    return m_skipMode == SKIP_ON;
+}
+
+void Scene::Prepare()
+{
+    if (!IsSkipping())
+    {
+        m_distanceField.Clear();
+        m_distanceFieldDirty = true;
+    }
+    else if (m_distanceFieldDirty)
+    {
+        m_distanceField.Build(m_map);
+        m_distanceFieldDirty = false;
+    }
+
+    if (m_spritesDirty)
+    {
+        ClampSpriteTextures(m_sprites, m_spriteTextures.GetTextureCount());
+        m_spriteGrid.Build(m_sprites, m_map.GetWidth(), m_map.GetHeight());
+        m_spritesDirty = false;
+    }
+}
+
+GridView Scene::GetGridView(double originX, double originY) const
+{
+    GridView grid = m_map.GetGridView(originX, originY);
+    if (IsSkipping() && !m_distanceFieldDirty)
+    {
+        grid.space = m_distanceField.GetCells();
+    }
+
+    return grid;
+}
+
+const SpriteGrid& Scene::GetSpriteGrid() const
+{
+    return m_spriteGrid;
+}
+
+void Scene::MapChanged()
+{
+    m_distanceFieldDirty = true;
+
+    // The sprites are bucketed by the map's size
+    m_spritesDirty = true;
+}
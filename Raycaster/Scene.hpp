@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <string>
+#include <vector>
+#include "Map.hpp"
+#include "DistanceField.hpp"
+#include "TextureAtlas.hpp"
+#include "Sprites.hpp"
+
+// A world to render, with no view of its own: the map and its distance field, the
+// wall and sprite textures, and the sprites. Unlike the game's globals there can be
+// any number of these, and a RenderBatch draws one from many cameras at once.
+//
+// A scene must not be changed while it's being rendered. Call Prepare() after
+// changing it and before rendering it again.
+class Scene
+{
+public:
+    // An empty map, with the built-in wall and sprite textures
+    Scene();
+
+    bool LoadMap(const std::string& fileName);
+    bool CreateMap(int width, int height);
+
+    // Copies the tiles of another map, in its layout
+    bool CopyMap(const Map& source);
+
+    // Edits a tile, keeping the distance field up to date
+    void SetTile(int x, int y, int tile);
+
+    const Map& GetMap() const;
+
+    // Call SpritesChanged() after changing the list or loading sprite textures.
+    // Textures past the atlas are clamped to it by the next Prepare().
+    std::vector<Sprite>& GetSprites();
+    const std::vector<Sprite>& GetSprites() const;
+    void SpritesChanged();
+
+    TextureAtlas& GetTextures();
+    const TextureAtlas& GetTextures() const;
+    TextureAtlas& GetSpriteTextures();
+    const TextureAtlas& GetSpriteTextures() const;
+
+    // With either off, the walls or the ceiling and floor are drawn flat
+    void SetTexturedWalls(bool textured);
+    void SetTexturedFloors(bool textured);
+    bool GetTexturedWalls() const;
+    bool GetTexturedFloors() const;
+
+    void SetSkipMode(SkipMode mode);
+    bool IsSkipping() const;
+
+    // Builds whatever the changes since the last call left out of date
+    void Prepare();
+
+    // For the ray tracers, with the distance field when it's being used
+    GridView GetGridView(double originX, double originY) const;
+    const SpriteGrid& GetSpriteGrid() const;
+
+private:
+    void MapChanged();
+
+    Map m_map;
+    DistanceField m_distanceField;
+    bool m_distanceFieldDirty;
+    SkipMode m_skipMode;
+
+    TextureAtlas m_textures;
+    TextureAtlas m_spriteTextures;
+    bool m_texturedWalls;
+    bool m_texturedFloors;
+
+    std::vector<Sprite> m_sprites;
+    SpriteGrid m_spriteGrid;
+    bool m_spritesDirty;
+};
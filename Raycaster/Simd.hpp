@@ -0,0 +1,16 @@
+#pragma once
+
+// Which vector instruction sets the code can be compiled with.
+// Also included by code built with AVX2 code generation enabled, so it must
+// not pull in anything with inline functions.
+
+// SSE2 is part of every x86-64 target. AVX2 is compiled in when the build turns
+// it on for RayTraceAVX2.cpp (see CMakeLists.txt); MSVC can always emit it.
+// Either way, AVX2 code is only used if the CPU running the game supports it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYCASTER_HAVE_SSE2
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(RAYCASTER_HAVE_AVX2)
+#define RAYCASTER_HAVE_AVX2
+#endif
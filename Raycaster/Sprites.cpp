@@ -0,0 +1,433 @@
+#include "Sprites.hpp"
+#include <algorithm>
+#include <string.h>
+#include "Pvs.hpp"
+
+// Sprites are one unit wide, so they reach this far either side of where they stand
+static const double SPRITE_RADIUS = 0.5;
+
+// Anything nearer the camera than this would cover the whole screen
+static const double SPRITE_NEAR = 0.05;
+
+void ClampSpriteTextures(std::vector<Sprite>& sprites, int textureCount)
+{
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        sprites[i].texture = std::min(std::max(sprites[i].texture, 0), textureCount - 1);
+    }
+}
+
+SpriteGrid::SpriteGrid() :
+    m_cellsX(0),
+    m_cellsY(0)
+{
+}
+
+void SpriteGrid::Build(const std::vector<Sprite>& sprites, int mapWidth, int mapHeight)
+{
+    int cellSize = 1 << SPRITE_CELL_SHIFT;
+    m_cellsX = std::max((mapWidth + cellSize - 1) >> SPRITE_CELL_SHIFT, 1);
+    m_cellsY = std::max((mapHeight + cellSize - 1) >> SPRITE_CELL_SHIFT, 1);
+
+    // Counting sort: count the sprites in each cell, turn the counts into where each
+    // cell starts, then drop the sprites in
+    m_cellStart.assign((size_t)m_cellsX * m_cellsY + 1, 0);
+    std::vector<int> cells(sprites.size());
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        int cellX = std::min(std::max((int)floor(sprites[i].x) >> SPRITE_CELL_SHIFT, 0), m_cellsX - 1);
+        int cellY = std::min(std::max((int)floor(sprites[i].y) >> SPRITE_CELL_SHIFT, 0), m_cellsY - 1);
+        cells[i] = cellY * m_cellsX + cellX;
+        m_cellStart[cells[i] + 1]++;
+    }
+
+    for (size_t cell = 1; cell < m_cellStart.size(); cell++)
+    {
+        m_cellStart[cell] += m_cellStart[cell - 1];
+    }
+
+    std::vector<int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_indices.resize(sprites.size());
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        m_indices[next[cells[i]]++] = (int)i;
+    }
+}
+
+int SpriteGrid::GetCellsX() const
+{
+    return m_cellsX;
+}
+
+int SpriteGrid::GetCellsY() const
+{
+    return m_cellsY;
+}
+
+const int* SpriteGrid::GetCellBegin(int cellX, int cellY) const
+{
+    return m_indices.data() + m_cellStart[(size_t)cellY * m_cellsX + cellX];
+}
+
+const int* SpriteGrid::GetCellEnd(int cellX, int cellY) const
+{
+    return m_indices.data() + m_cellStart[(size_t)cellY * m_cellsX + cellX + 1];
+}
+
+SpriteRenderer::SpriteRenderer() :
+    m_cellsFound(false),
+    m_cellsVisited(0),
+    m_spritesCulled(0)
+{
+}
+
+static int GetCell(double position, int cells)
+{
+    double cell = floor(position / (1 << SPRITE_CELL_SHIFT));
+    return (int)std::min(std::max(cell, 0.0), (double)(cells - 1));
+}
+
+// Whether any point of the box is on the positive side of a*x + b*y + c
+static bool BoxTouches(double minX, double minY, double maxX, double maxY, double a, double b, double c)
+{
+    double x = (a > 0) ? maxX : minX;
+    double y = (b > 0) ? maxY : minY;
+    return a * x + b * y + c >= 0;
+}
+
+// Edges of the view for ViewTouchesCell()
+static const int VIEW_EDGES = 4;
+static const int FAR_EDGE = 1;
+
+// The view is a triangle from the camera out to farDist. Its edges as lines
+// a*x + b*y + c = 0, with the inside positive, pushed out by a sprite's radius.
+static void GetViewEdges(const SpriteCamera& camera, double farDist, double edges[VIEW_EDGES][3])
+{
+    // Unit vector across the screen, left to right
+    double perpX = camera.planeX / camera.planeLength;
+    double perpY = camera.planeY / camera.planeLength;
+
+    double lines[VIEW_EDGES][2] =
+    {
+        { camera.dirX, camera.dirY }, // In front of the camera
+        { -camera.dirX, -camera.dirY }, // Nearer than farDist
+        { camera.planeLength * camera.dirX - perpX, camera.planeLength * camera.dirY - perpY }, // Left of the right edge
+        { camera.planeLength * camera.dirX + perpX, camera.planeLength * camera.dirY + perpY } // Right of the left edge
+    };
+
+    for (int i = 0; i < VIEW_EDGES; i++)
+    {
+        double a = lines[i][0];
+        double b = lines[i][1];
+        edges[i][0] = a;
+        edges[i][1] = b;
+        edges[i][2] = -(a * camera.x + b * camera.y) + SPRITE_RADIUS * sqrt(a * a + b * b);
+    }
+    edges[FAR_EDGE][2] += farDist;
+}
+
+// Whether the view reaches into the cell, out to farDist or without end
+static bool ViewTouchesCell(const SpriteGrid& grid, int cellX, int cellY, const double edges[VIEW_EDGES][3], bool useFar)
+{
+    // The edge cells reach out forever
+    double cellSize = 1 << SPRITE_CELL_SHIFT;
+    double edgeMax = 1e30;
+
+    double boxMinX = (cellX == 0) ? -edgeMax : cellX * cellSize;
+    double boxMinY = (cellY == 0) ? -edgeMax : cellY * cellSize;
+    double boxMaxX = (cellX == grid.GetCellsX() - 1) ? edgeMax : (cellX + 1) * cellSize;
+    double boxMaxY = (cellY == grid.GetCellsY() - 1) ? edgeMax : (cellY + 1) * cellSize;
+
+    for (int i = 0; i < VIEW_EDGES; i++)
+    {
+        if ((useFar || i != FAR_EDGE) && !BoxTouches(boxMinX, boxMinY, boxMaxX, boxMaxY, edges[i][0], edges[i][1], edges[i][2]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SpriteRenderer::FindCells(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera)
+{
+    m_cells.clear();
+    m_cellsFound = false;
+    m_spritesCulled = 0;
+
+    if (!camera.pvs || !camera.visibleClusters || sprites.empty())
+    {
+        return;
+    }
+
+    double edges[VIEW_EDGES][3];
+    GetViewEdges(camera, 0, edges);
+
+    // Only the cells of the clusters in the set, which cover a cell each or more
+    const Pvs& pvs = *camera.pvs;
+    int cellsPerCluster = 1 << (pvs.GetClusterShift() - SPRITE_CELL_SHIFT);
+    int spritesKept = 0;
+
+    for (int clusterY = 0; clusterY < pvs.GetClustersY(); clusterY++)
+    {
+        for (int clusterX = 0; clusterX < pvs.GetClustersX(); clusterX++)
+        {
+            if (!pvs.IsClusterVisible(camera.visibleClusters, clusterX, clusterY))
+            {
+                continue;
+            }
+
+            int cellMaxY = std::min((clusterY + 1) * cellsPerCluster, grid.GetCellsY());
+            int cellMaxX = std::min((clusterX + 1) * cellsPerCluster, grid.GetCellsX());
+            for (int cellY = clusterY * cellsPerCluster; cellY < cellMaxY; cellY++)
+            {
+                for (int cellX = clusterX * cellsPerCluster; cellX < cellMaxX; cellX++)
+                {
+                    spritesKept += (int)(grid.GetCellEnd(cellX, cellY) - grid.GetCellBegin(cellX, cellY));
+                    if (ViewTouchesCell(grid, cellX, cellY, edges, false))
+                    {
+                        m_cells.push_back(cellY * grid.GetCellsX() + cellX);
+                    }
+                }
+            }
+        }
+    }
+
+    m_cellsFound = true;
+    m_spritesCulled = (int)sprites.size() - spritesKept;
+}
+
+void SpriteRenderer::Cull(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera)
+{
+    m_visible.clear();
+    m_cellsVisited = 0;
+
+    // The cells are only good for the camera they were found for
+    bool cellsFound = m_cellsFound;
+    m_cellsFound = false;
+    if (!cellsFound)
+    {
+        m_spritesCulled = 0;
+    }
+
+    if (sprites.empty())
+    {
+        return;
+    }
+
+    // Nothing past the farthest wall can be seen. Columns that see no wall at all
+    // can see across the whole grid.
+    double gridSize = (double)(grid.GetCellsX() + grid.GetCellsY()) * (1 << SPRITE_CELL_SHIFT);
+    double farDist = 0;
+    for (int x = 0; x < camera.width; x++)
+    {
+        farDist = std::max(farDist, std::min((double)camera.depth[x], gridSize));
+    }
+    farDist += SPRITE_RADIUS;
+
+    double edges[VIEW_EDGES][3];
+    GetViewEdges(camera, farDist, edges);
+
+    if (cellsFound)
+    {
+        for (size_t i = 0; i < m_cells.size(); i++)
+        {
+            int cellX = m_cells[i] % grid.GetCellsX();
+            int cellY = m_cells[i] / grid.GetCellsX();
+            if (ViewTouchesCell(grid, cellX, cellY, edges, true))
+            {
+                CullCell(sprites, grid, camera, cellX, cellY, farDist);
+            }
+        }
+
+        SortByDepth();
+        return;
+    }
+
+    // Only the cells under the triangle's bounding box,
+    double cornersX[3] = { camera.x, camera.x + farDist * (camera.dirX - camera.planeX), camera.x + farDist * (camera.dirX + camera.planeX) };
+    double cornersY[3] = { camera.y, camera.y + farDist * (camera.dirY - camera.planeY), camera.y + farDist * (camera.dirY + camera.planeY) };
+    double minX = std::min(std::min(cornersX[0], cornersX[1]), cornersX[2]) - SPRITE_RADIUS;
+    double maxX = std::max(std::max(cornersX[0], cornersX[1]), cornersX[2]) + SPRITE_RADIUS;
+    double minY = std::min(std::min(cornersY[0], cornersY[1]), cornersY[2]) - SPRITE_RADIUS;
+    double maxY = std::max(std::max(cornersY[0], cornersY[1]), cornersY[2]) + SPRITE_RADIUS;
+
+    // clamped to the grid, since the edge cells hold everything past them
+    int cellMinX = GetCell(minX, grid.GetCellsX());
+    int cellMinY = GetCell(minY, grid.GetCellsY());
+    int cellMaxX = GetCell(maxX, grid.GetCellsX());
+    int cellMaxY = GetCell(maxY, grid.GetCellsY());
+
+    for (int cellY = cellMinY; cellY <= cellMaxY; cellY++)
+    {
+        for (int cellX = cellMinX; cellX <= cellMaxX; cellX++)
+        {
+            if (ViewTouchesCell(grid, cellX, cellY, edges, true))
+            {
+                CullCell(sprites, grid, camera, cellX, cellY, farDist);
+            }
+        }
+    }
+
+    SortByDepth();
+}
+
+void SpriteRenderer::CullCell(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera, int cellX, int cellY, double farDist)
+{
+    m_cellsVisited++;
+
+    // Unit vector across the screen, left to right
+    double perpX = camera.planeX / camera.planeLength;
+    double perpY = camera.planeY / camera.planeLength;
+
+    const int* end = grid.GetCellEnd(cellX, cellY);
+    for (const int* index = grid.GetCellBegin(cellX, cellY); index != end; index++)
+    {
+        const Sprite& sprite = sprites[*index];
+        double relX = sprite.x - camera.x;
+        double relY = sprite.y - camera.y;
+
+        double depth = relX * camera.dirX + relY * camera.dirY;
+        if (depth < SPRITE_NEAR || depth > farDist)
+        {
+            continue;
+        }
+
+        // Same projection as the walls: the column whose ray passes through the sprite
+        double lateral = relX * perpX + relY * perpY;
+        double screenX = camera.width / 2 * (1 + lateral / (camera.planeLength * depth));
+        int size = (int)round(camera.viewDist / depth);
+        int left = (int)round(screenX - size / 2.0);
+        if (size <= 0 || left >= camera.width || left + size <= 0)
+        {
+            continue;
+        }
+
+        VisibleSprite visible;
+        visible.depth = (float)depth;
+        visible.texture = sprite.texture;
+        visible.left = left;
+        visible.top = (int)round(camera.height / 2 - size / 2.0);
+        visible.size = size;
+        m_visible.push_back(visible);
+    }
+}
+
+// Radix sort, a byte at a time from the lowest. Positive floats order the same as
+// their bits do, and flipping the bits puts the far sprites first.
+void SpriteRenderer::SortByDepth()
+{
+    size_t count = m_visible.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    m_keys.resize(count);
+    m_sortedKeys.resize(count);
+    m_sorted.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Uint32 bits;
+        memcpy(&bits, &m_visible[i].depth, sizeof(bits));
+        m_keys[i] = ~bits;
+    }
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        size_t offsets[257] = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            offsets[((m_keys[i] >> shift) & 0xFF) + 1]++;
+        }
+
+        // Every key has the same byte here, nothing would move
+        if (offsets[((m_keys[0] >> shift) & 0xFF) + 1] == count)
+        {
+            continue;
+        }
+
+        for (int digit = 1; digit < 257; digit++)
+        {
+            offsets[digit] += offsets[digit - 1];
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t to = offsets[(m_keys[i] >> shift) & 0xFF]++;
+            m_sortedKeys[to] = m_keys[i];
+            m_sorted[to] = m_visible[i];
+        }
+
+        m_keys.swap(m_sortedKeys);
+        m_visible.swap(m_sorted);
+    }
+}
+
+void SpriteRenderer::DrawColumns(const TextureAtlas& textures, const SpriteCamera& camera, Uint32* target, int pitch, int begin, int end) const
+{
+    for (size_t i = 0; i < m_visible.size(); i++)
+    {
+        const VisibleSprite& sprite = m_visible[i];
+        int x0 = std::max(sprite.left, begin);
+        int x1 = std::min(sprite.left + sprite.size, end);
+        if (x0 >= x1)
+        {
+            continue;
+        }
+
+        // Same mip level choice as a wall strip of this height
+        int level = 0;
+        while (level < TEX_LEVELS - 1 && (TEX_HEIGHT >> level) > sprite.size)
+        {
+            level++;
+        }
+
+        int levelWidth = TEX_WIDTH >> level;
+        Uint32 texStep = (Uint32)(((Uint64)(TEX_HEIGHT >> level) << 16) / sprite.size);
+        int y0 = std::max(sprite.top, 0);
+        int y1 = std::min(sprite.top + sprite.size, camera.height);
+        Uint32 texStart = (Uint32)(y0 - sprite.top) * texStep;
+
+        for (int x = x0; x < x1; x++)
+        {
+            // A wall in front of the sprite in this column
+            if (sprite.depth >= camera.depth[x])
+            {
+                continue;
+            }
+
+            int u = (int)((Sint64)(x - sprite.left) * levelWidth / sprite.size);
+            const Uint32* texels = textures.GetColumn(sprite.texture, level, false, u);
+
+            Uint32* pixel = target + (size_t)y0 * pitch + x;
+            Uint32 v = texStart;
+            for (int y = y0; y < y1; y++, pixel += pitch)
+            {
+                // Transparent texels have no alpha
+                Uint32 texel = texels[v >> 16];
+                if (texel & 0xFF)
+                {
+                    *pixel = texel;
+                }
+                v += texStep;
+            }
+        }
+    }
+}
+
+int SpriteRenderer::GetVisibleCount() const
+{
+    return (int)m_visible.size();
+}
+
+int SpriteRenderer::GetCellsVisited() const
+{
+    return m_cellsVisited;
+}
+
+int SpriteRenderer::GetSpritesCulled() const
+{
+    return m_spritesCulled;
+}
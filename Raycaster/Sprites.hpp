@@ -0,0 +1,117 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <vector>
+#include "TextureAtlas.hpp"
+
+class Pvs;
+
+// Billboards: textures that always face the camera, one tile wide and one tall,
+// standing on the floor.
+
+struct Sprite
+{
+    double x;
+    double y;
+    int texture;
+};
+
+// Keeps every sprite's texture inside an atlas of textureCount: anything past the
+// end gets the last texture, as wall tiles do, and anything below 0 the first
+void ClampSpriteTextures(std::vector<Sprite>& sprites, int textureCount);
+
+// Grid cells are (1 << SPRITE_CELL_SHIFT) tiles on a side
+const int SPRITE_CELL_SHIFT = 3;
+
+// The sprites bucketed by the cell of the map they stand in, so only the cells in
+// view need looking at. Sprites outside the map go in the nearest edge cell.
+class SpriteGrid
+{
+public:
+    SpriteGrid();
+
+    void Build(const std::vector<Sprite>& sprites, int mapWidth, int mapHeight);
+
+    int GetCellsX() const;
+    int GetCellsY() const;
+
+    // Indices into the sprites the grid was built from, [begin, end) for the cell
+    const int* GetCellBegin(int cellX, int cellY) const;
+    const int* GetCellEnd(int cellX, int cellY) const;
+
+private:
+    int m_cellsX;
+    int m_cellsY;
+    std::vector<int> m_cellStart; // One past the end is the total count
+    std::vector<int> m_indices;
+};
+
+// What the sprites are seen from. depth is the distance to the wall in each
+// column, along the view direction.
+struct SpriteCamera
+{
+    double x;
+    double y;
+    double dirX; // Unit length
+    double dirY;
+    double planeX; // Perpendicular to dir, planeLength long
+    double planeY;
+    double planeLength;
+    double viewDist;
+    int width;
+    int height;
+    const float* depth;
+
+    // Optional: the PVS row for where the camera is, see Pvs.hpp. Cells outside
+    // it are skipped without looking at their sprites.
+    const Pvs* pvs;
+    const byte* visibleClusters;
+};
+
+// A sprite in front of the camera, projected to the screen
+struct VisibleSprite
+{
+    float depth;
+    int texture;
+    int left; // Leftmost column
+    int top; // Top row
+    int size; // Width and height in pixels
+};
+
+class SpriteRenderer
+{
+public:
+    SpriteRenderer();
+
+    // Before the walls are cast: picks out the cells in the view that the camera's
+    // PVS doesn't rule out, for the next Cull() to look in. Without a PVS there's
+    // nothing to do, and Cull() looks at every cell in the view.
+    void FindCells(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera);
+
+    // Finds the sprites in the view that aren't behind the farthest wall, and sorts
+    // them far to near
+    void Cull(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera);
+
+    // Draws the visible sprites in columns [begin, end), skipping the columns where
+    // a wall is in front. Threads can draw separate column ranges at the same time.
+    void DrawColumns(const TextureAtlas& textures, const SpriteCamera& camera, Uint32* target, int pitch, int begin, int end) const;
+
+    int GetVisibleCount() const;
+    int GetCellsVisited() const;
+
+    // Sprites in clusters the PVS ruled out, from FindCells()
+    int GetSpritesCulled() const;
+
+private:
+    void CullCell(const std::vector<Sprite>& sprites, const SpriteGrid& grid, const SpriteCamera& camera, int cellX, int cellY, double farDist);
+    void SortByDepth();
+
+    std::vector<VisibleSprite> m_visible;
+    std::vector<VisibleSprite> m_sorted;
+    std::vector<Uint32> m_keys;
+    std::vector<Uint32> m_sortedKeys;
+    std::vector<int> m_cells; // From FindCells(), cellY * cellsX + cellX
+    bool m_cellsFound;
+    int m_cellsVisited;
+    int m_spritesCulled;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// A fixed size ring for passing items from one thread to one other without a lock.
+// Only the producer calls Push() and only the consumer calls Pop(). Neither blocks:
+// they return false when the ring is full or empty.
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue(int capacity) :
+        m_items(capacity + 1), // One slot is always left empty, to tell full from empty
+        m_head(0),
+        m_tail(0)
+    {
+    }
+
+    bool Push(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % m_items.size();
+        if (next == m_head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        m_items[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = m_items[head];
+        m_head.store((head + 1) % m_items.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> m_items;
+
+    // On separate cache lines, so the two threads don't keep taking the line from each other
+    alignas(64) std::atomic<size_t> m_head; // Next to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail; // Next to push to, written by the producer
+};
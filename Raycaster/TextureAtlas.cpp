@@ -0,0 +1,355 @@
+#include "TextureAtlas.hpp"
+
+// Texels in one texture's chain of levels: 64 * 64 + 32 * 32 + ... + 1 * 1
+static const size_t TEXTURE_STRIDE = (TEX_WIDTH * TEX_HEIGHT * 4 - 1) / 3;
+
+// Built-in textures for wall tiles 1 to 4, one for anything else, then the floor and ceiling
+static const int GENERATED_TEXTURES = 7;
+
+// Built-in sprites: a barrel, a pillar and a lamp
+static const int GENERATED_SPRITES = 3;
+
+static Uint32 Pack(int red, int green, int blue)
+{
+    red = (red < 0) ? 0 : (red > 255) ? 255 : red;
+    green = (green < 0) ? 0 : (green > 255) ? 255 : green;
+    blue = (blue < 0) ? 0 : (blue > 255) ? 255 : blue;
+
+    return ((Uint32)red << 24) | ((Uint32)green << 16) | ((Uint32)blue << 8) | 0xFF;
+}
+
+// Same for every run, so frames can still be compared by checksum
+static int Noise(int x, int y, int seed)
+{
+    Uint32 hash = (Uint32)x * 374761393u + (Uint32)y * 668265263u + (Uint32)seed * 2246822519u;
+    hash = (hash ^ (hash >> 13)) * 1274126177u;
+    return (int)((hash ^ (hash >> 16)) & 31) - 16;
+}
+
+static Uint32 GenerateTexel(int texture, int x, int y)
+{
+    int noise = Noise(x, y, texture);
+
+    switch (texture)
+    {
+    case 0:
+    {
+        // Red brick, every other row shifted by half a brick
+        int row = y / 8;
+        int brickX = (x + ((row & 1) ? 8 : 0)) % 16;
+        if (y % 8 == 7 || brickX == 15)
+        {
+            return Pack(150 + noise, 150 + noise, 140 + noise);
+        }
+
+        return Pack(194 + noise, 59 + noise / 2, 34 + noise / 2);
+    }
+    case 1:
+    {
+        // Green stone blocks
+        if (x % 32 == 0 || y % 16 == 0)
+        {
+            return Pack(40 + noise, 70 + noise, 40 + noise);
+        }
+
+        return Pack(119 + noise, 190 + noise, 119 + noise);
+    }
+    case 2:
+    {
+        // Blue metal panels with rivets in the corners
+        int panelX = x % 32;
+        int panelY = y % 32;
+        bool edge = (panelX == 0 || panelY == 0 || panelX == 31 || panelY == 31);
+        bool rivet = ((panelX == 3 || panelX == 28) && (panelY == 3 || panelY == 28));
+        if (edge || rivet)
+        {
+            return Pack(60, 80, 110);
+        }
+
+        return Pack(119 + noise / 4, 158 + noise / 4, 203 + noise / 4);
+    }
+    case 3:
+    {
+        // White tiles
+        if (x % 16 == 0 || y % 16 == 0)
+        {
+            return Pack(170, 170, 170);
+        }
+
+        return Pack(240 + noise / 2, 240 + noise / 2, 240 + noise / 2);
+    }
+    case 5:
+    {
+        // Gray flagstones
+        if (x % 32 == 0 || y % 32 == 0)
+        {
+            return Pack(50, 50, 55);
+        }
+
+        return Pack(96 + noise, 96 + noise, 100 + noise);
+    }
+    case 6:
+    {
+        // Dark wooden planks
+        if (x % 16 == 0)
+        {
+            return Pack(30, 20, 12);
+        }
+
+        return Pack(92 + noise / 2, 64 + noise / 2, 40 + noise / 4);
+    }
+    default:
+    {
+        // Magenta and black checks, for tiles without a texture
+        bool check = ((x / 8) + (y / 8)) & 1;
+        return check ? Pack(255, 0, 255) : Pack(0, 0, 0);
+    }
+    }
+}
+
+// Sprites are transparent (all zero) around the outside
+static Uint32 GenerateSpriteTexel(int texture, int x, int y)
+{
+    int noise = Noise(x, y, texture + GENERATED_TEXTURES);
+    int fromCenter = abs(x * 2 + 1 - TEX_WIDTH);
+
+    switch (texture)
+    {
+    case 0:
+    {
+        // Barrel, standing on the floor in the bottom half
+        if (y < 28 || fromCenter > 36)
+        {
+            return 0;
+        }
+
+        int shade = 40 - fromCenter;
+        if (y == 28 || y == 40 || y == 52 || y == 63)
+        {
+            return Pack(60 + shade, 60 + shade, 64 + shade);
+        }
+
+        return Pack(110 + shade + noise / 2, 70 + shade + noise / 2, 30 + shade / 2);
+    }
+    case 1:
+    {
+        // Stone pillar, top to bottom
+        int width = (y < 6 || y >= 58) ? 40 : 28;
+        if (fromCenter > width)
+        {
+            return 0;
+        }
+
+        int shade = (width - fromCenter) * 2;
+        return Pack(120 + shade + noise, 120 + shade + noise, 110 + shade + noise);
+    }
+    default:
+    {
+        // Lamp: a glowing ball on a thin chain from the ceiling
+        int dx = x * 2 + 1 - TEX_WIDTH;
+        int dy = y * 2 + 1 - 24;
+        if (dx * dx + dy * dy <= 20 * 20)
+        {
+            int glow = 255 - (dx * dx + dy * dy) / 8;
+            return Pack(glow, glow - 20, glow / 2);
+        }
+
+        if (y < 3 && fromCenter <= 2)
+        {
+            return Pack(40, 40, 40);
+        }
+
+        return 0;
+    }
+    }
+}
+
+// The average of four texels. Transparent ones are left out, so sprite edges
+// don't darken as they shrink, and the result is only opaque if most of them are.
+static Uint32 Average(Uint32 a, Uint32 b, Uint32 c, Uint32 d)
+{
+    Uint32 texels[4] = { a, b, c, d };
+    Uint32 sums[3] = {};
+    Uint32 opaque = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if ((texels[i] & 0xFF) >= 0x80)
+        {
+            sums[0] += texels[i] >> 24;
+            sums[1] += (texels[i] >> 16) & 0xFF;
+            sums[2] += (texels[i] >> 8) & 0xFF;
+            opaque++;
+        }
+    }
+
+    if (opaque < 2)
+    {
+        return 0;
+    }
+
+    return (((sums[0] + opaque / 2) / opaque) << 24) | (((sums[1] + opaque / 2) / opaque) << 16) | (((sums[2] + opaque / 2) / opaque) << 8) | 0xFF;
+}
+
+TextureAtlas::TextureAtlas() :
+    m_count(0)
+{
+}
+
+void TextureAtlas::Generate()
+{
+    Generate(GENERATED_TEXTURES, GenerateTexel);
+}
+
+void TextureAtlas::GenerateSprites()
+{
+    Generate(GENERATED_SPRITES, GenerateSpriteTexel);
+}
+
+void TextureAtlas::Generate(int count, Uint32 (*generateTexel)(int texture, int x, int y))
+{
+    m_count = count;
+    m_texels.assign(TEXTURE_STRIDE * 2 * m_count, 0);
+
+    for (int texture = 0; texture < m_count; texture++)
+    {
+        Uint32* texels = &m_texels[GetLevelOffset(texture, 0, false)];
+        for (int x = 0; x < TEX_WIDTH; x++)
+        {
+            for (int y = 0; y < TEX_HEIGHT; y++)
+            {
+                texels[x * TEX_HEIGHT + y] = generateTexel(texture, x, y);
+            }
+        }
+    }
+
+    BuildLevels();
+}
+
+bool TextureAtlas::Load(const std::string& fileName)
+{
+    SDL_Surface* image = SDL_LoadBMP(fileName.c_str());
+    if (!image)
+    {
+        return false;
+    }
+
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA8888, 0);
+    SDL_FreeSurface(image);
+    if (!surface)
+    {
+        return false;
+    }
+
+    if (surface->w < TEX_WIDTH || surface->w % TEX_WIDTH != 0 || surface->h != TEX_HEIGHT)
+    {
+        SDL_FreeSurface(surface);
+        return false;
+    }
+
+    m_count = surface->w / TEX_WIDTH;
+    m_texels.assign(TEXTURE_STRIDE * 2 * m_count, 0);
+
+    SDL_LockSurface(surface);
+    for (int y = 0; y < TEX_HEIGHT; y++)
+    {
+        const Uint32* row = (const Uint32*)((const byte*)surface->pixels + (size_t)y * surface->pitch);
+        for (int x = 0; x < surface->w; x++)
+        {
+            // Magenta is see-through, for sprites
+            Uint32 texel = ((row[x] >> 8) == 0xFF00FF) ? 0 : row[x];
+            int texture = x / TEX_WIDTH;
+            m_texels[GetLevelOffset(texture, 0, false) + (x % TEX_WIDTH) * TEX_HEIGHT + y] = texel;
+        }
+    }
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+
+    BuildLevels();
+    return true;
+}
+
+void TextureAtlas::BuildLevels()
+{
+    for (int texture = 0; texture < m_count; texture++)
+    {
+        for (int level = 1; level < TEX_LEVELS; level++)
+        {
+            const Uint32* source = &m_texels[GetLevelOffset(texture, level - 1, false)];
+            Uint32* dest = &m_texels[GetLevelOffset(texture, level, false)];
+            int sourceHeight = TEX_HEIGHT >> (level - 1);
+            int width = TEX_WIDTH >> level;
+            int height = TEX_HEIGHT >> level;
+
+            for (int x = 0; x < width; x++)
+            {
+                const Uint32* left = source + (x * 2) * sourceHeight;
+                const Uint32* right = left + sourceHeight;
+                for (int y = 0; y < height; y++)
+                {
+                    dest[x * height + y] = Average(left[y * 2], left[y * 2 + 1], right[y * 2], right[y * 2 + 1]);
+                }
+            }
+        }
+
+        // Half brightness, full alpha
+        const Uint32* lit = &m_texels[GetLevelOffset(texture, 0, false)];
+        Uint32* shaded = &m_texels[GetLevelOffset(texture, 0, true)];
+        for (size_t i = 0; i < TEXTURE_STRIDE; i++)
+        {
+            shaded[i] = ((lit[i] >> 1) & 0x7F7F7F00) | (lit[i] & 0xFF);
+        }
+    }
+}
+
+size_t TextureAtlas::GetLevelOffset(int texture, int level, bool shaded) const
+{
+    size_t offset = TEXTURE_STRIDE * (texture * 2 + (shaded ? 1 : 0));
+    for (int i = 0; i < level; i++)
+    {
+        offset += (size_t)(TEX_WIDTH >> i) * (TEX_HEIGHT >> i);
+    }
+
+    return offset;
+}
+
+int TextureAtlas::GetTextureCount() const
+{
+    return m_count;
+}
+
+// An atlas too small to have its own floor and ceiling uses its first texture for them
+int TextureAtlas::GetWallTextureCount() const
+{
+    return (m_count >= 3) ? m_count - 2 : m_count;
+}
+
+int TextureAtlas::GetTileTexture(int tile) const
+{
+    int wallTextures = GetWallTextureCount();
+    if (tile >= 1 && tile <= wallTextures)
+    {
+        return tile - 1;
+    }
+
+    return wallTextures - 1;
+}
+
+int TextureAtlas::GetFloorTexture() const
+{
+    return (m_count >= 3) ? m_count - 2 : 0;
+}
+
+int TextureAtlas::GetCeilingTexture() const
+{
+    return (m_count >= 3) ? m_count - 1 : 0;
+}
+
+const Uint32* TextureAtlas::GetLevel(int texture, int level, bool shaded) const
+{
+    return &m_texels[GetLevelOffset(texture, level, shaded)];
+}
+
+const Uint32* TextureAtlas::GetColumn(int texture, int level, bool shaded, int u) const
+{
+    return GetLevel(texture, level, shaded) + (size_t)u * (TEX_HEIGHT >> level);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "PCH.hpp"
+#include <string>
+#include <vector>
+
+// Wall textures, TEX_WIDTH x TEX_HEIGHT packed RGBA8888 texels each, with a full
+// chain of mip levels down to 1 x 1.
+//
+// Texels are stored column by column, so drawing a vertical wall strip walks
+// straight down through memory. Each texture is kept twice, lit and shaded, so
+// walls facing north or south cost nothing extra to darken. Per texture and shade,
+// the levels follow each other from the largest down.
+//
+// In a wall atlas, the last two textures are for the floor and the ceiling.
+// Sprite atlases are only sprites, with texels that have no alpha left out.
+
+const int TEX_WIDTH = 64;
+const int TEX_HEIGHT = 64;
+const int TEX_SHIFT = 6; // log2 of TEX_WIDTH and TEX_HEIGHT
+const int TEX_LEVELS = TEX_SHIFT + 1;
+
+class TextureAtlas
+{
+public:
+    TextureAtlas();
+
+    // The built-in textures, one per wall tile type, then the floor and ceiling
+    void Generate();
+
+    // The built-in sprites
+    void GenerateSprites();
+
+    // A BMP with the textures side by side, TEX_HEIGHT pixels tall and a multiple
+    // of TEX_WIDTH wide, where magenta is transparent. Leaves the atlas as it was
+    // if the file can't be used.
+    bool Load(const std::string& fileName);
+
+    int GetTextureCount() const;
+
+    // The texture drawn on a wall tile
+    int GetTileTexture(int tile) const;
+    int GetFloorTexture() const;
+    int GetCeilingTexture() const;
+
+    // A whole mip level, (TEX_WIDTH >> level) columns of (TEX_HEIGHT >> level) texels
+    const Uint32* GetLevel(int texture, int level, bool shaded) const;
+
+    // Column u of a mip level, (TEX_HEIGHT >> level) texels from top to bottom.
+    // u is counted in texels of that level.
+    const Uint32* GetColumn(int texture, int level, bool shaded, int u) const;
+
+private:
+    void Generate(int count, Uint32 (*generateTexel)(int texture, int x, int y));
+    // Fills in the shaded copy and the smaller levels from the lit top level
+    void BuildLevels();
+    int GetWallTextureCount() const;
+    size_t GetLevelOffset(int texture, int level, bool shaded) const;
+
+    int m_count;
+    std::vector<Uint32> m_texels;
+};
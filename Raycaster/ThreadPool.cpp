@@ -0,0 +1,107 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(int threadCount) :
+    m_job(nullptr),
+    m_count(0),
+    m_chunkSize(1),
+    m_nextChunk(0),
+    m_busyWorkers(0),
+    m_generation(0),
+    m_quit(false)
+{
+    for (int thread = 1; thread < threadCount; thread++)
+    {
+        m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, thread));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_wake.notify_all();
+
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+}
+
+void ThreadPool::ParallelFor(int count, int chunkSize, const Job& job)
+{
+    if (m_workers.empty() || count <= chunkSize)
+    {
+        job(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_chunkSize = chunkSize;
+        m_nextChunk = 0;
+        m_busyWorkers = (int)m_workers.size();
+        m_generation++;
+    }
+
+    m_wake.notify_all();
+
+    RunChunks(0);
+
+    // Wait for the workers to drain, so the job can't outlive this call
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_job = nullptr;
+}
+
+int ThreadPool::GetThreadCount() const
+{
+    return (int)m_workers.size() + 1;
+}
+
+void ThreadPool::WorkerLoop(int thread)
+{
+    unsigned int generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, generation] { return m_quit || m_generation != generation; });
+
+            if (m_quit)
+            {
+                return;
+            }
+
+            generation = m_generation;
+        }
+
+        RunChunks(thread);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunChunks(int thread)
+{
+    while (true)
+    {
+        int begin = m_nextChunk.fetch_add(m_chunkSize);
+        if (begin >= m_count)
+        {
+            break;
+        }
+
+        int end = (begin + m_chunkSize < m_count) ? begin + m_chunkSize : m_count;
+        (*m_job)(begin, end, thread);
+    }
+}
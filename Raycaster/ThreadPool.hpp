@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that stay alive between frames.
+// The calling thread takes part in the work too, so a pool of N threads
+// spawns N - 1 workers.
+class ThreadPool
+{
+public:
+    typedef std::function<void(int begin, int end, int thread)> Job;
+
+    ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    // Splits [0, count) into chunks of chunkSize and hands them out to the threads
+    // until none are left. Blocks until every chunk has finished.
+    void ParallelFor(int count, int chunkSize, const Job& job);
+
+    int GetThreadCount() const;
+
+private:
+    void WorkerLoop(int thread);
+    void RunChunks(int thread);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const Job* m_job;
+    int m_count;
+    int m_chunkSize;
+    std::atomic<int> m_nextChunk;
+    int m_busyWorkers;
+    unsigned int m_generation;
+    bool m_quit;
+};
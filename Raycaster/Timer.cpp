@@ -13,7 +13,7 @@ void Timer::Start()
 {
     m_isStarted = true;
     m_isPaused = false;
-    m_startTime = SDL_GetTicks();
+    m_startTime = SDL_GetPerformanceCounter();
     m_pausedTime = 0;
 }
 
@@ -33,7 +33,7 @@ void Timer::Pause()
         m_isPaused = true;
 
         // Calculate the paused time
-        m_pausedTime = SDL_GetTicks() - m_startTime;
+        m_pausedTime = SDL_GetPerformanceCounter() - m_startTime;
 
         // Reset the start time
         m_startTime = 0;
@@ -48,7 +48,7 @@ void Timer::Unpause()
         m_isPaused = false;
 
         // Reset the starting time
-        m_startTime = SDL_GetTicks() - m_pausedTime;
+        m_startTime = SDL_GetPerformanceCounter() - m_pausedTime;
 
         // Reset the paused time
         m_pausedTime = 0;
@@ -57,7 +57,12 @@ void Timer::Unpause()
 
 Uint32 Timer::GetTime()
 {
-    Uint32 time = 0;
+    return (Uint32)(GetTimeNs() / 1000000);
+}
+
+Uint64 Timer::GetTimeNs()
+{
+    Uint64 time = 0;
 
     if (m_isStarted)
     {
@@ -67,11 +72,13 @@ Uint32 Timer::GetTime()
         }
         else
         {
-            time = SDL_GetTicks() - m_startTime;
+            time = SDL_GetPerformanceCounter() - m_startTime;
         }
     }
 
-    return time;
+    // Split into whole seconds first, so the multiply can't overflow
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    return (time / frequency) * 1000000000 + (time % frequency) * 1000000000 / frequency;
 }
 
 bool Timer::IsStarted()
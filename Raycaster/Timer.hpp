@@ -10,13 +10,15 @@ public:
     void Stop();
     void Pause();
     void Unpause();
-    Uint32 GetTime();
+    Uint32 GetTime(); // Milliseconds
+    Uint64 GetTimeNs();
     bool IsStarted();
     bool IsPaused();
 
 private:
-    Uint32 m_startTime;
-    Uint32 m_pausedTime;
+    // Performance counter ticks
+    Uint64 m_startTime;
+    Uint64 m_pausedTime;
     bool m_isStarted;
     bool m_isPaused;
 };
\ No newline at end of file
@@ -1,48 +1,59 @@
 #include "PCH.hpp"
 #include "Vector2D.hpp"
 
-Vector2D::Vector2D()
+template <typename T>
+Vector2DT<T>::Vector2DT() :
+    m_x(0),
+    m_y(0)
 {
-    Vector2D(0, 0);
 }
 
-Vector2D::Vector2D(const double& x, const double& y) :
+template <typename T>
+Vector2DT<T>::Vector2DT(const T& x, const T& y) :
     m_x(x),
     m_y(y)
 {
 }
 
-Vector2D::Vector2D(const Vector2D& other) :
+template <typename T>
+Vector2DT<T>::Vector2DT(const Vector2DT& other) :
     m_x(other.GetX()),
     m_y(other.GetY())
 {
 }
 
-void Vector2D::SetX(const double& x)
+template <typename T>
+void Vector2DT<T>::SetX(const T& x)
 {
     m_x = x;
 }
 
-double Vector2D::GetX() const
+template <typename T>
+T Vector2DT<T>::GetX() const
 {
     return m_x;
 }
 
-void Vector2D::SetY(const double& y)
+template <typename T>
+void Vector2DT<T>::SetY(const T& y)
 {
     m_y = y;
 }
 
-double Vector2D::GetY() const
+template <typename T>
+T Vector2DT<T>::GetY() const
 {
     return m_y;
 }
 
-void Vector2D::Rotate(const double& degrees)
+template <typename T>
+void Vector2DT<T>::Rotate(const double& degrees)
 {
     double radians = degrees * (M_PI / 180.0);
-    double newX = m_x * cos(radians) - m_y * sin(radians);
-    double newY = m_x * sin(radians) + m_y * cos(radians);
+    T cosine = ScalarTraits<T>::FromDouble(cos(radians));
+    T sine = ScalarTraits<T>::FromDouble(sin(radians));
+    T newX = m_x * cosine - m_y * sine;
+    T newY = m_x * sine + m_y * cosine;
 
     m_x = newX;
     m_y = newY;
@@ -51,108 +62,128 @@ void Vector2D::Rotate(const double& degrees)
 // TODO 
 // Refactor the following?
 
-Vector2D Vector2D::operator+(const Vector2D& other)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator+(const Vector2DT& other)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x + other.m_x;
     vec.m_y = m_y + other.m_y;
 
     return vec;
 }
 
-void Vector2D::operator+=(const Vector2D& other)
+template <typename T>
+void Vector2DT<T>::operator+=(const Vector2DT& other)
 {
     m_x += other.m_x;
     m_y += other.m_y;
 }
 
-Vector2D Vector2D::operator+(const double& val)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator+(const T& val)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x + val;
     vec.m_y = m_y + val;
 
     return vec;
 }
 
-Vector2D Vector2D::operator-(const double& val)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator-(const T& val)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x - val;
     vec.m_y = m_y - val;
 
     return vec;
 }
 
-Vector2D Vector2D::operator/(const double& val)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator/(const T& val)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x / val;
     vec.m_y = m_y / val;
 
     return vec;
 }
 
-void Vector2D::operator/=(const double& val)
+template <typename T>
+void Vector2DT<T>::operator/=(const T& val)
 {
     m_x = m_x / val;
     m_y = m_y / val;
 }
 
-Vector2D Vector2D::operator-(const Vector2D& other)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator-(const Vector2DT& other)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x - other.m_x;
     vec.m_y = m_y - other.m_y;
 
     return vec;
 }
 
-void Vector2D::operator-=(const Vector2D& other)
+template <typename T>
+void Vector2DT<T>::operator-=(const Vector2DT& other)
 {
     m_x = m_x - other.m_x;
     m_y = m_y - other.m_y;
 }
 
-Vector2D Vector2D::operator*(const Vector2D& other)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator*(const Vector2DT& other)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x * other.m_x;
     vec.m_y = m_y * other.m_y;
 
     return vec;
 }
 
-Vector2D Vector2D::operator*(const double& scalar)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::operator*(const T& scalar)
 {
-    Vector2D vec;
+    Vector2DT vec;
     vec.m_x = m_x * scalar;
     vec.m_y = m_y * scalar;
 
     return vec;
 }
 
-bool Vector2D::operator==(const Vector2D& other)
+template <typename T>
+bool Vector2DT<T>::operator==(const Vector2DT& other)
 {
     return (m_x == other.m_x && m_y == other.m_y);
 }
 
-bool Vector2D::operator!=(const Vector2D& other)
+template <typename T>
+bool Vector2DT<T>::operator!=(const Vector2DT& other)
 {
     return (m_x != other.m_x || m_y != other.m_y);
 }
 
-Vector2D Vector2D::Normalize(Vector2D vec)
+template <typename T>
+Vector2DT<T> Vector2DT<T>::Normalize(Vector2DT vec)
 {
-    return Vector2D(vec.GetX() / Vector2D::Magnitude(vec), vec.GetY() / Vector2D::Magnitude(vec));
+    return Vector2DT(vec.GetX() / Magnitude(vec), vec.GetY() / Magnitude(vec));
 }
 
-double Vector2D::Distance(Vector2D left, Vector2D right)
+template <typename T>
+T Vector2DT<T>::Distance(Vector2DT left, Vector2DT right)
 {
-    return Vector2D::Magnitude(right - left);
+    return Magnitude(right - left);
 }
 
-double Vector2D::Magnitude(Vector2D vec)
+template <typename T>
+T Vector2DT<T>::Magnitude(Vector2DT vec)
 {
-    return sqrt((vec.GetX() * vec.GetX()) + (vec.GetY() * vec.GetY()));
+    T squared = (vec.GetX() * vec.GetX()) + (vec.GetY() * vec.GetY());
+    return ScalarTraits<T>::FromDouble(sqrt(ScalarTraits<T>::ToDouble(squared)));
 }
+
+template class Vector2DT<double>;
+template class Vector2DT<float>;
+template class Vector2DT<Fixed>;
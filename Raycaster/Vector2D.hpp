@@ -1,38 +1,43 @@
 #pragma once
 #include "PCH.hpp"
+#include "Scalar.hpp"
 
-class Vector2D
+// Instantiated for double, float and Fixed, see Scalar.hpp. Angles are always in doubles.
+template <typename T>
+class Vector2DT
 {
 public:
-    Vector2D();
-    Vector2D(const double& x, const double& y);
-    Vector2D(const Vector2D& other);
+    Vector2DT();
+    Vector2DT(const T& x, const T& y);
+    Vector2DT(const Vector2DT& other);
 
-    void SetX(const double& x);
-    double GetX() const;
-    void SetY(const double& y);
-    double GetY() const;
+    void SetX(const T& x);
+    T GetX() const;
+    void SetY(const T& y);
+    T GetY() const;
 
-    void Rotate(const double& radians);
+    void Rotate(const double& degrees);
 
-    Vector2D operator+(const Vector2D& other);
-    void operator+=(const Vector2D& other);
-    Vector2D operator+(const double& val);
-    Vector2D operator-(const double& val);
-    Vector2D operator/(const double& val);
-    void operator/=(const double& val);
-    Vector2D operator-(const Vector2D& other);
-    void operator-=(const Vector2D& other);
-    Vector2D operator*(const Vector2D& other);
-    Vector2D operator*(const double& scalar);
-    bool operator==(const Vector2D& other);
-    bool operator!=(const Vector2D& other);
+    Vector2DT operator+(const Vector2DT& other);
+    void operator+=(const Vector2DT& other);
+    Vector2DT operator+(const T& val);
+    Vector2DT operator-(const T& val);
+    Vector2DT operator/(const T& val);
+    void operator/=(const T& val);
+    Vector2DT operator-(const Vector2DT& other);
+    void operator-=(const Vector2DT& other);
+    Vector2DT operator*(const Vector2DT& other);
+    Vector2DT operator*(const T& scalar);
+    bool operator==(const Vector2DT& other);
+    bool operator!=(const Vector2DT& other);
 
-    static Vector2D Normalize(Vector2D vec);
-    static double Distance(Vector2D left, Vector2D right);
-    static double Magnitude(Vector2D vec);
+    static Vector2DT Normalize(Vector2DT vec);
+    static T Distance(Vector2DT left, Vector2DT right);
+    static T Magnitude(Vector2DT vec);
 
 private:
-    double m_x;
-    double m_y;
+    T m_x;
+    T m_y;
 };
+
+typedef Vector2DT<double> Vector2D;
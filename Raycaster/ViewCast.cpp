@@ -0,0 +1,159 @@
+#include "ViewCast.hpp"
+#include <algorithm>
+
+Pixel GetTileColor(int tile)
+{
+    switch (tile)
+    {
+    case 1:
+        return PIXEL_RED;
+    case 2:
+        return PIXEL_GREEN;
+    case 3:
+        return PIXEL_BLUE;
+    case 4:
+        return PIXEL_WHITE;
+    default:
+        return PIXEL_MAGENTA;
+    }
+}
+
+// The wall height is 1 unit, the distance from the player to the screen is viewDist,
+// thus the height on the screen is equal to
+// wallHeight * viewDist / dist
+double GetStripHeight(const ViewBasis& view, double dist)
+{
+    return round(view.viewDist / dist);
+}
+
+void TraceColumnsDDA(const GridView& grid, const ViewBasis& view, const double* columnCameraX, int begin, int end, GridHit* hits)
+{
+    int x = begin;
+    if (GetRayTracer() != RAY_TRACER_SCALAR)
+    {
+        double rayDirX[RAY_PACKET_SIZE];
+        double rayDirY[RAY_PACKET_SIZE];
+
+        for (; x + RAY_PACKET_SIZE <= end; x += RAY_PACKET_SIZE)
+        {
+            for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+            {
+                rayDirX[lane] = view.dirX + view.planeX * columnCameraX[x + lane];
+                rayDirY[lane] = view.dirY + view.planeY * columnCameraX[x + lane];
+            }
+
+            TraceRayPacketDDA(grid, rayDirX, rayDirY, hits + (x - begin));
+        }
+    }
+
+    for (; x < end; x++)
+    {
+        TraceRayDDA(grid, view.dirX + view.planeX * columnCameraX[x], view.dirY + view.planeY * columnCameraX[x], hits[x - begin]);
+    }
+}
+
+void SetWallColumn(DisplayList& list, int col, const GridHit& hit, double height, int tile, const TextureAtlas* textures, const ViewBasis& view)
+{
+    if (!hit.hit)
+    {
+        SetEmptyColumn(list, col);
+        return;
+    }
+
+    int side = hit.side;
+
+    // Calculate the position of the wall strip
+    double drawStart = round((list.height / 2) - (height / 2));
+    double drawEnd = drawStart + height;
+
+    // Up close the strip runs far past the screen
+    int top = (int)std::max(drawStart, -1e6);
+    drawStart = std::max(drawStart, 0.0);
+    drawEnd = std::min(drawEnd, (double)list.height - 1);
+
+    if (textures)
+    {
+        // Where along the wall the ray hit, flipped so every face reads left to right
+        double wallX = (side == 0) ? hit.y : hit.x;
+        int texX = (int)((wallX - floor(wallX)) * TEX_WIDTH);
+        if ((side == 0 && hit.x > view.x) || (side == 1 && hit.y < view.y))
+        {
+            texX = TEX_WIDTH - 1 - texX;
+        }
+
+        // The strip covers height + 1 rows. Use the largest mip level that doesn't
+        // have more texels down it than that, so far walls don't shimmer.
+        int stripRows = (int)std::min(height, 1e6) + 1;
+        int level = 0;
+        while (level < TEX_LEVELS - 1 && (TEX_HEIGHT >> level) > stripRows)
+        {
+            level++;
+        }
+
+        int levelHeight = TEX_HEIGHT >> level;
+        Uint32 texStep = (Uint32)(((Uint64)levelHeight << 16) / stripRows);
+        Uint32 texV = 0u - (Uint32)top * texStep;
+
+        const Uint32* texels = textures->GetColumn(textures->GetTileTexture(tile), level, side == 1, texX >> level);
+        SetTexturedSpan(list, col, drawStart, drawEnd, texels, texV, texStep, levelHeight - 1);
+    }
+    else
+    {
+        Pixel color = GetTileColor(tile);
+
+        if (side == 1)
+        {
+            color = ShadePixel(color);
+        }
+
+        SetColumnSpan(list, col, drawStart, drawEnd, color);
+    }
+}
+
+void SetSurfaceRows(DisplayList& list, const TextureAtlas* textures, const ViewBasis& view)
+{
+    if (!textures)
+    {
+        SetFlatSurfaces(list);
+        return;
+    }
+
+    int floorTexture = textures->GetFloorTexture();
+    int ceilingTexture = textures->GetCeilingTexture();
+
+    for (int y = 0; y < list.height; y++)
+    {
+        // The floor is half a unit below the eye and the ceiling half a unit above,
+        // so a row further from the middle of the screen sees them closer up
+        double rowOffset = fabs(y + 0.5 - list.height / 2);
+        double rowDist = 0.5 * view.viewDist / rowOffset;
+
+        // Use the largest mip level with about one texel per pixel, both across the
+        // row and from this row to the next
+        double columnStep = rowDist * view.planeLength * 2 / list.width;
+        double rowStep = rowDist / rowOffset;
+        double texelsPerPixel = std::max(columnStep, rowStep) * TEX_WIDTH;
+        int level = 0;
+        while (level < TEX_LEVELS - 1 && texelsPerPixel >= 2)
+        {
+            texelsPerPixel /= 2;
+            level++;
+        }
+
+        // The world position under the left edge of the row, in 16.16 texels. Only
+        // the position within a texture matters, so the coordinates can wrap.
+        double scale = (double)(TEX_WIDTH >> level) * 65536;
+        double worldX = view.x + rowDist * (view.dirX - view.planeX);
+        double worldY = view.y + rowDist * (view.dirY - view.planeY);
+
+        SurfaceRow row;
+        row.texels = textures->GetLevel((y < list.height / 2) ? ceilingTexture : floorTexture, level, false);
+        row.levelShift = TEX_SHIFT - level;
+        row.u = (Uint32)(Sint64)floor(worldX * scale);
+        row.v = (Uint32)(Sint64)floor(worldY * scale);
+        row.du = (Uint32)(Sint64)floor(rowDist * view.planeX * 2 / list.width * scale + 0.5);
+        row.dv = (Uint32)(Sint64)floor(rowDist * view.planeY * 2 / list.width * scale + 0.5);
+
+        SetSurfaceRow(list, y, row);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "PCH.hpp"
+#include "DisplayList.hpp"
+#include "Pixel.hpp"
+#include "RayTrace.hpp"
+#include "TextureAtlas.hpp"
+
+// Turning one view's ray hits into a display list, with no state of its own, so
+// the game's view and any number of RenderBatch views share it.
+
+// Where a view is seen from. dir is unit length and plane is perpendicular to it,
+// planeLength long, so a column's ray is dir + plane * its camera x. viewDist is
+// the distance to the screen in pixels.
+struct ViewBasis
+{
+    double x;
+    double y;
+    double dirX;
+    double dirY;
+    double planeX;
+    double planeY;
+    double planeLength;
+    double viewDist;
+};
+
+// The flat color of each tile type
+Pixel GetTileColor(int tile);
+
+// The height on the screen of a wall dist away along the view direction
+double GetStripHeight(const ViewBasis& view, double dist);
+
+// Traces the DDA rays of columns [begin, end) with the selected tracer, into hits[0, end - begin)
+void TraceColumnsDDA(const GridView& grid, const ViewBasis& view, const double* columnCameraX, int begin, int end, GridHit* hits);
+
+// Sets one column's wall span from its hit. tile is the type of the tile hit, and
+// textures is null for flat colored walls.
+void SetWallColumn(DisplayList& list, int col, const GridHit& hit, double height, int tile, const TextureAtlas* textures, const ViewBasis& view);
+
+// Sets every row's ceiling or floor. textures is null to leave them flat.
+void SetSurfaceRows(DisplayList& list, const TextureAtlas* textures, const ViewBasis& view);
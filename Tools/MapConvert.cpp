@@ -0,0 +1,243 @@
+#include "PCH.hpp"
+#include "Map.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Converts a text grid into a binary map file, or a map file back into CSV.
+//
+// Usage: mapconvert <input> <output> [--tile-size 1|2|4] [--chunk-shift N]
+//
+// A text grid has one row of tiles per line, either as numbers separated by
+// commas, or one character per tile: a digit for that tile, '.' or a space for
+// an empty tile, anything else for tile 1. The whole file is read as numbers
+// when it's a .csv file or any row has a comma, so numbers may also be split by
+// spaces there. Short rows are padded with empty tiles. Lines starting with ';'
+// are comments.
+// When the input is already a map file, it's written out as CSV instead.
+
+static const int DEFAULT_CHUNK_SHIFT = 6;
+
+static bool IsComment(const std::string& line)
+{
+    return !line.empty() && line[0] == ';';
+}
+
+// Decided once for the whole file, since a character row like "2 1 2" would also pass as numbers
+static bool IsNumberGrid(const std::string& fileName, std::istream& input)
+{
+    size_t dot = fileName.find_last_of('.');
+    if (dot != std::string::npos)
+    {
+        std::string extension = fileName.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "csv")
+        {
+            return true;
+        }
+    }
+
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (!IsComment(line) && line.find(',') != std::string::npos)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void ParseRow(const std::string& line, bool numbers, std::vector<int>& row)
+{
+    row.clear();
+
+    if (numbers)
+    {
+        const char* p = line.c_str();
+        while (*p)
+        {
+            char* end;
+            long tile = strtol(p, &end, 10);
+            if (end == p)
+            {
+                p++;
+                continue;
+            }
+
+            row.push_back((int)tile);
+            p = end;
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            char c = line[i];
+            if (c == '\r')
+            {
+                continue;
+            }
+
+            if (c >= '0' && c <= '9')
+            {
+                row.push_back(c - '0');
+            }
+            else
+            {
+                row.push_back((c == '.' || c == ' ') ? 0 : 1);
+            }
+        }
+    }
+}
+
+static bool IsMapFile(const std::string& fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+
+    return file && memcmp(magic, "RCMP", sizeof(magic)) == 0;
+}
+
+static int WriteCsv(const std::string& input, const std::string& output)
+{
+    Map map;
+    if (!map.Load(input))
+    {
+        return 1;
+    }
+
+    std::ofstream file(output.c_str());
+    for (int y = 0; y < map.GetHeight() && file; y++)
+    {
+        for (int x = 0; x < map.GetWidth(); x++)
+        {
+            file << (x ? "," : "") << map.GetTile(x, y);
+        }
+        file << '\n';
+    }
+
+    if (!file)
+    {
+        std::cerr << "Could not write " << output << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> files;
+    int tileSize = 0;
+    int chunkShift = DEFAULT_CHUNK_SHIFT;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--tile-size" && i + 1 < argc)
+        {
+            tileSize = atoi(argv[++i]);
+        }
+        else if (arg == "--chunk-shift" && i + 1 < argc)
+        {
+            chunkShift = atoi(argv[++i]);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input> <output> [--tile-size 1|2|4] [--chunk-shift N]" << std::endl;
+        return 1;
+    }
+
+    if (IsMapFile(files[0]))
+    {
+        return WriteCsv(files[0], files[1]);
+    }
+
+    // First pass for the size, so the map can be created up front
+    std::ifstream input(files[0].c_str());
+    if (!input)
+    {
+        std::cerr << "Could not open " << files[0] << std::endl;
+        return 1;
+    }
+
+    bool numbers = IsNumberGrid(files[0], input);
+    input.clear();
+    input.seekg(0);
+
+    std::string line;
+    std::vector<int> row;
+    int width = 0;
+    int height = 0;
+    int maxTile = 0;
+
+    while (std::getline(input, line))
+    {
+        if (IsComment(line))
+        {
+            continue;
+        }
+
+        ParseRow(line, numbers, row);
+        width = std::max(width, (int)row.size());
+        height++;
+
+        for (size_t i = 0; i < row.size(); i++)
+        {
+            maxTile = std::max(maxTile, row[i]);
+        }
+    }
+
+    // Smallest tile that holds every value
+    if (tileSize == 0)
+    {
+        tileSize = (maxTile < 256) ? 1 : (maxTile < 65536) ? 2 : 4;
+    }
+
+    Map map;
+    if (!map.Create(width, height, tileSize, chunkShift))
+    {
+        std::cerr << "Can't make a " << width << "x" << height << " map with " << tileSize << " byte tiles and chunk shift " << chunkShift << std::endl;
+        return 1;
+    }
+
+    input.clear();
+    input.seekg(0);
+
+    int y = 0;
+    while (std::getline(input, line))
+    {
+        if (IsComment(line))
+        {
+            continue;
+        }
+
+        ParseRow(line, numbers, row);
+        for (size_t x = 0; x < row.size(); x++)
+        {
+            map.SetTile((int)x, y, row[x]);
+        }
+        y++;
+    }
+
+    if (!map.Save(files[1]))
+    {
+        std::cerr << "Could not write " << files[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << files[1] << ": " << width << "x" << height << ", " << tileSize << " byte tiles, " << (1 << chunkShift) << "x" << (1 << chunkShift) << " chunks" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "PCH.hpp"
+#include "Map.hpp"
+#include "Pvs.hpp"
+#include "RayQueries.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Bakes the potentially visible sets for a map file, see Pvs.hpp, and writes them
+// next to it as <map>.pvs, where the game and the headless benchmark pick them up.
+//
+// Usage: pvsbake <map> [<output>] [--cluster-shift N] [--angles N] [--samples N] [--threads N] [--checks N]
+//
+// Prints how long the bake took and how much it culls: the share of clusters and
+// of open tiles left out of the average set, weighting each set by the open tiles
+// that use it. Then it checks the sets with random line of sight queries between
+// open tiles, and counts the pairs that can see each other but were culled. It
+// fails if there are any, though the file is still written.
+
+static const int DEFAULT_CHECKS = 1000000;
+
+// Random pairs of points in open tiles that can see each other, and how many of
+// them the PVS culled anyway
+static int CountMissed(const Map& map, const Pvs& pvs, ThreadPool* pool, int checkCount, int& seen)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    std::vector<double> originX;
+    std::vector<double> originY;
+    std::vector<double> targetX;
+    std::vector<double> targetY;
+    for (int tries = 0; (int)originX.size() < checkCount && tries < checkCount * 100; tries++)
+    {
+        double x0 = uniform(rng) * map.GetWidth();
+        double y0 = uniform(rng) * map.GetHeight();
+        double x1 = uniform(rng) * map.GetWidth();
+        double y1 = uniform(rng) * map.GetHeight();
+        if (map.GetTile((int)x0, (int)y0) == 0 && map.GetTile((int)x1, (int)y1) == 0)
+        {
+            originX.push_back(x0);
+            originY.push_back(y0);
+            targetX.push_back(x1);
+            targetY.push_back(y1);
+        }
+    }
+
+    std::vector<byte> blocked(originX.size());
+    RayQueries queries(pool);
+    queries.TestSight(map.GetGridView(0, 0), originX.data(), originY.data(), targetX.data(), targetY.data(), (int)originX.size(), blocked.data());
+
+    int missed = 0;
+    seen = 0;
+    for (size_t i = 0; i < originX.size(); i++)
+    {
+        if (blocked[i])
+        {
+            continue;
+        }
+
+        seen++;
+        if (!pvs.IsTileVisible(pvs.GetVisible(originX[i], originY[i]), (int)targetX[i], (int)targetY[i]))
+        {
+            missed++;
+        }
+    }
+
+    return missed;
+}
+
+int main(int argc, char** argv)
+{
+    std::string input;
+    std::string output;
+    int clusterShift = PVS_DEFAULT_CLUSTER_SHIFT;
+    int angleCount = PVS_DEFAULT_ANGLES;
+    int samplesPerTile = PVS_DEFAULT_SAMPLES;
+    int threadCount = SDL_GetCPUCount();
+    int checkCount = DEFAULT_CHECKS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--cluster-shift" && hasValue)
+        {
+            clusterShift = atoi(argv[++i]);
+        }
+        else if (arg == "--angles" && hasValue)
+        {
+            angleCount = atoi(argv[++i]);
+        }
+        else if (arg == "--samples" && hasValue)
+        {
+            samplesPerTile = atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            threadCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--checks" && hasValue)
+        {
+            checkCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (input.empty() && arg[0] != '-')
+        {
+            input = arg;
+        }
+        else if (output.empty() && arg[0] != '-')
+        {
+            output = arg;
+        }
+        else
+        {
+            input.clear();
+            break;
+        }
+    }
+
+    if (input.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " <map> [<output>] [--cluster-shift N] [--angles N] [--samples N] [--threads N] [--checks N]" << std::endl;
+        return 1;
+    }
+
+    if (output.empty())
+    {
+        output = input + ".pvs";
+    }
+
+    Map map;
+    if (!map.Load(input))
+    {
+        std::cerr << "Couldn't load " << input << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool(threadCount);
+    Pvs pvs;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!pvs.Bake(map, clusterShift, angleCount, samplesPerTile, &pool))
+    {
+        std::cerr << "Couldn't bake a PVS with clusters of " << (1 << clusterShift) << " tiles, " << angleCount << " angles and "
+            << samplesPerTile << " samples a tile. Clusters are " << (1 << PVS_MIN_CLUSTER_SHIFT) << " to " << (1 << PVS_MAX_CLUSTER_SHIFT)
+            << " tiles, and too many for the map take more than " << (PVS_MAX_BYTES >> 20) << " MB." << std::endl;
+        return 1;
+    }
+    double bakeSeconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    if (!pvs.Save(output))
+    {
+        std::cerr << "Couldn't write " << output << std::endl;
+        return 1;
+    }
+
+    // Every open tile is somewhere the player can stand, and sees its cluster's set
+    Uint64 openTiles = 0;
+    Uint64 clustersSeen = 0;
+    Uint64 openTilesSeen = 0;
+    std::vector<Uint64> clusterOpenTiles(pvs.GetClusterCount());
+    for (int y = 0; y < map.GetHeight(); y++)
+    {
+        for (int x = 0; x < map.GetWidth(); x++)
+        {
+            if (map.GetTile(x, y) == 0)
+            {
+                clusterOpenTiles[(y >> clusterShift) * pvs.GetClustersX() + (x >> clusterShift)]++;
+                openTiles++;
+            }
+        }
+    }
+
+    for (int cluster = 0; cluster < pvs.GetClusterCount(); cluster++)
+    {
+        Uint64 users = clusterOpenTiles[cluster];
+        if (users == 0)
+        {
+            continue;
+        }
+
+        int size = 1 << clusterShift;
+        const byte* visible = pvs.GetVisible((cluster % pvs.GetClustersX()) * size, (cluster / pvs.GetClustersX()) * size);
+        clustersSeen += users * pvs.CountVisible(visible);
+
+        for (int other = 0; other < pvs.GetClusterCount(); other++)
+        {
+            if (pvs.IsClusterVisible(visible, other % pvs.GetClustersX(), other / pvs.GetClustersX()))
+            {
+                openTilesSeen += users * clusterOpenTiles[other];
+            }
+        }
+    }
+
+    double clustersCulled = openTiles ? 1 - (double)clustersSeen / openTiles / pvs.GetClusterCount() : 0;
+    double tilesCulled = openTiles ? 1 - (double)openTilesSeen / openTiles / openTiles : 0;
+
+    std::cout << "Baked " << pvs.GetClustersX() << "x" << pvs.GetClustersY() << " clusters of " << (1 << clusterShift) << " tiles in "
+        << bakeSeconds << " s on " << threadCount << " threads (" << angleCount << " angles, " << samplesPerTile * samplesPerTile
+        << " samples a tile)" << std::endl;
+    std::cout << "Wrote " << output << ": " << pvs.GetFileSize() << " bytes, " << pvs.GetSize() << " in memory" << std::endl;
+    std::cout << "Culls " << clustersCulled * 100 << "% of clusters and " << tilesCulled * 100 << "% of open tiles on average" << std::endl;
+
+    if (checkCount > 0)
+    {
+        int seen = 0;
+        int missed = CountMissed(map, pvs, &pool, checkCount, seen);
+        std::cout << "Checked " << seen << " pairs of points that see each other, " << missed << " were culled" << std::endl;
+
+        // Things would pop in and out in the game, so a build script should stop here
+        if (missed > 0)
+        {
+            std::cerr << "The sets miss things that can be seen. Try more --angles or --samples." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}